@@ -0,0 +1,1661 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "host_port.h"
+#include "framebuffer.h"
+#include "display.h"
+#include "life.h"
+#include "hashlife.h"
+#include "turmite.h"
+#include "input.h"
+#include "text.h"
+#include "gfx.h"
+#include "cycle.h"
+#include "pattern.h"
+#include "compose.h"
+#include "wall.h"
+#include "stream.h"
+#include "pins.h"
+#include "effects.h"
+#include "trace.h"
+
+//Benchmarks of the firmware hot paths. Pass a substring to only run the
+//benchmarks whose name contains it.
+
+#define BENCH_MIN_US 300000
+
+static const char *filter;
+static uint8_t frame_a[SCRN_BUF_SIZE], frame_b[SCRN_BUF_SIZE];
+static volatile uint32_t sink;
+
+static bool bench_selected(const char *name)
+{
+    return filter==NULL || strstr(name, filter)!=NULL;
+}
+
+//Call fn until BENCH_MIN_US have passed, return the time per call in ns
+static double bench_time(void (*fn)(void))
+{
+    long calls=0;
+    int64_t start=host_time_us(), elapsed;
+    do {
+        fn();
+        calls++;
+        elapsed=host_time_us()-start;
+    } while (elapsed<BENCH_MIN_US);
+    return elapsed*1000.0/calls;
+}
+
+//units is how many of unit one call of fn processes
+static void bench_run(const char *name, void (*fn)(void), double units, const char *unit)
+{
+    if (!bench_selected(name)) return;
+    double ns=bench_time(fn);
+    printf("%-32s %12.1f ns/call %14.0f %s/s\n", name, ns, units*1e9/ns, unit);
+}
+
+static void fill_random(uint8_t *frame, uint32_t seed)
+{
+    srand(seed);
+    for (int i=0;i<SCRN_BUF_SIZE;i++) frame[i]=rand();
+}
+
+static void bench_set_pixel(void)
+{
+    for (int x=0;x<SCRN_WIDTH;x++) {
+        for (int y=0;y<SCRN_HEIGHT;y++) {
+            set_pixel(x, y, (x^y)&1, frame_a);
+        }
+    }
+}
+
+static void bench_get_pixel(void)
+{
+    uint32_t n=0;
+    for (int x=0;x<SCRN_WIDTH;x++) {
+        for (int y=0;y<SCRN_HEIGHT;y++) {
+            n+=get_pixel(x, y, frame_a);
+        }
+    }
+    sink=n;
+}
+
+static void bench_set_rect(void)
+{
+    set_rect(10, 10, 100, 50, frame_a);
+}
+
+//Every top row and height against set_pixel, on a random background, in
+//particular the rectangles that fit in one page
+static void bench_set_rect_check(void)
+{
+    int rects=0, in_page=0, wrong=0, in_page_wrong=0;
+    if (!bench_selected("set_rect")) return;
+    for (int y=0;y<SCRN_HEIGHT;y++) {
+        for (int height=1;y+height<=SCRN_HEIGHT;height++) {
+            int x=(y*7+height)%64, width=1+(y+height*5)%64;
+            fill_random(frame_a, rects);
+            memcpy(frame_b, frame_a, SCRN_BUF_SIZE);
+            set_rect(x, y, width, height, frame_a);
+            for (int i=0;i<width;i++) {
+                for (int j=0;j<height;j++) set_pixel(x+i, y+j, 1, frame_b);
+            }
+            bool bad=memcmp(frame_a, frame_b, SCRN_BUF_SIZE)!=0;
+            rects++;
+            wrong+=bad;
+            if (y%8+height<=8) {
+                in_page++;
+                in_page_wrong+=bad;
+            }
+        }
+    }
+    printf("%-32s %8d rects %d wrong, %d of them within a page %d wrong\n", "set_rect/reference", rects, wrong,
+            in_page, in_page_wrong);
+}
+
+static void bench_life_step(void)
+{
+    life_step(frame_a, frame_b);
+    life_step(frame_b, frame_a);
+}
+
+static void bench_life_step_scalar(void)
+{
+    life_step_scalar(frame_a, frame_b);
+    life_step_scalar(frame_b, frame_a);
+}
+
+//life_step against life_step_scalar from random soups of three densities,
+//each followed for a hundred generations, wrapping included
+static void bench_life_check(void)
+{
+    static uint8_t packed[2][SCRN_BUF_SIZE], scalar[2][SCRN_BUF_SIZE];
+    const int soups=40, gens=100;
+    int wrong=0;
+    if (!bench_selected("life_step/scalar")) return;
+    for (int i=0;i<soups;i++) {
+        fill_random(packed[0], 100+i);
+        //1/2, 1/4 and 1/8 of the cells alive
+        for (int d=0;d<i%3;d++) {
+            fill_random(frame_b, 200+i*3+d);
+            for (int j=0;j<SCRN_BUF_SIZE;j++) packed[0][j]&=frame_b[j];
+        }
+        memcpy(scalar[0], packed[0], SCRN_BUF_SIZE);
+        for (int g=0;g<gens;g++) {
+            life_step(packed[g&1], packed[!(g&1)]);
+            life_step_scalar(scalar[g&1], scalar[!(g&1)]);
+            if (memcmp(packed[!(g&1)], scalar[!(g&1)], SCRN_BUF_SIZE)) {
+                wrong++;
+                memcpy(packed[!(g&1)], scalar[!(g&1)], SCRN_BUF_SIZE);
+            }
+        }
+    }
+    printf("%-32s %8d gens %d wrong\n", "life_step/scalar reference", soups*gens, wrong);
+}
+
+//Generations per second over gens generations, after warmup generations from
+//the seed, stepping the whole field or sparsely
+static void bench_life_run(const char *workload, const uint8_t *seed, int warmup, int gens)
+{
+    static uint8_t buf[2][SCRN_BUF_SIZE];
+    char name[64];
+    for (int sparse=0;sparse<2;sparse++) {
+        snprintf(name, sizeof(name), "%s/%s", sparse ? "life_step_sparse" : "life_step", workload);
+        if (!bench_selected(name)) continue;
+        life_sparse_t s;
+        uint64_t tiles=0;
+        memcpy(buf[0], seed, SCRN_BUF_SIZE);
+        for (int g=0;g<warmup;g++) {
+            life_step(buf[0], buf[1]);
+            memcpy(buf[0], buf[1], SCRN_BUF_SIZE);
+        }
+        life_sparse_init(&s);
+        int64_t start=host_time_us();
+        for (int g=0;g<gens;g++) {
+            if (sparse) {
+                life_step_sparse(&s, buf[g&1], buf[!(g&1)]);
+                tiles+=s.tiles_computed;
+            } else {
+                life_step(buf[g&1], buf[!(g&1)]);
+            }
+        }
+        int64_t elapsed=host_time_us()-start;
+        printf("%-32s %12.1f ns/gen %14.0f gens/s", name, elapsed*1000.0/gens, gens*1e6/elapsed);
+        if (sparse) printf(" %5.1f%% of tiles", 100.0*tiles/gens/(SCRN_TILES_X*SCRN_PAGES));
+        printf("\n");
+    }
+}
+
+//Generations per second of the glider gun on the unbounded plane, 2^k at a
+//time, with how full the node pool got. With heap_kb the heap fails past
+//that, and the pool is what init could get.
+static void bench_hashlife(uint32_t max_nodes, uint8_t step_log2, int steps, int heap_kb)
+{
+    static hashlife_t h;
+    char name[64];
+    snprintf(name, sizeof(name), "hashlife/%u nodes/2^%u", (unsigned) max_nodes, step_log2);
+    if (heap_kb) snprintf(name+strlen(name), sizeof(name)-strlen(name), "/%d KB", heap_kb);
+    if (!bench_selected(name)) return;
+    host_heap_limit(heap_kb ? host_heap_in_use()+heap_kb*1024 : 0);
+    bool ok=hashlife_init(&h, max_nodes);
+    host_heap_limit(0);
+    if (!ok) {
+        printf("%-32s no memory\n", name);
+        return;
+    }
+    if (h.stats.capacity<max_nodes) printf("%-32s %u nodes of %u\n", name, (unsigned) h.stats.capacity, (unsigned) max_nodes);
+    for (int i=0;i<sizeof(glider_gun);i+=2) {
+        hashlife_set_cell(&h, glider_gun[i], glider_gun[i+1], 1);
+    }
+    hashlife_set_step_log2(&h, step_log2);
+    int64_t start=host_time_us();
+    for (int i=0;i<steps;i++) {
+        hashlife_step(&h);
+    }
+    int64_t elapsed=host_time_us()-start;
+    hashlife_stats_t *st=&h.stats;
+    printf("%-32s %12.1f us/step %14.3g gens/s peak %5u nodes %3u gcs %7u freed %5.1f%% memo hits %u failed\n",
+            name, (double) elapsed/steps, st->generation*1e6/elapsed, (unsigned) st->peak, (unsigned) st->gc_runs,
+            (unsigned) st->gc_freed, 100.0*st->memo_hits/(st->memo_hits+st->memo_misses),
+            (unsigned) st->alloc_failures);
+    hashlife_free(&h);
+}
+
+static void bench_langton(void)
+{
+    static uint8_t position[2]={64, 32}, direction=1;
+    for (int i=0;i<1000;i++) {
+        langton_ant_move(position, &direction, get_pixel(position[0], position[1], frame_a), frame_a);
+    }
+}
+
+//Steps per second of ants ants following rule, and what a frame of
+//frame_steps steps then costs to draw and send
+static void bench_turmite(spi_device_handle_t spi, scrn_delta_t *scrn, const char *rule, int ants, uint32_t frame_steps)
+{
+    static turmite_t t;
+    const int frames=200;
+    char name[64];
+    scrn_tiles_t tiles;
+    snprintf(name, sizeof(name), "turmite/%s/%d ants/%u", rule, ants, (unsigned) frame_steps);
+    if (!bench_selected(name)) return;
+    if (!turmite_init(&t, rule, ants)) return;
+    for (int a=0;a<ants;a++) {
+        turmite_add_ant(&t, 64+(a%8)*4, 32+(a/8)*4, a);
+    }
+    scrn_delta_invalidate(scrn);
+    host_spi_reset_stats(spi);
+    int64_t run_us=0, start=host_time_us();
+    for (int i=0;i<frames;i++) {
+        int64_t t0=host_time_us();
+        turmite_run(&t, frame_steps);
+        run_us+=host_time_us()-t0;
+        turmite_render(&t, frame_a, &tiles);
+        scrn_delta_flush_tiles(scrn, frame_a, &tiles);
+    }
+    int64_t elapsed=host_time_us()-start;
+    host_spi_stats_t stats;
+    host_spi_get_stats(spi, &stats);
+    printf("%-32s %12.0f moves/s %8.1f bytes/frame %8.1f us draw+flush/frame\n", name,
+            (double) frame_steps*frames*ants*1e6/run_us, (double) stats.bytes/frames,
+            (double) (elapsed-run_us)/frames);
+    turmite_free(&t);
+}
+
+//Frame sequences the flush benchmarks send
+static void workload_life(uint8_t *frame, int i)
+{
+    if (i==0) {
+        fill_random(frame, 1);
+    } else {
+        life_step(frame, frame_b);
+        memcpy(frame, frame_b, SCRN_BUF_SIZE);
+    }
+}
+
+static void workload_ant(uint8_t *frame, int i)
+{
+    static uint8_t position[2], direction;
+    if (i==0) {
+        memset(frame, 0, SCRN_BUF_SIZE);
+        position[0]=64;
+        position[1]=32;
+        direction=1;
+    }
+    langton_ant_move(position, &direction, get_pixel(position[0], position[1], frame), frame);
+}
+
+static void workload_static(uint8_t *frame, int i)
+{
+    if (i==0) fill_random(frame, 2);
+}
+
+//The tiles where frame differs from before
+static void changed_tiles(const uint8_t *before, const uint8_t *frame, scrn_tiles_t *tiles)
+{
+    scrn_tiles_clear(tiles);
+    for (int i=0;i<SCRN_BUF_SIZE;i+=SCRN_TILE_COLS) {
+        if (memcmp(before+i, frame+i, SCRN_TILE_COLS)) {
+            tiles->rows[i/SCRN_WIDTH]|=1<<((i%SCRN_WIDTH)/SCRN_TILE_COLS);
+        }
+    }
+}
+
+//Bus traffic and time per frame of each way of flushing, and after every
+//frame that the panel shows it. The tiles flush is given the tiles that
+//changed since the frame before.
+static void bench_flush(spi_device_handle_t spi, scrn_flush_t *flush, scrn_delta_t *scrn, const char *workload,
+        void (*next)(uint8_t *, int))
+{
+    const int frames=200;
+    static const char *names[]={"send_lines", "scrn_flush", "scrn_delta_flush", "scrn_delta_flush_tiles"};
+    static uint8_t before[SCRN_BUF_SIZE];
+    uint8_t panel[SCRN_BUF_SIZE];
+    char name[64];
+    for (int mode=0;mode<4;mode++) {
+        snprintf(name, sizeof(name), "%s/%s", names[mode], workload);
+        if (!bench_selected(name)) continue;
+        scrn_delta_invalidate(scrn);
+        host_spi_reset_stats(spi);
+        int wrong=0;
+        int64_t checking=0, start=host_time_us();
+        for (int i=0;i<frames;i++) {
+            next(frame_a, i);
+            if (mode==0) {
+                send_lines(spi, frame_a);
+            } else if (mode==1) {
+                scrn_flush(flush, frame_a);
+            } else if (mode==2) {
+                scrn_delta_flush(scrn, frame_a);
+            } else {
+                scrn_tiles_t tiles;
+                changed_tiles(before, frame_a, &tiles);
+                scrn_delta_flush_tiles(scrn, frame_a, &tiles);
+            }
+            int64_t check=host_time_us();
+            host_panel_read(spi, panel);
+            if (memcmp(panel, frame_a, SCRN_BUF_SIZE)) wrong++;
+            memcpy(before, frame_a, SCRN_BUF_SIZE);
+            checking+=host_time_us()-check;
+        }
+        int64_t elapsed=host_time_us()-start-checking;
+        host_spi_stats_t stats;
+        host_spi_get_stats(spi, &stats);
+        printf("%-32s %8.1f bytes/frame %6.1f trans/frame %8.1f us wire/frame %8.1f us cpu/frame %d wrong\n", name,
+                (double) stats.bytes/frames, (double) stats.transactions/frames, stats.bus_ns/1e3/frames,
+                (double) elapsed/frames, wrong);
+    }
+}
+
+static compose_t bench_compositor;
+
+static void bench_compose_idle(void)
+{
+    static scrn_tiles_t none, flush;
+    compose_frame(&bench_compositor, frame_a, &none, &flush);
+}
+
+static void bench_compose_full(void)
+{
+    static scrn_tiles_t flush;
+    compose_frame(&bench_compositor, frame_a, NULL, &flush);
+}
+
+//The panel against the simulation with the layers put over it pixel by
+//pixel, frame after frame, while the simulation changes under them, the
+//overlay is redrawn and cleared and the blink layer blinks. The simulation
+//buffer must come out as it went in.
+static void bench_compose(spi_device_handle_t spi, scrn_delta_t *scrn)
+{
+    static uint8_t panel[SCRN_BUF_SIZE], pristine[SCRN_BUF_SIZE];
+    compose_t *c=&bench_compositor;
+    const int frames=60, blink_frames=4;
+    int wrong=0, composed=0, phase=0;
+    bool blink_on=true;
+    if (!bench_selected("compose")) return;
+    fill_random(frame_a, 11);
+    compose_init(c, blink_frames);
+    for (int f=0;f<frames;f++) {
+        scrn_tiles_t changed, flush;
+        scrn_tiles_clear(&changed);
+        if (f%3==0) {
+            //The simulation moves on in a few places
+            for (int i=0;i<20;i++) {
+                int x=rand()%SCRN_WIDTH, y=rand()%SCRN_HEIGHT;
+                set_pixel(x, y, !get_pixel(x, y, frame_a), frame_a);
+                scrn_tiles_mark(&changed, x, y);
+            }
+        }
+        if (f%20==0) {
+            compose_clear(c, &c->overlay);
+            compose_clear(c, &c->blink);
+            compose_rect(c, &c->overlay, f, 5+f/4, 30, 20, true);
+            compose_rect(c, &c->overlay, f+2, 7+f/4, 26, 16, false);
+            compose_text(c, &c->overlay, f-10, 40, "HUD 42\nx", true);
+            compose_text(c, &c->overlay, 100-f, 3, "or", false);
+            compose_pixel(c, &c->blink, 64, 32, true);
+            compose_pixel(c, &c->blink, 65, 33, false);
+            compose_blink_restart(c);
+            blink_on=true;
+            phase=0;
+        } else if (f%20==10) {
+            compose_clear(c, &c->overlay);
+        }
+        if (++phase==blink_frames) {
+            phase=0;
+            blink_on=!blink_on;
+        }
+        memcpy(pristine, frame_a, SCRN_BUF_SIZE);
+        compose_frame(c, frame_a, &changed, &flush);
+        composed+=c->composed;
+        scrn_delta_flush_tiles(scrn, c->out, &flush);
+        host_panel_read(spi, panel);
+        if (memcmp(pristine, frame_a, SCRN_BUF_SIZE)) wrong++;
+        for (int i=0;i<SCRN_BUF_SIZE;i++) {
+            uint8_t v=(frame_a[i]&~c->overlay.mask[i])|c->overlay.ink[i];
+            v&=~c->blink.mask[i];
+            if (blink_on) v|=c->blink.ink[i];
+            if (panel[i]!=v) {
+                wrong++;
+                break;
+            }
+        }
+    }
+    printf("%-32s %8d frames %d wrong, %.1f of %d tiles composed/frame\n", "compose/panel", frames, wrong,
+            (double) composed/frames, SCRN_TILES_X*SCRN_PAGES);
+    //Only the blinking cursor left
+    compose_clear(c, &c->overlay);
+    compose_clear(c, &c->blink);
+    compose_pixel(c, &c->blink, 64, 32, true);
+    bench_run("compose_frame cursor", bench_compose_idle, 1, "frames");
+    bench_run("compose_frame full", bench_compose_full, 1, "frames");
+}
+
+//Frame i of panel k of a wall: Life on one, small squares piling up on
+//another, the third mostly still with a few pixels flipped
+static void wall_workload(uint8_t frames[][SCRN_BUF_SIZE], int count, int i)
+{
+    for (int k=0;k<count;k++) {
+        uint8_t *frame=frames[k];
+        if (k%3==0) {
+            if (i==0) {
+                fill_random(frame, 20+k);
+            } else {
+                life_step(frame, frame_b);
+                memcpy(frame, frame_b, SCRN_BUF_SIZE);
+            }
+        } else if (k%3==1) {
+            if (i==0) memset(frame, 0, SCRN_BUF_SIZE);
+            for (int j=0;j<16;j++) {
+                set_rect((i*7+j*13)%SCRN_WIDTH, (i*3+j*5)%SCRN_HEIGHT, 3, 3, frame);
+            }
+        } else {
+            if (i==0) fill_random(frame, 30+k);
+            int x=(i*37)%SCRN_WIDTH, y=(i*11)%SCRN_HEIGHT;
+            set_pixel(x, y, !get_pixel(x, y, frame), frame);
+        }
+    }
+}
+
+//Every panel of a wall against its part of the logical framebuffer, frame
+//after frame, with and without tiles
+static int bench_wall_check(wall_t *w, int frames)
+{
+    static uint8_t work[WALL_MAX_PANELS][SCRN_BUF_SIZE], before[WALL_MAX_PANELS][SCRN_BUF_SIZE];
+    uint8_t panel[SCRN_BUF_SIZE], part[SCRN_BUF_SIZE];
+    scrn_tiles_t tiles[WALL_MAX_PANELS];
+    int wrong=0;
+    wall_invalidate(w);
+    for (int i=0;i<frames;i++) {
+        memcpy(before, work, sizeof(before));
+        wall_workload(work, w->count, i);
+        for (int k=0;k<w->count;k++) {
+            wall_put(w, k, work[k]);
+            changed_tiles(before[k], work[k], &tiles[k]);
+        }
+        wall_flush_tiles(w, i%2 ? tiles : NULL);
+        for (int k=0;k<w->count;k++) {
+            host_panel_read(w->panels[k].spi, panel);
+            wall_get(w, k, part);
+            if (memcmp(panel, part, SCRN_BUF_SIZE) || memcmp(part, work[k], SCRN_BUF_SIZE)) wrong++;
+        }
+    }
+    return wrong;
+}
+
+//Whether a panel's init commands are scrn_init_cmds but for the flip and
+//the contrast
+static bool bench_wall_init_ok(const scrn_init_cmd_t *cmds, const wall_panel_config_t *config)
+{
+    int n=0;
+    for (;;n++) {
+        scrn_init_cmd_t want=scrn_init_cmds[n];
+        if (config->flipped && want.cmd==0xA1) want.cmd=0xA0;
+        if (config->flipped && want.cmd==0xC8) want.cmd=0xC0;
+        if (config->contrast && want.cmd==0x81) want.data[0]=config->contrast;
+        if (memcmp(&want, &cmds[n], sizeof(want))) return false;
+        if (want.databytes==0xFF) return true;
+    }
+}
+
+//A wall of stub panels: what each ends up showing, then what the bus
+//carries at wire speed against flushing the panels one after the other
+static void bench_wall(void)
+{
+    static wall_t wall;
+    static scrn_delta_t delta[WALL_MAX_PANELS];
+    static uint8_t work[WALL_MAX_PANELS][SCRN_BUF_SIZE];
+    static const wall_panel_config_t configs[WALL_MAX_PANELS]={
+        {CS_PIN, false, 0},
+        {CS1_PIN, true, 0x40},
+        {CS2_PIN, false, 0xCF}
+    };
+    static const struct {
+        int cols, rows;
+    } layouts[]={{3, 1}, {1, 2}};
+    const int frames=100;
+    if (!bench_selected("wall")) return;
+    for (int l=0;l<sizeof(layouts)/sizeof(layouts[0]);l++) {
+        int cols=layouts[l].cols, rows=layouts[l].rows, bad_init=0;
+        esp_err_t ret=wall_open(&wall, cols, rows, configs);
+        if (ret!=ESP_OK) {
+            printf("wall %dx%d: wall_open failed (%d)\n", cols, rows, ret);
+            return;
+        }
+        for (int k=0;k<wall.count;k++) {
+            if (!bench_wall_init_ok(wall.panels[k].init_cmds, &configs[k])) bad_init++;
+        }
+        int wrong=bench_wall_check(&wall, 40);
+        printf("%-32s %8d frames of %d panels %d wrong, %d wrong init tables\n", "wall/panels", 40, wall.count,
+                wrong, bad_init);
+        wall_close(&wall);
+    }
+
+    //Wire speed, the three panels flushed together by the wall or one after
+    //the other by scrn_delta_flush, the age of a panel's frame being from
+    //the start of the flush to the panel having all of it
+    host_spi_set_realtime(true);
+    wall_open(&wall, 3, 1, configs);
+    for (int mode=0;mode<2;mode++) {
+        const char *name=mode ? "wall/scrn_delta_flush each" : "wall/wall_flush";
+        int64_t age_total[WALL_MAX_PANELS]={0}, busy=0;
+        uint32_t idle=host_spi_bus_idle(HSPI_HOST);
+        uint64_t bytes=0, bus_ns=0;
+        for (int k=0;k<wall.count;k++) {
+            scrn_delta_init(&delta[k], wall.panels[k].spi);
+            host_spi_reset_stats(wall.panels[k].spi);
+        }
+        wall_invalidate(&wall);
+        wall_reset_stats(&wall);
+        for (int i=0;i<frames;i++) {
+            wall_workload(work, wall.count, i);
+            int64_t start=host_time_us();
+            if (mode==0) {
+                for (int k=0;k<wall.count;k++) wall_put(&wall, k, work[k]);
+                wall_flush(&wall);
+                for (int k=0;k<wall.count;k++) age_total[k]+=wall.panels[k].age_us;
+            } else {
+                for (int k=0;k<wall.count;k++) {
+                    scrn_delta_flush(&delta[k], work[k]);
+                    age_total[k]+=host_time_us()-start;
+                }
+            }
+            busy+=host_time_us()-start;
+        }
+        for (int k=0;k<wall.count;k++) {
+            host_spi_stats_t stats;
+            host_spi_get_stats(wall.panels[k].spi, &stats);
+            bytes+=stats.bytes;
+            bus_ns+=stats.bus_ns;
+        }
+        idle=host_spi_bus_idle(HSPI_HOST)-idle;
+        printf("%-32s %8.0f bytes/s %5.1f%% wire busy %5.1f idle/frame %8.1f us/frame, frame age", name,
+                bytes*1e6/busy, bus_ns/10.0/busy, (double) idle/frames, (double) busy/frames);
+        for (int k=0;k<wall.count;k++) printf(" %.0f", (double) age_total[k]/frames);
+        printf(" us\n");
+        if (mode==0) wall_print_stats(&wall);
+    }
+    wall_close(&wall);
+    host_spi_set_realtime(false);
+}
+
+static uint8_t stream_history[256][SCRN_BUF_SIZE];
+static uint8_t stream_payload[STREAM_MAX_PAYLOAD];
+static volatile int stream_wrong;
+
+static void bench_stream_encode(void)
+{
+    sink+=stream_encode(frame_b, frame_a, stream_payload);
+}
+
+static void bench_stream_decode(void)
+{
+    static int len;
+    static uint8_t frame[SCRN_BUF_SIZE];
+    if (len==0) len=stream_encode(frame_b, frame_a, stream_payload);
+    sink+=stream_decode(frame_b, stream_payload, len, frame);
+}
+
+//Runs in the receiving task
+static void bench_stream_on_frame(void *arg, const uint8_t *frame, uint8_t seq)
+{
+    if (memcmp(frame, stream_history[seq], SCRN_BUF_SIZE)) stream_wrong++;
+}
+
+static volatile bool stream_stopping;
+static SemaphoreHandle_t stream_stopped;
+
+//stream_receive, until asked to stop, then the UART is free for the effects
+static void bench_stream_task(void *arg)
+{
+    ESP_ERROR_CHECK(stream_open(STREAM_UART));
+    while (!stream_stopping) stream_poll(arg, STREAM_UART, 20/portTICK_RATE_MS);
+    uart_driver_delete(STREAM_UART);
+    xSemaphoreGive(stream_stopped);
+    vTaskDelete(NULL);
+}
+
+//The codec over the flush workloads, then frames sent through a pseudo
+//terminal to the receiver, the way stream_send sends them but as fast as
+//the terminal takes them and with bytes dropped on the way. Every frame
+//shown must be the one sent with its number.
+static void bench_stream(spi_device_handle_t spi)
+{
+    static const struct {
+        const char *name;
+        void (*next)(uint8_t *, int);
+    } workloads[]={{"life", workload_life}, {"ant", workload_ant}, {"static", workload_static}};
+    //workload_life steps through base
+    static uint8_t frame[SCRN_BUF_SIZE+16], base[SCRN_BUF_SIZE], packet[STREAM_MAX_PACKET];
+    static uint8_t *lines[2];
+    static scrn_flush_t flush;
+    static stream_rx_t rx;
+    const int frames=200, key_every=30;
+    if (!bench_selected("stream")) return;
+    for (int w=0;w<sizeof(workloads)/sizeof(workloads[0]);w++) {
+        int wrong=0, keys=0;
+        uint64_t bytes=0;
+        memset(base, 0, SCRN_BUF_SIZE);
+        for (int i=0;i<frames;i++) {
+            workloads[w].next(frame_a, i);
+            //As stream_send picks
+            int key_len=stream_encode(NULL, frame_a, stream_payload);
+            int len=stream_encode(base, frame_a, stream_payload);
+            bool key=i%key_every==0 || key_len<=len;
+            if (key) len=stream_encode(NULL, frame_a, stream_payload);
+            keys+=key;
+            bytes+=STREAM_HEADER_LEN+len+2;
+            if (!stream_decode(key ? NULL : base, stream_payload, len, frame)
+                    || memcmp(frame, frame_a, SCRN_BUF_SIZE)) {
+                wrong++;
+            }
+            memcpy(base, frame_a, SCRN_BUF_SIZE);
+        }
+        printf("stream/%-25s %8d frames %d wrong, %d key, %6.1f bytes/frame, %5.1f frames/s at %d baud (raw %.1f)\n",
+                workloads[w].name, frames, wrong, keys, (double) bytes/frames, STREAM_BAUD/10.0/bytes*frames,
+                STREAM_BAUD, STREAM_BAUD/10.0/(STREAM_HEADER_LEN+SCRN_BUF_SIZE+2));
+    }
+    //Random payloads must not write past the frame
+    int overrun=0;
+    for (int i=0;i<20000;i++) {
+        int len=rand()%64;
+        for (int j=0;j<len;j++) stream_payload[j]=rand();
+        memset(frame+SCRN_BUF_SIZE, 0xEE, 16);
+        stream_decode(i&1 ? NULL : base, stream_payload, len, frame);
+        for (int j=0;j<16;j++) {
+            if (frame[SCRN_BUF_SIZE+j]!=0xEE) overrun++;
+        }
+    }
+    printf("%-32s %8d payloads %d bytes written past the frame\n", "stream/garbage", 20000, overrun);
+    fill_random(frame_a, 40);
+    memcpy(frame_b, frame_a, SCRN_BUF_SIZE);
+    for (int i=0;i<60;i++) frame_a[(i*97)%SCRN_BUF_SIZE]^=1<<(i&7);
+    bench_run("stream_encode delta", bench_stream_encode, 1, "frames");
+    bench_run("stream_decode delta", bench_stream_decode, 1, "frames");
+
+    //End to end through a pseudo terminal
+    const char *pty=host_uart_pty(STREAM_UART);
+    int fd=pty ? open(pty, O_WRONLY|O_NOCTTY) : -1;
+    if (fd<0) {
+        printf("stream/pty: no pseudo terminal\n");
+        return;
+    }
+    for (int i=0;i<2;i++) lines[i]=heap_caps_malloc(SCRN_BUF_SIZE, MALLOC_CAP_DMA);
+    scrn_flush_init(&flush, spi);
+    stream_rx_init(&rx, lines, &flush);
+    rx.on_frame=bench_stream_on_frame;
+    stream_stopping=false;
+    stream_stopped=xSemaphoreCreateBinary();
+    xTaskCreatePinnedToCore(bench_stream_task, "stream", 4096, &rx, 5, NULL, 1);
+    const int sent=600;
+    int dropped=0;
+    memset(base, 0, SCRN_BUF_SIZE);
+    for (int i=0;i<sent;i++) {
+        workloads[(i/100)%2].next(frame_a, i%100);
+        memcpy(stream_history[i&0xFF], frame_a, SCRN_BUF_SIZE);
+        bool key=i%key_every==0 || i==sent-1;
+        int len=stream_encode(key ? NULL : base, frame_a, stream_payload);
+        len=stream_packet(packet, key ? STREAM_KEY : 0, i, stream_payload, len);
+        memcpy(base, frame_a, SCRN_BUF_SIZE);
+        //A byte lost every 20000 or so, but not from the last frame
+        if (i<sent-1 && rand()%20000<len) {
+            int k=rand()%len;
+            memmove(packet+k, packet+k+1, len-k-1);
+            len--;
+            dropped++;
+        }
+        if (write(fd, packet, len)!=len) break;
+    }
+    //Until the receiver has had it all, by when the last flush is done
+    for (uint64_t bytes=~0ULL;rx.bytes!=bytes;) {
+        bytes=rx.bytes;
+        vTaskDelay(50/portTICK_RATE_MS);
+    }
+    uint8_t panel[SCRN_BUF_SIZE];
+    host_panel_read(spi, panel);
+    printf("%-32s %8d frames %d shown, %d wrong, last %s; %d bytes dropped: %u bad, %u stale, %u bytes skipped\n",
+            "stream/pty", sent, (int) rx.frames, stream_wrong,
+            memcmp(panel, stream_history[(sent-1)&0xFF], SCRN_BUF_SIZE) ? "wrong" : "right", dropped,
+            (unsigned) rx.bad, (unsigned) rx.stale, (unsigned) rx.skipped);
+    close(fd);
+    stream_stopping=true;
+    xSemaphoreTake(stream_stopped, portMAX_DELAY);
+    vSemaphoreDelete(stream_stopped);
+    //The receiver is gone, collect the last frame's results before the
+    //device is flushed to from here
+    scrn_flush_wait(&flush);
+}
+
+//Holds MODE and taps button with it, as a person switching effects would
+static void bench_effects_chord(int button_pin)
+{
+    host_gpio_set_input(MODE_PIN, 0);
+    vTaskDelay(30/portTICK_RATE_MS);
+    host_gpio_set_input(button_pin, 1);
+    vTaskDelay(30/portTICK_RATE_MS);
+    host_gpio_set_input(button_pin, 0);
+    vTaskDelay(30/portTICK_RATE_MS);
+    host_gpio_set_input(MODE_PIN, 1);
+}
+
+static volatile bool effects_pressed;
+
+//A tap of MODE, which puts life in Play mode, then MODE with R once round
+//the effects and with L back round the other way
+static void bench_effects_presser(void *arg)
+{
+    int switches=*(int *) arg;
+    vTaskDelay(200/portTICK_RATE_MS);
+    host_gpio_set_input(MODE_PIN, 0);
+    vTaskDelay(40/portTICK_RATE_MS);
+    host_gpio_set_input(MODE_PIN, 1);
+    for (int i=0;i<switches;i++) {
+        vTaskDelay(300/portTICK_RATE_MS);
+        bench_effects_chord(i<switches/2 ? R_PIN : L_PIN);
+    }
+    vTaskDelay(300/portTICK_RATE_MS);
+    effects_pressed=true;
+    vTaskDelete(NULL);
+}
+
+//The effects of app_main switched round and back by the buttons, with their
+//states kept and shared. Every effect must start, every frame the runner
+//flushes must be what the panel shows, life must come back as it was left
+//only when kept, and once the first effect is running switching must not
+//touch the heap at all: what an effect needs besides its state it takes in
+//setup.
+static void bench_effects(spi_device_handle_t spi, scrn_delta_t *scrn)
+{
+    static effect_runner_t runner;
+    uint8_t panel[SCRN_BUF_SIZE];
+    if (!bench_selected("effects")) return;
+    //For the stream effect to open, nothing is sent to it
+    if (host_uart_pty(STREAM_UART)==NULL) printf("effects: no pseudo terminal for the stream\n");
+    input_init();
+    host_spi_set_realtime(true);
+    for (int keep=1;keep>=0;keep--) {
+        int switches=2*effect_list_count, frames=0, wrong=0, state_wrong=0;
+        uint64_t life_steps=0;
+        host_heap_reset_peak();
+        size_t heap_before=host_heap_in_use();
+        uint8_t *arena=heap_caps_malloc(EFFECT_ARENA_SIZE, MALLOC_CAP_8BIT);
+        if (!effect_runner_init(&runner, scrn, effect_list, effect_list_count, arena, EFFECT_ARENA_SIZE, keep)
+                || !effect_runner_switch(&runner, 0, 1, 0)) {
+            printf("effects/%s: did not start\n", keep ? "kept" : "shared");
+            heap_caps_free(arena);
+            continue;
+        }
+        size_t heap_started=host_heap_in_use(), heap_setup=host_heap_peak()-heap_before;
+        host_heap_reset_peak();
+        input_flush();
+        effects_pressed=false;
+        xTaskCreatePinnedToCore(bench_effects_presser, "presser", 4096, &switches, 5, NULL, 1);
+        int last=runner.current;
+        while (!effects_pressed) {
+            effect_runner_frame(&runner);
+            frames++;
+            host_panel_read(spi, panel);
+            if (memcmp(panel, runner.frame, SCRN_BUF_SIZE)) wrong++;
+            //Life in Play mode, its generations go on from where they were only if kept
+            effect_slot_t *life=&runner.slots[0];
+            if (last!=0 && runner.current==0 && life_steps) {
+                if ((life->sched.total_steps>=life_steps)!=keep) state_wrong++;
+            }
+            if (runner.current==0) life_steps=life->sched.total_steps;
+            last=runner.current;
+            effect_runner_wait(&runner);
+        }
+        effect_runner_print_stats(&runner);
+        printf("effects/%-24s %8d frames %d wrong, %u did not start, %u switches (%d pressed), %d states wrong,"
+                " arena %u bytes, %u bytes of heap at the start, then %+d and peak %+d while switching\n",
+                keep ? "kept" : "shared", frames, wrong, (unsigned) runner.failures, (unsigned) runner.switches,
+                switches, state_wrong, (unsigned) runner.arena_used, (unsigned) heap_setup,
+                (int) (host_heap_in_use()-heap_started), (int) (host_heap_peak()-heap_started));
+        for (int i=0;i<runner.count;i++) {
+            if (runner.slots[i].ready && runner.slots[i].effect->release) {
+                runner.slots[i].effect->release(runner.slots[i].state);
+            }
+        }
+        heap_caps_free(arena);
+    }
+    host_spi_set_realtime(false);
+}
+
+//Frame rate of computing with life_step_scalar and sending whole frames at
+//wire speed, one after the other or with the next frame computed while
+//DMA sends the last
+static void bench_flush_overlap(spi_device_handle_t spi, scrn_flush_t *flush)
+{
+    const int frames=100;
+    static uint8_t buf[2][SCRN_BUF_SIZE];
+    static const char *names[]={"frame/send_lines", "frame/scrn_flush", "frame/scrn_flush_async"};
+    for (int mode=0;mode<3;mode++) {
+        if (!bench_selected(names[mode])) continue;
+        fill_random(buf[0], 4);
+        host_spi_set_realtime(true);
+        host_spi_reset_stats(spi);
+        int64_t start=host_time_us(), flushing=0;
+        for (int i=0;i<frames;i++) {
+            uint8_t *shown=buf[i&1], *next=buf[!(i&1)];
+            int64_t t0=host_time_us();
+            if (mode==0) {
+                send_lines(spi, shown);
+            } else if (mode==1) {
+                scrn_flush(flush, shown);
+            } else {
+                scrn_flush_async(flush, shown);
+            }
+            flushing+=host_time_us()-t0;
+            life_step_scalar(shown, next);
+        }
+        scrn_flush_wait(flush);
+        int64_t elapsed=host_time_us()-start;
+        host_spi_stats_t stats;
+        host_spi_get_stats(spi, &stats);
+        printf("%-32s %8.1f us/frame %6.1f trans/frame %8.1f us in flush/frame\n", names[mode],
+                (double) elapsed/frames, (double) stats.transactions/frames, (double) flushing/frames);
+    }
+    host_spi_set_realtime(false);
+}
+
+//Bouncy presses of U: how long after the last bounce the event arrives, and
+//that each press gives exactly one press and one release event
+static void bench_input(void)
+{
+    const int presses=20;
+    int64_t latency_sum=0, latency_max=0;
+    int events=0, wrong=0;
+    input_event_t event;
+    if (!bench_selected("input")) return;
+    input_init();
+    input_flush();
+    for (int i=0;i<presses;i++) {
+        for (int level=1;level>=0;level--) {
+            //Three edges 300 us apart, settling on level
+            host_gpio_set_input(U_PIN, level);
+            host_sleep_until_us(host_time_us()+300);
+            host_gpio_set_input(U_PIN, !level);
+            host_sleep_until_us(host_time_us()+300);
+            host_gpio_set_input(U_PIN, level);
+            int64_t settled=host_time_us();
+            if (!input_wait(&event, 100/portTICK_RATE_MS)) {
+                wrong++;
+                continue;
+            }
+            int64_t latency=host_time_us()-settled;
+            latency_sum+=latency;
+            if (latency>latency_max) latency_max=latency;
+            events++;
+            if (event.button!=INPUT_U || event.type!=(level ? INPUT_PRESS : INPUT_RELEASE)) wrong++;
+        }
+        //Anything more would be a bounce getting through
+        while (input_poll(&event)) wrong++;
+    }
+    printf("%-32s %8.1f us avg latency %8.1f us max %4d events %d wrong (debounce %d us)\n", "input/bouncy press",
+            (double) latency_sum/events, (double) latency_max, events, wrong, INPUT_DEBOUNCE_US);
+}
+
+#if TRACE_ENABLED
+#define TRACE_WRITERS 3
+#define TRACE_WRITER_EVENTS 200000
+
+static volatile int trace_writers_done;
+
+static void bench_trace_pairs(void)
+{
+    for (int i=0;i<1000;i++) {
+        TRACE_BEGIN(TRACE_STEP);
+        TRACE_END(TRACE_STEP);
+    }
+}
+
+static void bench_trace_life_step(void)
+{
+    TRACE_BEGIN(TRACE_LIFE_GEN);
+    life_step(frame_a, frame_b);
+    TRACE_END(TRACE_LIFE_GEN);
+    TRACE_BEGIN(TRACE_LIFE_GEN);
+    life_step(frame_b, frame_a);
+    TRACE_END(TRACE_LIFE_GEN);
+}
+
+//Begin and end pairs of one point, which no other writer uses
+static void bench_trace_writer(void *arg)
+{
+    int point=(intptr_t) arg;
+    for (int i=0;i<TRACE_WRITER_EVENTS/2;i++) {
+        TRACE_BEGIN(point);
+        TRACE_END(point);
+    }
+    __atomic_add_fetch(&trace_writers_done, 1, __ATOMIC_RELEASE);
+    vTaskDelete(NULL);
+}
+
+//The events of each point must alternate begin and end and go forward in
+//time. Returns how many do not.
+static int bench_trace_check(const trace_event_t *events, int n)
+{
+    int wrong=0, last_type[TRACE_POINTS];
+    uint32_t last_cycles[TRACE_POINTS];
+    for (int p=0;p<TRACE_POINTS;p++) last_type[p]=-1;
+    for (int i=0;i<n;i++) {
+        int p=events[i].point;
+        if (p>=TRACE_POINTS || events[i].type>TRACE_INSTANT) {
+            wrong++;
+            continue;
+        }
+        if (last_type[p]>=0 && (events[i].type==last_type[p] || (int32_t) (events[i].cycles-last_cycles[p])<0)) {
+            wrong++;
+        }
+        last_type[p]=events[i].type;
+        last_cycles[p]=events[i].cycles;
+    }
+    return wrong;
+}
+#endif
+
+//What a begin and end pair costs, how much the trace point in each
+//generation slows Life down, and that the rings hold up to two writers on a
+//core and one on the other while they are being read
+static void bench_trace(void)
+{
+    if (!bench_selected("trace")) return;
+#if TRACE_ENABLED
+    static trace_event_t events[TRACE_RING_EVENTS];
+    uint32_t sync_cycles;
+    int64_t sync_us;
+    fill_random(frame_a, 0);
+    double plain=bench_time(bench_life_step);
+    fill_random(frame_a, 0);
+    double traced=bench_time(bench_trace_life_step);
+    double pair=bench_time(bench_trace_pairs)/1000;
+    printf("%-32s %12.1f ns/pair, life_step %.1f ns/gen traced, %.1f plain, %+.2f%%\n", "trace/begin+end", pair,
+            traced/2, plain/2, (traced/plain-1)*100);
+
+    const int points[TRACE_WRITERS]={TRACE_STEP, TRACE_RENDER, TRACE_FLUSH};
+    const int cores[TRACE_WRITERS]={0, 0, 1};
+    int snapshots=0, wrong=0, recorded=0;
+    trace_clear();
+    trace_writers_done=0;
+    for (int w=0;w<TRACE_WRITERS;w++) {
+        xTaskCreatePinnedToCore(bench_trace_writer, "tracer", 4096, (void *) (intptr_t) points[w], 5, NULL, cores[w]);
+    }
+    while (__atomic_load_n(&trace_writers_done, __ATOMIC_ACQUIRE)<TRACE_WRITERS) {
+        for (int core=0;core<portNUM_PROCESSORS;core++) {
+            int n=trace_snapshot(core, events, TRACE_RING_EVENTS, &sync_cycles, &sync_us);
+            wrong+=bench_trace_check(events, n);
+            snapshots++;
+        }
+    }
+    //All written, every slot has to be there
+    for (int core=0;core<portNUM_PROCESSORS;core++) {
+        int n=trace_snapshot(core, events, TRACE_RING_EVENTS, &sync_cycles, &sync_us);
+        wrong+=bench_trace_check(events, n)+(n!=TRACE_RING_EVENTS)+(sync_us==0);
+        recorded+=trace_rings[core].head;
+    }
+    printf("%-32s %8d events by %d writers on %d cores, %d snapshots, %d wrong\n", "trace/rings", recorded,
+            TRACE_WRITERS, portNUM_PROCESSORS, snapshots, wrong);
+    trace_clear();
+#else
+    printf("%-32s compiled out, the TRACE_ macros are empty\n", "trace");
+#endif
+}
+
+//Glyphs as font8x8_basic has them, one byte per row with bit 0 on the left
+static const struct {
+    char c;
+    uint8_t rows[TEXT_GLYPH_H];
+} text_golden[]={
+    {'0', {0x3E, 0x63, 0x73, 0x7B, 0x6F, 0x67, 0x3E, 0x00}},
+    {'@', {0x3E, 0x63, 0x7B, 0x7B, 0x7B, 0x03, 0x1E, 0x00}},
+    {'A', {0x0C, 0x1E, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x00}},
+    {'g', {0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x1F}},
+    {'|', {0x18, 0x18, 0x18, 0x00, 0x18, 0x18, 0x18, 0x00}},
+    {'~', {0x6E, 0x3B, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+};
+#define TEXT_GOLDEN ((int) (sizeof(text_golden)/sizeof(text_golden[0])))
+
+//Draw the golden glyphs pixel by pixel from their rows, clipping the same way
+static void text_reference(uint8_t *frame, int x, int y, text_mode_t mode)
+{
+    for (int g=0;g<TEXT_GOLDEN;g++, x+=TEXT_GLYPH_W) {
+        for (int r=0;r<TEXT_GLYPH_H;r++) {
+            for (int c=0;c<TEXT_GLYPH_W;c++) {
+                int px=x+c, py=y+r;
+                bool on=(text_golden[g].rows[r]>>c)&1;
+                if (px<0 || px>=SCRN_WIDTH || py<0 || py>=SCRN_HEIGHT) continue;
+                if (mode==TEXT_XOR) {
+                    set_pixel(px, py, get_pixel(px, py, frame)^on, frame);
+                } else if (on || mode==TEXT_OPAQUE) {
+                    set_pixel(px, py, on, frame);
+                }
+            }
+        }
+    }
+}
+
+static void bench_text_aligned(void)
+{
+    for (int y=0;y<SCRN_HEIGHT;y+=TEXT_GLYPH_H) {
+        text_draw(frame_a, 0, y, "The quick brown ", TEXT_OPAQUE, NULL);
+    }
+}
+
+static void bench_text_unaligned(void)
+{
+    for (int y=3;y<SCRN_HEIGHT;y+=TEXT_GLYPH_H) {
+        text_draw(frame_a, 0, y, "fox jumps over t", TEXT_OPAQUE, NULL);
+    }
+}
+
+static void bench_text_printf(void)
+{
+    text_printf(frame_a, 0, 0, TEXT_OPAQUE, NULL, "gen %u %.1f fps", 123456u, 33.3);
+}
+
+static void bench_text_uint(void)
+{
+    text_draw_uint(frame_a, 0, 0, 1234567890123ull, TEXT_OPAQUE, NULL);
+}
+
+//Every golden glyph against the blitter at every placement where some of it
+//shows, in each mode, on a random background. Then characters per second.
+static void bench_text(void)
+{
+    static uint8_t expect[SCRN_BUF_SIZE];
+    char golden[TEXT_GOLDEN+1];
+    int placements=0, wrong=0, glyphs_wrong=0, tiles_wrong=0;
+    if (!bench_selected("text")) return;
+    for (int g=0;g<TEXT_GOLDEN;g++) {
+        golden[g]=text_golden[g].c;
+        for (int c=0;c<TEXT_GLYPH_W;c++) {
+            uint8_t col=0;
+            for (int r=0;r<TEXT_GLYPH_H;r++) col|=((text_golden[g].rows[r]>>c)&1)<<r;
+            if (text_font[(uint8_t) golden[g]][c]!=col) glyphs_wrong++;
+        }
+    }
+    golden[TEXT_GOLDEN]='\0';
+    for (int mode=TEXT_OR;mode<=TEXT_XOR;mode++) {
+        for (int y=-TEXT_GLYPH_H;y<=SCRN_HEIGHT;y++) {
+            for (int x=-TEXT_GLYPH_W*TEXT_GOLDEN;x<=SCRN_WIDTH;x+=3) {
+                scrn_tiles_t tiles;
+                scrn_tiles_clear(&tiles);
+                fill_random(frame_a, placements);
+                memcpy(expect, frame_a, SCRN_BUF_SIZE);
+                int end=text_draw(frame_a, x, y, golden, mode, &tiles);
+                text_reference(expect, x, y, mode);
+                placements++;
+                if (memcmp(frame_a, expect, SCRN_BUF_SIZE) || end!=x+TEXT_GLYPH_W*TEXT_GOLDEN) wrong++;
+                //Every byte that changed has to be in a marked tile
+                fill_random(expect, placements-1);
+                for (int i=0;i<SCRN_BUF_SIZE;i++) {
+                    int page=i/SCRN_WIDTH, tile=(i%SCRN_WIDTH)/SCRN_TILE_COLS;
+                    if (frame_a[i]!=expect[i] && !(tiles.rows[page]&(1<<tile))) tiles_wrong++;
+                }
+            }
+        }
+    }
+    printf("%-32s %8d placements %d wrong, %d glyph columns wrong, %d bytes outside the tiles\n", "text/golden",
+            placements, wrong, glyphs_wrong, tiles_wrong);
+    bench_run("text_draw aligned", bench_text_aligned, 16*SCRN_PAGES, "chars");
+    bench_run("text_draw unaligned", bench_text_unaligned, 16*(SCRN_PAGES-1), "chars");
+    bench_run("text_printf hud", bench_text_printf, 1, "lines");
+    bench_run("text_draw_uint", bench_text_uint, 1, "numbers");
+}
+
+static void bench_clear_set_pixel(void)
+{
+    for (int x=0;x<SCRN_WIDTH;x++) {
+        for (int y=0;y<SCRN_HEIGHT;y++) {
+            set_pixel(x, y, 0, frame_a);
+        }
+    }
+}
+
+static void bench_gfx_clear(void)
+{
+    gfx_clear(frame_a);
+}
+
+static void bench_gfx_rect_fill(void)
+{
+    gfx_rect_fill(frame_a, 10, 10, 100, 50, GFX_SET);
+}
+
+static void bench_gfx_rect_invert(void)
+{
+    gfx_rect_fill(frame_a, 13, 11, 100, 50, GFX_INVERT);
+}
+
+static void bench_gfx_line(void)
+{
+    gfx_line(frame_a, 0, 0, SCRN_WIDTH-1, SCRN_HEIGHT-1, GFX_INVERT);
+}
+
+static void bench_gfx_circle_fill(void)
+{
+    gfx_circle_fill(frame_a, 64, 32, 30, GFX_INVERT);
+}
+
+static uint8_t sprite_data[2*16];
+static const gfx_sprite_t sprite={16, 13, sprite_data};
+
+static void bench_gfx_blit(void)
+{
+    gfx_blit(frame_a, 37, 21, &sprite, GFX_XOR);
+}
+
+static void bench_gfx_scroll_page(void)
+{
+    gfx_scroll_y(frame_a, 8);
+}
+
+static void bench_gfx_scroll_bits(void)
+{
+    gfx_scroll_y(frame_a, -3);
+}
+
+static bool ref_get(const uint8_t *frame, int x, int y)
+{
+    if (x<0 || x>=SCRN_WIDTH || y<0 || y>=SCRN_HEIGHT) return 0;
+    return get_pixel(x, y, (uint8_t*) frame);
+}
+
+//gfx against pixel by pixel versions on random frames and placements, plus
+//drawing with GFX_INVERT on a clear frame matching GFX_SET, which fails if
+//any pixel is drawn twice
+static void bench_gfx_check(void)
+{
+    static uint8_t expect[SCRN_BUF_SIZE], before[SCRN_BUF_SIZE];
+    int cases=0, wrong_rect=0, wrong_blit=0, wrong_scroll=0, wrong_once=0;
+    srand(12);
+    for (int i=0;i<4000;i++) {
+        int x=rand()%200-40, y=rand()%120-30, w=rand()%150-5, h=rand()%90-5;
+        gfx_colour_t colour=rand()%3;
+        fill_random(frame_a, i);
+        memcpy(expect, frame_a, SCRN_BUF_SIZE);
+        gfx_rect_fill(frame_a, x, y, w, h, colour);
+        for (int px=x;px<x+w;px++) {
+            for (int py=y;py<y+h;py++) {
+                if (px<0 || px>=SCRN_WIDTH || py<0 || py>=SCRN_HEIGHT) continue;
+                bool v=get_pixel(px, py, expect);
+                set_pixel(px, py, colour==GFX_SET ? 1 : colour==GFX_CLEAR ? 0 : !v, expect);
+            }
+        }
+        if (memcmp(frame_a, expect, SCRN_BUF_SIZE)) wrong_rect++;
+
+        srand(i);
+        for (int j=0;j<sizeof(sprite_data);j++) sprite_data[j]=rand();
+        gfx_sprite_t s={rand()%17, rand()%17, sprite_data};
+        gfx_rop_t rop=rand()%4;
+        fill_random(frame_a, i+1);
+        memcpy(expect, frame_a, SCRN_BUF_SIZE);
+        gfx_blit(frame_a, x, y, &s, rop);
+        for (int sx=0;sx<s.width;sx++) {
+            for (int sy=0;sy<s.height;sy++) {
+                int px=x+sx, py=y+sy;
+                if (px<0 || px>=SCRN_WIDTH || py<0 || py>=SCRN_HEIGHT) continue;
+                bool a=get_pixel(px, py, expect), b=(sprite_data[sx+s.width*(sy/8)]>>(sy%8))&1;
+                set_pixel(px, py, rop==GFX_COPY ? b : rop==GFX_OR ? a|b : rop==GFX_AND ? a&b : a^b, expect);
+            }
+        }
+        if (memcmp(frame_a, expect, SCRN_BUF_SIZE)) wrong_blit++;
+
+        int dx=rand()%300-150, dy=rand()%150-75;
+        fill_random(before, i+2);
+        memcpy(frame_a, before, SCRN_BUF_SIZE);
+        if (i&1) {
+            gfx_scroll_y(frame_a, dy%(SCRN_HEIGHT+8));
+        } else {
+            gfx_scroll_x(frame_a, dx);
+        }
+        for (int px=0;px<SCRN_WIDTH;px++) {
+            for (int py=0;py<SCRN_HEIGHT;py++) {
+                bool v=i&1 ? ref_get(before, px, py-dy%(SCRN_HEIGHT+8)) : ref_get(before, px-dx, py);
+                set_pixel(px, py, v, expect);
+            }
+        }
+        if (memcmp(frame_a, expect, SCRN_BUF_SIZE)) wrong_scroll++;
+
+        int shape=i%5;
+        for (int pass=0;pass<2;pass++) {
+            uint8_t *frame=pass ? expect : frame_a;
+            colour=pass ? GFX_SET : GFX_INVERT;
+            memset(frame, 0, SCRN_BUF_SIZE);
+            if (shape==0) gfx_rect(frame, x, y, w, h, colour);
+            if (shape==1) gfx_line(frame, x, y, x+w, y+h-40, colour);
+            if (shape==2) gfx_circle(frame, x, y, h/2, colour);
+            if (shape==3) gfx_circle_fill(frame, x, y, h/2, colour);
+            if (shape==4) gfx_line(frame, x, y, x+w/8, y+h, colour);
+        }
+        if (memcmp(frame_a, expect, SCRN_BUF_SIZE)) wrong_once++;
+        cases++;
+    }
+    printf("%-32s %8d cases %d rect, %d blit, %d scroll, %d drawn-twice wrong\n", "gfx/reference",
+            cases, wrong_rect, wrong_blit, wrong_scroll, wrong_once);
+}
+
+static void bench_gfx(void)
+{
+    if (bench_selected("gfx/reference")) bench_gfx_check();
+    bench_run("clear/set_pixel", bench_clear_set_pixel, SCRN_WIDTH*SCRN_HEIGHT, "pixels");
+    bench_run("clear/gfx_clear", bench_gfx_clear, SCRN_WIDTH*SCRN_HEIGHT, "pixels");
+    bench_run("gfx_rect_fill 100x50", bench_gfx_rect_fill, 100*50, "pixels");
+    bench_run("gfx_rect_fill invert 100x50", bench_gfx_rect_invert, 100*50, "pixels");
+    bench_run("gfx_line 128x64", bench_gfx_line, SCRN_WIDTH, "pixels");
+    bench_run("gfx_circle_fill r30", bench_gfx_circle_fill, 1, "circles");
+    bench_run("gfx_blit 16x13 xor", bench_gfx_blit, 16*13, "pixels");
+    fill_random(frame_a, 5);
+    bench_run("gfx_scroll_y page", bench_gfx_scroll_page, 1, "scrolls");
+    fill_random(frame_a, 5);
+    bench_run("gfx_scroll_y 3 rows", bench_gfx_scroll_bits, 1, "scrolls");
+}
+
+//One generation of any rule cell by cell, states as bytes: 0 dead, 1 live,
+//2 and up dying
+static void rule_reference(const life_rule_t *rule, const uint8_t *state, uint8_t *next)
+{
+    for (int x=0;x<SCRN_WIDTH;x++) {
+        for (int y=0;y<SCRN_HEIGHT;y++) {
+            int n=0;
+            for (int dx=-1;dx<=1;dx++) {
+                for (int dy=-1;dy<=1;dy++) {
+                    if (dx || dy) n+=state[(x+dx+SCRN_WIDTH)%SCRN_WIDTH+SCRN_WIDTH*((y+dy+SCRN_HEIGHT)%SCRN_HEIGHT)]==1;
+                }
+            }
+            uint8_t c=state[x+SCRN_WIDTH*y], v;
+            if (c==0) {
+                v=(rule->birth>>n)&1;
+            } else if (c==1) {
+                v=(rule->survive>>n)&1 ? 1 : rule->states>2 ? 2 : 0;
+            } else {
+                v=c+1<rule->states ? c+1 : 0;
+            }
+            next[x+SCRN_WIDTH*y]=v;
+        }
+    }
+}
+
+//Every preset against the reference, stepping whole and sparsely, then
+//generations per second with its own kernel and with the generic one
+static void bench_life_rules(void)
+{
+    static uint8_t state[2][SCRN_WIDTH*SCRN_HEIGHT], buf[2][SCRN_BUF_SIZE], sparse_buf[2][SCRN_BUF_SIZE];
+    static life_ages_t ages;
+    char name[64], text[24];
+    const int gens=300;
+    for (int i=0;i<life_preset_count;i++) {
+        life_rule_t rule;
+        if (!life_rule_parse(&rule, life_presets[i].rule)) {
+            printf("%s: %s does not parse\n", life_presets[i].name, life_presets[i].rule);
+            continue;
+        }
+        life_rule_format(&rule, text, sizeof(text));
+        snprintf(name, sizeof(name), "life_rule/%s", life_presets[i].name);
+        if (bench_selected(name)) {
+            life_sparse_t sparse;
+            int wrong=0, sparse_wrong=0;
+            fill_random(buf[0], i);
+            memcpy(sparse_buf[0], buf[0], SCRN_BUF_SIZE);
+            memcpy(sparse_buf[1], buf[0], SCRN_BUF_SIZE);
+            for (int x=0;x<SCRN_WIDTH;x++) {
+                for (int y=0;y<SCRN_HEIGHT;y++) state[0][x+SCRN_WIDTH*y]=get_pixel(x, y, buf[0]);
+            }
+            life_ages_clear(&ages);
+            life_sparse_init(&sparse);
+            for (int g=0;g<gens;g++) {
+                int a=g&1;
+                rule_reference(&rule, state[a], state[!a]);
+                life_step_rule(&rule, &ages, buf[a], buf[!a]);
+                for (int x=0;x<SCRN_WIDTH;x++) {
+                    for (int y=0;y<SCRN_HEIGHT;y++) {
+                        bool live=state[!a][x+SCRN_WIDTH*y]==1;
+                        if (get_pixel(x, y, buf[!a])!=live) wrong++;
+                    }
+                }
+                if (rule.states==2) {
+                    life_step_sparse_rule(&sparse, &rule, NULL, sparse_buf[a], sparse_buf[!a]);
+                    if (memcmp(sparse_buf[!a], buf[!a], SCRN_BUF_SIZE)) sparse_wrong++;
+                }
+            }
+            printf("%-32s %-16s %s kernel, %d cells wrong, %d sparse gens wrong\n", name, text,
+                    rule.kernel->name, wrong, sparse_wrong);
+        }
+        for (int generic=0;generic<2;generic++) {
+            if (generic && rule.kernel==&life_kernel_generic) continue;
+            snprintf(name, sizeof(name), "life_step_rule/%s%s", life_presets[i].name, generic ? " generic" : "");
+            if (!bench_selected(name)) continue;
+            if (generic) rule.kernel=&life_kernel_generic;
+            fill_random(buf[0], i);
+            life_ages_clear(&ages);
+            int64_t start=host_time_us();
+            for (int g=0;g<gens*10;g++) {
+                life_step_rule(&rule, &ages, buf[g&1], buf[!(g&1)]);
+            }
+            int64_t elapsed=host_time_us()-start;
+            printf("%-32s %12.1f ns/gen %14.0f gens/s\n", name, elapsed*1000.0/(gens*10), gens*10*1e6/elapsed);
+        }
+    }
+}
+
+//Known oscillators on an empty field: the period the detector finds and how
+//soon, that replaying matches stepping, and what it costs
+static void bench_cycle_run(const char *workload, const uint8_t *seed, int expect)
+{
+    static uint8_t buf[2][SCRN_BUF_SIZE], check[2][SCRN_BUF_SIZE];
+    char name[64];
+    static cycle_t cycle;
+    life_sparse_t sparse;
+    int gen=0, a=0, wrong=0;
+    const int max_gens=600, replay=1000;
+    snprintf(name, sizeof(name), "cycle/%s", workload);
+    if (!bench_selected(name)) return;
+    memcpy(buf[0], seed, SCRN_BUF_SIZE);
+    memcpy(buf[1], seed, SCRN_BUF_SIZE);
+    life_sparse_init(&sparse);
+    cycle_init(&cycle, buf[0], 1);
+    int64_t start=host_time_us(), hashing=0;
+    for (;gen<max_gens && !cycle_locked(&cycle);gen++) {
+        life_step_sparse(&sparse, buf[a], buf[!a]);
+        int64_t t=host_time_us();
+        cycle_update(&cycle, buf[a], buf[!a], &sparse.changed);
+        hashing+=host_time_us()-t;
+        a=!a;
+    }
+    int64_t stepping=host_time_us()-start;
+    //Step on alongside the replay and compare
+    memcpy(check[0], buf[a], SCRN_BUF_SIZE);
+    int64_t replaying=0;
+    for (int g=0;g<replay && cycle_locked(&cycle);g++) {
+        scrn_tiles_t changed;
+        life_step(check[g&1], check[!(g&1)]);
+        int64_t t=host_time_us();
+        const uint8_t *frame=cycle_next(&cycle, &changed);
+        replaying+=host_time_us()-t;
+        if (memcmp(frame, check[!(g&1)], SCRN_BUF_SIZE)) wrong++;
+    }
+    printf("%-32s period %2d (expected %2d) after %3d gens, %5.0f ns/gen stepping of which %3.0f hashing,"
+            " %4.0f ns/gen replaying, %d wrong\n", name, cycle.period, expect, gen, stepping*1000.0/gen,
+            hashing*1000.0/gen, cycle.replayed ? replaying*1000.0/cycle.replayed : 0.0, wrong);
+    cycle_free(&cycle);
+}
+
+static void bench_cycle(void)
+{
+    memset(frame_a, 0, SCRN_BUF_SIZE);
+    set_rect(60, 30, 2, 2, frame_a);
+    bench_cycle_run("block", frame_a, 1);
+    memset(frame_a, 0, SCRN_BUF_SIZE);
+    set_rect(60, 30, 3, 1, frame_a);
+    bench_cycle_run("blinker", frame_a, 2);
+    memset(frame_a, 0, SCRN_BUF_SIZE);
+    for (int i=0;i<4;i++) {
+        static const int lines6[4]={0, 5, 7, 12};
+        for (int j=0;j<6;j++) {
+            static const int cells[6]={2, 3, 4, 8, 9, 10};
+            set_pixel(50+cells[j], 20+lines6[i], 1, frame_a);
+            set_pixel(50+lines6[i], 20+cells[j], 1, frame_a);
+        }
+    }
+    bench_cycle_run("pulsar", frame_a, 3);
+    memset(frame_a, 0, SCRN_BUF_SIZE);
+    set_rect(59, 32, 10, 1, frame_a);
+    bench_cycle_run("pentadecathlon", frame_a, 15);
+    memset(frame_a, 0, SCRN_BUF_SIZE);
+    for (int i=0;i<sizeof(glider);i+=2) {
+        set_pixel(glider[i], glider[i+1], 1, frame_a);
+    }
+    //Comes back after 512 generations on the torus, too long to catch
+    bench_cycle_run("glider", frame_a, 0);
+    fill_random(frame_a, 3);
+    bench_cycle_run("soup", frame_a, 0);
+}
+
+static pattern_t bench_pattern;
+static pattern_rotation_t bench_rotation;
+
+static void bench_pattern_draw(void)
+{
+    pattern_draw(&bench_pattern, frame_a, 3, 5, bench_rotation, NULL);
+}
+
+//A size x size soup in RLE as Golly writes it, lines up to 70 characters
+static char *pattern_soup(int size, uint32_t *length)
+{
+    size_t cap=(size_t) size*size*2+64, n=0, line=0;
+    char *rle=malloc(cap);
+    n=sprintf(rle, "#N Soup\nx = %d, y = %d, rule = B3/S23\n", size, size);
+    srand(size);
+    for (int y=0;y<size;y++) {
+        int x=0;
+        while (x<size) {
+            bool live=rand()%8<3;
+            int run=1;
+            while (x+run<size && (rand()%8<3)==live) run++;
+            x+=run;
+            //Dead cells at the end of a row are left out
+            if (!live && x==size) break;
+            char token[16];
+            int len=run>1 ? sprintf(token, "%d%c", run, live ? 'o' : 'b') : sprintf(token, "%c", live ? 'o' : 'b');
+            if (line+len>70) {
+                rle[n++]='\n';
+                line=0;
+            }
+            memcpy(rle+n, token, len);
+            n+=len;
+            line+=len;
+        }
+        rle[n++]=y==size-1 ? '!' : '$';
+        line++;
+    }
+    rle[n++]='\n';
+    *length=n;
+    return rle;
+}
+
+//Oscillators come back where they were after period generations, spaceships
+//moved by dx, dy
+static const struct {
+    const char *name;
+    int period;
+    int dx, dy;
+} pattern_motion[]={
+    {"Glider", 4, 1, 1},
+    {"LWSS", 4, -2, 0},
+    {"Pulsar", 3, 0, 0},
+    {"Pentadecathlon", 15, 0, 0},
+};
+
+//Every pattern of the pack in each rotation against the upright one turned
+//pixel by pixel, the tiles drawn in, and the gun against the built in one.
+//Then decode speed on a large soup.
+static void bench_patterns(void)
+{
+    static uint8_t expect[SCRN_BUF_SIZE];
+    pattern_pack_t pack;
+    pattern_t p;
+    int draws=0, wrong=0, tiles_wrong=0, moves_wrong=0;
+    if (!bench_selected("pattern")) return;
+    if (!pattern_pack_open(&pack)) {
+        printf("%-32s no patterns partition, build patterns.bin\n", "pattern/pack");
+    } else {
+        for (uint32_t i=0;i<pack.count;i++) {
+            if (!pattern_get(&pack, i, &p)) {
+                wrong++;
+                continue;
+            }
+            if (p.width>SCRN_HEIGHT || p.height>SCRN_HEIGHT) continue;
+            memset(expect, 0, SCRN_BUF_SIZE);
+            uint32_t cells=pattern_draw(&p, expect, 0, 0, PATTERN_ROT_0, NULL);
+            for (int r=PATTERN_ROT_0;r<=PATTERN_ROT_270;r++) {
+                for (int x=-20;x<SCRN_WIDTH;x+=13) {
+                    for (int y=-20;y<SCRN_HEIGHT;y+=7) {
+                        scrn_tiles_t tiles;
+                        int w=p.width, h=p.height;
+                        scrn_tiles_clear(&tiles);
+                        memset(frame_a, 0, SCRN_BUF_SIZE);
+                        if (pattern_draw(&p, frame_a, x, y, r, &tiles)!=cells) wrong++;
+                        draws++;
+                        bool ok=true;
+                        for (int cx=0;cx<w;cx++) {
+                            for (int cy=0;cy<h;cy++) {
+                                int tx=r==0 ? cx : r==1 ? h-1-cy : r==2 ? w-1-cx : cy;
+                                int ty=r==0 ? cy : r==1 ? cx : r==2 ? h-1-cy : w-1-cx;
+                                int sx=(x+tx)&(SCRN_WIDTH-1), sy=(y+ty)&(SCRN_HEIGHT-1);
+                                if (get_pixel(cx, cy, expect)!=get_pixel(sx, sy, frame_a)) ok=false;
+                            }
+                        }
+                        wrong+=!ok;
+                        for (int b=0;b<SCRN_BUF_SIZE;b++) {
+                            int page=b/SCRN_WIDTH, tile=(b%SCRN_WIDTH)/SCRN_TILE_COLS;
+                            if (frame_a[b] && !(tiles.rows[page]&(1<<tile))) tiles_wrong++;
+                        }
+                    }
+                }
+            }
+        }
+        for (int m=0;m<sizeof(pattern_motion)/sizeof(pattern_motion[0]);m++) {
+            int i=pattern_find(&pack, pattern_motion[m].name);
+            if (i<0 || !pattern_get(&pack, i, &p)) {
+                moves_wrong++;
+                continue;
+            }
+            memset(frame_a, 0, SCRN_BUF_SIZE);
+            memset(expect, 0, SCRN_BUF_SIZE);
+            pattern_draw(&p, frame_a, 40, 20, PATTERN_ROT_0, NULL);
+            pattern_draw(&p, expect, 40+pattern_motion[m].dx, 20+pattern_motion[m].dy, PATTERN_ROT_0, NULL);
+            for (int g=0;g<pattern_motion[m].period;g++) {
+                life_step(frame_a, frame_b);
+                memcpy(frame_a, frame_b, SCRN_BUF_SIZE);
+            }
+            if (memcmp(frame_a, expect, SCRN_BUF_SIZE)) moves_wrong++;
+        }
+        //What the life effect starts with
+        memset(expect, 0, SCRN_BUF_SIZE);
+        for (int i=0;i<sizeof(glider_gun);i+=2) {
+            set_pixel(glider_gun[i], glider_gun[i+1], 1, expect);
+        }
+        memset(frame_a, 0, SCRN_BUF_SIZE);
+        int gun=pattern_find(&pack, "Gosper glider gun");
+        if (gun<0 || !pattern_get(&pack, gun, &p)) {
+            moves_wrong++;
+        } else {
+            pattern_draw(&p, frame_a, 50, 46, PATTERN_ROT_0, NULL);
+            if (memcmp(frame_a, expect, SCRN_BUF_SIZE)) moves_wrong++;
+            bench_pattern=p;
+            bench_rotation=PATTERN_ROT_0;
+            bench_run("pattern_draw gun", bench_pattern_draw, 1, "patterns");
+        }
+        printf("%-32s %8d draws of %u patterns %d wrong, %d bytes outside the tiles, %d wrong motions\n",
+                "pattern/rotations", draws, (unsigned) pack.count, wrong, tiles_wrong, moves_wrong);
+        pattern_pack_close(&pack);
+    }
+
+    uint32_t length;
+    char *soup=pattern_soup(1024, &length);
+    if (!pattern_parse(&bench_pattern, "Soup", soup, length)) {
+        printf("%-32s does not parse\n", "pattern/soup");
+    } else {
+        memset(frame_a, 0, SCRN_BUF_SIZE);
+        uint32_t cells=pattern_draw(&bench_pattern, frame_a, 0, 0, PATTERN_ROT_0, NULL);
+        printf("%-32s %8u bytes %u live cells of %ux%u\n", "pattern/soup", (unsigned) length, (unsigned) cells,
+                (unsigned) bench_pattern.width, (unsigned) bench_pattern.height);
+        bench_rotation=PATTERN_ROT_0;
+        bench_run("pattern_draw soup 1024", bench_pattern_draw, length, "bytes");
+        bench_rotation=PATTERN_ROT_90;
+        bench_run("pattern_draw soup 1024 turned", bench_pattern_draw, length, "bytes");
+    }
+    free(soup);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc>1) filter=argv[1];
+    //The patterns partition the Makefile builds next to the benchmarks
+    char pack[512];
+    const char *slash=strrchr(argv[0], '/');
+    snprintf(pack, sizeof(pack), "%.*spatterns.bin", slash ? (int) (slash-argv[0]+1) : 0, argv[0]);
+    host_partition_file(PATTERN_PARTITION, PATTERN_PARTITION_SUBTYPE, pack);
+
+    fill_random(frame_a, 0);
+    bench_run("set_pixel", bench_set_pixel, SCRN_WIDTH*SCRN_HEIGHT, "pixels");
+    bench_run("get_pixel", bench_get_pixel, SCRN_WIDTH*SCRN_HEIGHT, "pixels");
+    bench_run("set_rect 100x50", bench_set_rect, 100*50, "pixels");
+    bench_set_rect_check();
+    bench_gfx();
+
+    fill_random(frame_a, 0);
+    bench_run("life_step", bench_life_step, 2, "gens");
+    fill_random(frame_a, 0);
+    bench_run("life_step_scalar", bench_life_step_scalar, 2, "gens");
+    bench_life_check();
+
+    memset(frame_a, 0, SCRN_BUF_SIZE);
+    for (int i=0;i<sizeof(glider_gun);i+=2) {
+        set_pixel(glider_gun[i], glider_gun[i+1], 1, frame_a);
+    }
+    bench_life_run("gun", frame_a, 0, 300);
+    fill_random(frame_a, 3);
+    bench_life_run("soup", frame_a, 0, 300);
+    bench_life_run("settled soup", frame_a, 3000, 5000);
+    //Blocks only, nothing ever changes
+    memset(frame_a, 0, SCRN_BUF_SIZE);
+    for (int x=4;x<SCRN_WIDTH-4;x+=12) {
+        for (int y=4;y<SCRN_HEIGHT-4;y+=12) {
+            set_rect(x, y, 2, 2, frame_a);
+        }
+    }
+    bench_life_run("still", frame_a, 10, 5000);
+    bench_life_rules();
+    bench_cycle();
+    bench_patterns();
+
+    bench_hashlife(HASHLIFE_MAX_NODES, 0, 1000, 0);
+    bench_hashlife(HASHLIFE_MAX_NODES, 4, 200, 0);
+    bench_hashlife(HASHLIFE_MAX_NODES, 10, 100, 0);
+    bench_hashlife(HASHLIFE_MAX_NODES, 16, 100, 0);
+    bench_hashlife(HASHLIFE_MAX_NODES, 20, 100, 0);
+    bench_hashlife(HASHLIFE_MAX_NODES, 40, 100, 0);
+    bench_hashlife(65536, 20, 100, 0);
+    bench_hashlife(65536, 40, 100, 0);
+    bench_hashlife(HASHLIFE_MAX_NODES, 16, 100, 64);
+    bench_hashlife(HASHLIFE_MAX_NODES, 16, 100, 16);
+
+    bench_input();
+    bench_trace();
+
+    bench_text();
+
+    memset(frame_a, 0, SCRN_BUF_SIZE);
+    bench_run("langton_ant_move", bench_langton, 1000, "steps");
+
+    if (bench_selected("turmite") || bench_selected("send_lines") || bench_selected("flush") || bench_selected("frame")
+            || bench_selected("compose") || bench_selected("wall") || bench_selected("stream")
+            || bench_selected("effects")) {
+        //Count what goes over the bus, without waiting for it
+        host_spi_set_realtime(false);
+        spi_device_handle_t spi=scrn_open();
+        static scrn_delta_t scrn;
+        static scrn_flush_t flush;
+        scrn_delta_init(&scrn, spi);
+        scrn_flush_init(&flush, spi);
+        bench_turmite(spi, &scrn, "LR", 1, 64);
+        bench_turmite(spi, &scrn, "LR", 1, 1<<20);
+        bench_turmite(spi, &scrn, "LLRR", 16, 64);
+        bench_turmite(spi, &scrn, "RLLRLRRLRLLR", 16, 1<<16);
+        bench_flush(spi, &flush, &scrn, "life", workload_life);
+        bench_flush(spi, &flush, &scrn, "ant", workload_ant);
+        bench_flush(spi, &flush, &scrn, "static", workload_static);
+        bench_flush_overlap(spi, &flush);
+        bench_compose(spi, &scrn);
+        bench_wall();
+        bench_stream(spi);
+        bench_effects(spi, &scrn);
+    }
+    return 0;
+}
@@ -0,0 +1,18 @@
+#ifndef HOST_ESP_HEAP_CAPS_H
+#define HOST_ESP_HEAP_CAPS_H
+
+#include <stddef.h>
+
+#define MALLOC_CAP_EXEC (1<<0)
+#define MALLOC_CAP_32BIT (1<<1)
+#define MALLOC_CAP_8BIT (1<<2)
+#define MALLOC_CAP_DMA (1<<3)
+#define MALLOC_CAP_INTERNAL (1<<11)
+#define MALLOC_CAP_DEFAULT (1<<12)
+
+//Word aligned like the ESP32 heap, with the live and peak totals kept
+void *heap_caps_malloc(size_t size, int caps);
+void heap_caps_free(void *ptr);
+size_t heap_caps_get_free_size(int caps);
+
+#endif
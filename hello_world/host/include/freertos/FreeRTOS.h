@@ -0,0 +1,35 @@
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+//Just enough of FreeRTOS to run the firmware on Linux: tasks are pthreads,
+//ticks follow the monotonic clock at CONFIG_FREERTOS_HZ.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <assert.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "esp_heap_caps.h"
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define configTICK_RATE_HZ CONFIG_FREERTOS_HZ
+#define portTICK_PERIOD_MS (1000/configTICK_RATE_HZ)
+#define portTICK_RATE_MS portTICK_PERIOD_MS
+#define portMAX_DELAY ((TickType_t) 0xffffffff)
+#define portNUM_PROCESSORS 2
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdFAIL pdFALSE
+#define pdPASS pdTRUE
+#define pdMS_TO_TICKS(ms) ((TickType_t) ((ms)*configTICK_RATE_HZ/1000))
+
+#define portYIELD_FROM_ISR()
+#define DRAM_ATTR
+#define IRAM_ATTR
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef HOST_FREERTOS_SEMPHR_H
+#define HOST_FREERTOS_SEMPHR_H
+
+#include "freertos/queue.h"
+
+//As in FreeRTOS, semaphores are queues of zero sized items
+typedef QueueHandle_t SemaphoreHandle_t;
+
+#define xSemaphoreCreateBinary() xQueueCreate(1, 0)
+#define xSemaphoreCreateCounting(max, initial) host_semaphore_create_counting(max, initial)
+#define xSemaphoreGive(s) xQueueSend(s, NULL, 0)
+#define xSemaphoreGiveFromISR(s, woken) xQueueSend(s, NULL, 0)
+#define xSemaphoreTake(s, wait) xQueueReceive(s, NULL, wait)
+#define vSemaphoreDelete(s) vQueueDelete(s)
+
+QueueHandle_t host_semaphore_create_counting(UBaseType_t max, UBaseType_t initial);
+
+#endif
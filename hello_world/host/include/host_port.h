@@ -0,0 +1,88 @@
+#ifndef HOST_PORT_H
+#define HOST_PORT_H
+
+//Controls and measurements of the Linux stand-ins, not part of ESP-IDF
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "driver/spi_master.h"
+#include "driver/uart.h"
+
+//What a screen on an SPI device currently holds. Commands and data are
+//decoded as the SH1106 does, the D/C line being read from DC_PIN, plus the
+//SSD1306 horizontal addressing mode. The visible window starts at
+//SCRN_COL_OFFSET.
+#define HOST_PANEL_PAGES 8
+#define HOST_PANEL_COLUMNS 132
+
+typedef struct {
+    uint8_t ram[HOST_PANEL_PAGES][HOST_PANEL_COLUMNS];
+    uint8_t page;
+    uint8_t column;
+    uint8_t cmd;                     //Last command, while its parameters come in
+    uint8_t params[2];
+    uint8_t skip;                    //Parameter bytes of the last command still to come
+    bool horizontal;                 //SSD1306 horizontal addressing, wrapping in the window below
+    uint8_t col_start, col_end;
+    uint8_t page_start, page_end;
+    uint32_t commands;
+    uint32_t data_bytes;
+} host_panel_t;
+
+host_panel_t *host_panel(spi_device_handle_t dev);
+//Copy the visible 128x64 window out in page format
+void host_panel_read(spi_device_handle_t dev, uint8_t *frame);
+int host_panel_write_pbm(spi_device_handle_t dev, const char *path);
+int host_frame_write_pbm(const uint8_t *frame, const char *path);
+
+typedef struct {
+    uint32_t transactions;
+    uint64_t bytes;
+    uint64_t bus_ns;                 //Time the transactions take on the wire
+    uint64_t blocked_ns;             //Time callers spent waiting in spi_device_get_trans_result
+} host_spi_stats_t;
+
+//The device most recently attached to any bus
+spi_device_handle_t host_spi_last_device(void);
+void host_spi_get_stats(spi_device_handle_t dev, host_spi_stats_t *stats);
+void host_spi_reset_stats(spi_device_handle_t dev);
+//Times the bus ran out of queued transactions, on any of its devices, since
+//it was initialized
+uint32_t host_spi_bus_idle(spi_host_device_t host);
+//With realtime on (the default), a transaction completes after the time it
+//would take on the wire at the device clock, plus HOST_SPI_TRANS_OVERHEAD_NS.
+//Off, it completes as soon as the bus thread gets to it.
+#define HOST_SPI_TRANS_OVERHEAD_NS 8000
+void host_spi_set_realtime(bool realtime);
+
+//Drive an input pin from the outside, running its interrupt handler if the
+//change is an edge it wants
+void host_gpio_set_input(int gpio_num, int level);
+//Replay a timeline of input changes from a file, in the background. Each
+//line is "ms pin level", in time order, ms counted from the call and pin a
+//GPIO number or one of U L D R C MODE. # starts a comment.
+//Returns -1 if the file cannot be read.
+int host_gpio_replay(const char *path);
+
+//Make the file at path a data partition called label, for
+//esp_partition_find_first to find and esp_partition_mmap to map. It is read
+//when it is used. False if it cannot be stat'ed or there are too many.
+bool host_partition_file(const char *label, uint8_t subtype, const char *path);
+
+//Make uart read and write the tty at path once uart_driver_install is called
+bool host_uart_file(uart_port_t uart, const char *path);
+//Make uart the master end of a new pseudo terminal, raw, and return the path
+//of the other end for the peer to open. NULL if there is none to be had.
+const char *host_uart_pty(uart_port_t uart);
+
+int64_t host_time_us(void);
+void host_sleep_until_us(int64_t t);
+//Live and peak bytes handed out by heap_caps_malloc
+size_t host_heap_in_use(void);
+size_t host_heap_peak(void);
+void host_heap_reset_peak(void);
+//Make heap_caps_malloc fail past bytes in use, as a busy ESP32 heap would. 0
+//for no limit.
+void host_heap_limit(size_t bytes);
+
+#endif
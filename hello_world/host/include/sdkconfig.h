@@ -0,0 +1,11 @@
+//The sdkconfig values the firmware sources rely on, matching ../../sdkconfig
+#ifndef HOST_SDKCONFIG_H
+#define HOST_SDKCONFIG_H
+
+#define CONFIG_FREERTOS_HZ 100
+#define CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ 240
+#define CONFIG_CONSOLE_UART_NUM 0
+#define CONFIG_CONSOLE_UART_BAUDRATE 115200
+#define CONFIG_MONITOR_BAUD 115200
+
+#endif
@@ -0,0 +1,4 @@
+#ifndef HOST_SOC_GPIO_STRUCT_H
+#define HOST_SOC_GPIO_STRUCT_H
+
+#endif
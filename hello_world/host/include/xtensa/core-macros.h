@@ -0,0 +1,19 @@
+#ifndef HOST_XTENSA_CORE_MACROS_H
+#define HOST_XTENSA_CORE_MACROS_H
+
+#include <stdint.h>
+#include <time.h>
+#include "sdkconfig.h"
+
+//The CPU cycle counter, from the monotonic clock at the CPU frequency. The
+//cores share it here, unlike on the chip.
+static inline uint32_t host_get_ccount(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t) (((uint64_t) ts.tv_sec*1000000000+ts.tv_nsec)*CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ/1000);
+}
+
+#define XTHAL_GET_CCOUNT() host_get_ccount()
+
+#endif
@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pattern.h"
+
+//Packs RLE files for the patterns partition (see pattern.h). A pattern is
+//named by its "#N" line, or after its file if it has none.
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: pattern_pack out.bin file.rle...\n");
+    exit(2);
+}
+
+static char *read_file(const char *path, uint32_t *length)
+{
+    FILE *f=fopen(path, "rb");
+    if (f==NULL) return NULL;
+    fseek(f, 0, SEEK_END);
+    long n=ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *data=malloc(n ? n : 1);
+    if (data && fread(data, 1, n, f)!=(size_t) n) {
+        free(data);
+        data=NULL;
+    }
+    fclose(f);
+    *length=n;
+    return data;
+}
+
+static void pattern_name(char *name, const char *path, const char *rle, uint32_t length)
+{
+    for (const char *s=rle;s<rle+length;) {
+        const char *eol=memchr(s, '\n', rle+length-s);
+        if (eol==NULL) eol=rle+length;
+        if (*s!='#') break;
+        if (eol-s>3 && s[1]=='N' && s[2]==' ') {
+            int n=eol-s-3;
+            while (n && (s[3+n-1]=='\r' || s[3+n-1]==' ')) n--;
+            snprintf(name, PATTERN_NAME_LEN, "%.*s", n, s+3);
+            return;
+        }
+        s=eol+1;
+    }
+    const char *base=strrchr(path, '/');
+    base=base ? base+1 : path;
+    const char *dot=strrchr(base, '.');
+    snprintf(name, PATTERN_NAME_LEN, "%.*s", (int) (dot ? dot-base : (long) strlen(base)), base);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc<3) usage();
+    uint32_t count=argc-2;
+    pattern_pack_header_t header={.magic=PATTERN_PACK_MAGIC, .count=count};
+    pattern_pack_entry_t *entries=calloc(count, sizeof(*entries));
+    char **files=calloc(count, sizeof(*files));
+    uint32_t offset=sizeof(header)+count*sizeof(*entries);
+    for (uint32_t i=0;i<count;i++) {
+        const char *path=argv[i+2];
+        pattern_t p;
+        files[i]=read_file(path, &entries[i].length);
+        if (files[i]==NULL) {
+            perror(path);
+            return 1;
+        }
+        pattern_name(entries[i].name, path, files[i], entries[i].length);
+        if (!pattern_parse(&p, entries[i].name, files[i], entries[i].length)) {
+            fprintf(stderr, "%s: no \"x = ..., y = ...\" header\n", path);
+            return 1;
+        }
+        for (uint32_t j=0;j<i;j++) {
+            if (!strcmp(entries[j].name, entries[i].name)) {
+                fprintf(stderr, "%s: a pattern is already called %s\n", path, entries[i].name);
+                return 1;
+            }
+        }
+        entries[i].offset=offset;
+        offset=(offset+entries[i].length+3)&~3;
+    }
+    header.size=offset;
+
+    FILE *out=fopen(argv[1], "wb");
+    if (out==NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+    static const uint8_t pad[4];
+    fwrite(&header, sizeof(header), 1, out);
+    fwrite(entries, sizeof(*entries), count, out);
+    for (uint32_t i=0;i<count;i++) {
+        fwrite(files[i], 1, entries[i].length, out);
+        fwrite(pad, 1, -entries[i].length&3, out);
+    }
+    if (fclose(out)!=0) {
+        perror(argv[1]);
+        return 1;
+    }
+    printf("%s: %u patterns, %u bytes\n", argv[1], (unsigned) count, (unsigned) header.size);
+    for (uint32_t i=0;i<count;i++) free(files[i]);
+    free(files);
+    free(entries);
+    return 0;
+}
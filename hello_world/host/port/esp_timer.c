@@ -0,0 +1,137 @@
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+#include "esp_timer.h"
+#include "host_port.h"
+
+//One thread plays the esp_timer task: it sleeps until the first armed timer
+//is due and runs the callbacks in turn, without the lock held.
+
+struct esp_timer {
+    esp_timer_create_args_t args;
+    bool armed;
+    int64_t due_us;
+    uint64_t period_us;              //0 for one-shot
+    struct esp_timer *next;
+};
+
+static pthread_mutex_t lock=PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t changed;
+static struct esp_timer *timers;
+static bool started;
+
+static void *host_timer_main(void *arg)
+{
+    (void) arg;
+    pthread_mutex_lock(&lock);
+    while (1) {
+        struct esp_timer *first=NULL;
+        for (struct esp_timer *t=timers;t;t=t->next) {
+            if (t->armed && (first==NULL || t->due_us<first->due_us)) first=t;
+        }
+        if (first==NULL) {
+            pthread_cond_wait(&changed, &lock);
+            continue;
+        }
+        int64_t now=host_time_us();
+        if (first->due_us>now) {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            int64_t ns=ts.tv_nsec+(first->due_us-now)*1000;
+            ts.tv_sec+=ns/1000000000;
+            ts.tv_nsec=ns%1000000000;
+            pthread_cond_timedwait(&changed, &lock, &ts);
+            continue;
+        }
+        if (first->period_us) {
+            first->due_us+=first->period_us;
+        } else {
+            first->armed=false;
+        }
+        esp_timer_cb_t callback=first->args.callback;
+        void *cb_arg=first->args.arg;
+        pthread_mutex_unlock(&lock);
+        callback(cb_arg);
+        pthread_mutex_lock(&lock);
+    }
+    return NULL;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle)
+{
+    if (create_args==NULL || create_args->callback==NULL || out_handle==NULL) return ESP_ERR_INVALID_ARG;
+    struct esp_timer *t=calloc(1, sizeof(struct esp_timer));
+    if (t==NULL) return ESP_ERR_NO_MEM;
+    t->args=*create_args;
+    pthread_mutex_lock(&lock);
+    if (!started) {
+        pthread_condattr_t attr;
+        pthread_condattr_init(&attr);
+        pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+        pthread_cond_init(&changed, &attr);
+        pthread_condattr_destroy(&attr);
+        pthread_t thread;
+        pthread_create(&thread, NULL, host_timer_main, NULL);
+        pthread_detach(thread);
+        started=true;
+    }
+    t->next=timers;
+    timers=t;
+    pthread_mutex_unlock(&lock);
+    *out_handle=t;
+    return ESP_OK;
+}
+
+static esp_err_t host_timer_start(esp_timer_handle_t t, uint64_t after_us, uint64_t period_us)
+{
+    esp_err_t ret=ESP_OK;
+    pthread_mutex_lock(&lock);
+    if (t->armed) {
+        ret=ESP_ERR_INVALID_STATE;
+    } else {
+        t->armed=true;
+        t->due_us=host_time_us()+after_us;
+        t->period_us=period_us;
+        pthread_cond_broadcast(&changed);
+    }
+    pthread_mutex_unlock(&lock);
+    return ret;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    return host_timer_start(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period)
+{
+    return host_timer_start(timer, period, period);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    esp_err_t ret=ESP_OK;
+    pthread_mutex_lock(&lock);
+    if (!timer->armed) ret=ESP_ERR_INVALID_STATE;
+    timer->armed=false;
+    pthread_mutex_unlock(&lock);
+    return ret;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    pthread_mutex_lock(&lock);
+    if (timer->armed) {
+        pthread_mutex_unlock(&lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    for (struct esp_timer **p=&timers;*p;p=&(*p)->next) {
+        if (*p==timer) {
+            *p=timer->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+    free(timer);
+    return ESP_OK;
+}
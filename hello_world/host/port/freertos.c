@@ -0,0 +1,226 @@
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <pthread.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "host_port.h"
+
+struct host_task {
+    pthread_t thread;
+    TaskFunction_t fn;
+    void *arg;
+    BaseType_t core;
+};
+
+static __thread BaseType_t current_core;
+static __thread struct host_task *current_task;
+
+static void *host_task_main(void *arg)
+{
+    struct host_task *task=arg;
+    current_core=task->core==tskNO_AFFINITY ? 0 : task->core;
+    current_task=task;
+    task->fn(task->arg);
+    free(task);
+    return NULL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_depth,
+        void *arg, UBaseType_t priority, TaskHandle_t *handle, BaseType_t core)
+{
+    (void) name;
+    (void) stack_depth;
+    (void) priority;
+    struct host_task *task=calloc(1, sizeof(struct host_task));
+    if (task==NULL) return pdFAIL;
+    task->fn=fn;
+    task->arg=arg;
+    task->core=core;
+    if (pthread_create(&task->thread, NULL, host_task_main, task)!=0) {
+        free(task);
+        return pdFAIL;
+    }
+    pthread_detach(task->thread);
+    if (handle) *handle=task;
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack_depth,
+        void *arg, UBaseType_t priority, TaskHandle_t *handle)
+{
+    return xTaskCreatePinnedToCore(fn, name, stack_depth, arg, priority, handle, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    //Only tasks ending themselves are supported
+    assert(task==NULL);
+    free(current_task);
+    pthread_exit(NULL);
+}
+
+static int64_t tick_to_us(TickType_t tick)
+{
+    return (int64_t) tick*1000000/configTICK_RATE_HZ;
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t) (host_time_us()*configTICK_RATE_HZ/1000000);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    if (ticks==0) {
+        sched_yield();
+        return;
+    }
+    //Like the real thing, wake on a tick boundary
+    host_sleep_until_us(tick_to_us(xTaskGetTickCount()+ticks));
+}
+
+void vTaskDelayUntil(TickType_t *previous_wake, TickType_t increment)
+{
+    *previous_wake+=increment;
+    if ((int32_t) (*previous_wake-xTaskGetTickCount())>0) {
+        host_sleep_until_us(tick_to_us(*previous_wake));
+    }
+}
+
+BaseType_t xPortGetCoreID(void)
+{
+    return current_core;
+}
+
+struct host_queue {
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t head;
+    UBaseType_t count;
+    uint8_t items[];
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    QueueHandle_t q=calloc(1, sizeof(struct host_queue)+length*item_size);
+    if (q==NULL) return NULL;
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&q->changed, &attr);
+    pthread_condattr_destroy(&attr);
+    q->length=length;
+    q->item_size=item_size;
+    return q;
+}
+
+QueueHandle_t host_semaphore_create_counting(UBaseType_t max, UBaseType_t initial)
+{
+    QueueHandle_t q=xQueueCreate(max, 0);
+    if (q) q->count=initial;
+    return q;
+}
+
+void vQueueDelete(QueueHandle_t q)
+{
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->changed);
+    free(q);
+}
+
+//Wait on the queue condition until the deadline, false on timeout
+static bool host_queue_wait(QueueHandle_t q, TickType_t wait, const struct timespec *deadline)
+{
+    if (wait==0) return false;
+    if (wait==portMAX_DELAY) {
+        pthread_cond_wait(&q->changed, &q->lock);
+        return true;
+    }
+    return pthread_cond_timedwait(&q->changed, &q->lock, deadline)==0;
+}
+
+static void host_queue_deadline(TickType_t wait, struct timespec *deadline)
+{
+    clock_gettime(CLOCK_MONOTONIC, deadline);
+    if (wait==portMAX_DELAY) return;
+    int64_t ns=deadline->tv_nsec+(int64_t) wait*(1000000000/configTICK_RATE_HZ);
+    deadline->tv_sec+=ns/1000000000;
+    deadline->tv_nsec=ns%1000000000;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t wait)
+{
+    struct timespec deadline;
+    host_queue_deadline(wait, &deadline);
+    pthread_mutex_lock(&q->lock);
+    while (q->count==q->length) {
+        if (!host_queue_wait(q, wait, &deadline)) {
+            pthread_mutex_unlock(&q->lock);
+            return pdFALSE;
+        }
+    }
+    if (q->item_size) {
+        memcpy(q->items+((q->head+q->count)%q->length)*q->item_size, item, q->item_size);
+    }
+    q->count++;
+    pthread_cond_broadcast(&q->changed);
+    pthread_mutex_unlock(&q->lock);
+    return pdTRUE;
+}
+
+static BaseType_t host_queue_take(QueueHandle_t q, void *item, TickType_t wait, bool remove)
+{
+    struct timespec deadline;
+    host_queue_deadline(wait, &deadline);
+    pthread_mutex_lock(&q->lock);
+    while (q->count==0) {
+        if (!host_queue_wait(q, wait, &deadline)) {
+            pthread_mutex_unlock(&q->lock);
+            return pdFALSE;
+        }
+    }
+    if (q->item_size) {
+        memcpy(item, q->items+q->head*q->item_size, q->item_size);
+    }
+    if (remove) {
+        q->head=(q->head+1)%q->length;
+        q->count--;
+        pthread_cond_broadcast(&q->changed);
+    }
+    pthread_mutex_unlock(&q->lock);
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t wait)
+{
+    return host_queue_take(q, item, wait, true);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t q, void *item, TickType_t wait)
+{
+    return host_queue_take(q, item, wait, false);
+}
+
+BaseType_t xQueueReset(QueueHandle_t q)
+{
+    pthread_mutex_lock(&q->lock);
+    q->head=0;
+    q->count=0;
+    pthread_cond_broadcast(&q->changed);
+    pthread_mutex_unlock(&q->lock);
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q)
+{
+    pthread_mutex_lock(&q->lock);
+    UBaseType_t n=q->count;
+    pthread_mutex_unlock(&q->lock);
+    return n;
+}
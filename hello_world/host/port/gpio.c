@@ -0,0 +1,163 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "driver/gpio.h"
+#include "host_port.h"
+#include "pins.h"
+
+//Inputs read low unless pulled up or driven with host_gpio_set_input
+static volatile int levels[GPIO_NUM_MAX];
+static gpio_int_type_t intr_types[GPIO_NUM_MAX];
+static gpio_isr_t handlers[GPIO_NUM_MAX];
+static void *handler_args[GPIO_NUM_MAX];
+//Held while a handler runs, as only one interrupt runs at a time on a core
+static pthread_mutex_t isr_lock=PTHREAD_MUTEX_INITIALIZER;
+
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t mode)
+{
+    (void) mode;
+    if (gpio_num<0 || gpio_num>=GPIO_NUM_MAX) return ESP_ERR_INVALID_ARG;
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_pull_mode(gpio_num_t gpio_num, gpio_pull_mode_t pull)
+{
+    if (gpio_num<0 || gpio_num>=GPIO_NUM_MAX) return ESP_ERR_INVALID_ARG;
+    if (pull==GPIO_PULLUP_ONLY) levels[gpio_num]=1;
+    if (pull==GPIO_PULLDOWN_ONLY) levels[gpio_num]=0;
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level)
+{
+    if (gpio_num<0 || gpio_num>=GPIO_NUM_MAX) return ESP_ERR_INVALID_ARG;
+    levels[gpio_num]=level ? 1 : 0;
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num)
+{
+    if (gpio_num<0 || gpio_num>=GPIO_NUM_MAX) return 0;
+    return levels[gpio_num];
+}
+
+esp_err_t gpio_set_intr_type(gpio_num_t gpio_num, gpio_int_type_t intr_type)
+{
+    if (gpio_num<0 || gpio_num>=GPIO_NUM_MAX) return ESP_ERR_INVALID_ARG;
+    intr_types[gpio_num]=intr_type;
+    return ESP_OK;
+}
+
+esp_err_t gpio_install_isr_service(int intr_alloc_flags)
+{
+    static bool installed;
+    (void) intr_alloc_flags;
+    if (installed) return ESP_ERR_INVALID_STATE;
+    installed=true;
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_add(gpio_num_t gpio_num, gpio_isr_t isr_handler, void *args)
+{
+    if (gpio_num<0 || gpio_num>=GPIO_NUM_MAX) return ESP_ERR_INVALID_ARG;
+    pthread_mutex_lock(&isr_lock);
+    handlers[gpio_num]=isr_handler;
+    handler_args[gpio_num]=args;
+    pthread_mutex_unlock(&isr_lock);
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_remove(gpio_num_t gpio_num)
+{
+    return gpio_isr_handler_add(gpio_num, NULL, NULL);
+}
+
+void host_gpio_set_input(int gpio_num, int level)
+{
+    if (gpio_num<0 || gpio_num>=GPIO_NUM_MAX) return;
+    level=level ? 1 : 0;
+    pthread_mutex_lock(&isr_lock);
+    int old=levels[gpio_num];
+    levels[gpio_num]=level;
+    gpio_int_type_t type=intr_types[gpio_num];
+    bool fire=old!=level && (type==GPIO_INTR_ANYEDGE || (type==GPIO_INTR_POSEDGE && level) ||
+            (type==GPIO_INTR_NEGEDGE && !level));
+    if (fire && handlers[gpio_num]) handlers[gpio_num](handler_args[gpio_num]);
+    pthread_mutex_unlock(&isr_lock);
+}
+
+typedef struct {
+    int64_t at_us;
+    int pin;
+    int level;
+} host_gpio_change_t;
+
+typedef struct {
+    host_gpio_change_t *changes;
+    int count;
+    int64_t start_us;
+} host_gpio_timeline_t;
+
+static int host_gpio_pin_number(const char *name)
+{
+    static const struct {
+        const char *name;
+        int pin;
+    } names[]={{"U", U_PIN}, {"L", L_PIN}, {"D", D_PIN}, {"R", R_PIN}, {"C", C_PIN}, {"MODE", MODE_PIN}};
+    for (int i=0;i<sizeof(names)/sizeof(names[0]);i++) {
+        if (!strcmp(name, names[i].name)) return names[i].pin;
+    }
+    char *end;
+    long pin=strtol(name, &end, 10);
+    return *end=='\0' ? (int) pin : -1;
+}
+
+static void *host_gpio_replay_main(void *arg)
+{
+    host_gpio_timeline_t *timeline=arg;
+    for (int i=0;i<timeline->count;i++) {
+        host_gpio_change_t *c=&timeline->changes[i];
+        host_sleep_until_us(timeline->start_us+c->at_us);
+        host_gpio_set_input(c->pin, c->level);
+    }
+    free(timeline->changes);
+    free(timeline);
+    return NULL;
+}
+
+int host_gpio_replay(const char *path)
+{
+    FILE *f=fopen(path, "r");
+    if (f==NULL) return -1;
+    host_gpio_timeline_t *timeline=calloc(1, sizeof(host_gpio_timeline_t));
+    int capacity=0;
+    char line[256];
+    timeline->start_us=host_time_us();
+    for (int n=1;fgets(line, sizeof(line), f);n++) {
+        char name[32];
+        double ms;
+        int level;
+        char *comment=strchr(line, '#');
+        if (comment) *comment='\0';
+        if (sscanf(line, " %lf %31s %d", &ms, name, &level)!=3) {
+            if (strspn(line, " \t\r\n")!=strlen(line)) fprintf(stderr, "%s:%d: expected \"ms pin level\"\n", path, n);
+            continue;
+        }
+        int pin=host_gpio_pin_number(name);
+        if (pin<0 || pin>=GPIO_NUM_MAX) {
+            fprintf(stderr, "%s:%d: unknown pin %s\n", path, n, name);
+            continue;
+        }
+        if (timeline->count==capacity) {
+            capacity=capacity ? 2*capacity : 64;
+            timeline->changes=realloc(timeline->changes, capacity*sizeof(host_gpio_change_t));
+        }
+        timeline->changes[timeline->count++]=(host_gpio_change_t) {(int64_t) (ms*1000), pin, level};
+    }
+    fclose(f);
+    pthread_t thread;
+    pthread_create(&thread, NULL, host_gpio_replay_main, timeline);
+    pthread_detach(thread);
+    return 0;
+}
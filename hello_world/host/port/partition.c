@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "esp_partition.h"
+#include "host_port.h"
+
+//Data partitions backed by files, laid out one after the other from where
+//the app would end on a 2MB flash
+#define HOST_PARTITIONS 4
+#define HOST_PARTITION_BASE 0x110000
+#define HOST_MMAPS 8
+
+typedef struct {
+    esp_partition_t part;
+    char path[256];
+} host_partition_t;
+
+typedef struct {
+    void *addr;
+    size_t len;
+} host_mmap_t;
+
+static host_partition_t partitions[HOST_PARTITIONS];
+static int partition_count;
+static uint32_t next_address=HOST_PARTITION_BASE;
+//Handle n is mmaps[n-1], 0 being no mapping
+static host_mmap_t mmaps[HOST_MMAPS];
+
+bool host_partition_file(const char *label, uint8_t subtype, const char *path)
+{
+    struct stat st;
+    if (partition_count==HOST_PARTITIONS || stat(path, &st)<0 || strlen(path)>=sizeof(partitions[0].path)) {
+        return false;
+    }
+    host_partition_t *p=&partitions[partition_count++];
+    p->part.type=ESP_PARTITION_TYPE_DATA;
+    p->part.subtype=(esp_partition_subtype_t) subtype;
+    p->part.address=next_address;
+    p->part.size=st.st_size;
+    snprintf(p->part.label, sizeof(p->part.label), "%s", label);
+    strcpy(p->path, path);
+    //Flash partitions start on 4K boundaries
+    next_address+=(st.st_size+0xFFF)&~0xFFF;
+    return true;
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+        const char *label)
+{
+    for (int i=0;i<partition_count;i++) {
+        const esp_partition_t *part=&partitions[i].part;
+        if (part->type!=type) continue;
+        if (subtype!=ESP_PARTITION_SUBTYPE_ANY && part->subtype!=subtype) continue;
+        if (label && strcmp(part->label, label)) continue;
+        return part;
+    }
+    return NULL;
+}
+
+static const char *partition_path(const esp_partition_t *partition)
+{
+    return ((const host_partition_t*) partition)->path;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size)
+{
+    if (src_offset>partition->size || size>partition->size-src_offset) return ESP_ERR_INVALID_SIZE;
+    int fd=open(partition_path(partition), O_RDONLY);
+    if (fd<0) return ESP_FAIL;
+    ssize_t n=pread(fd, dst, size, src_offset);
+    close(fd);
+    return n==(ssize_t) size ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t esp_partition_mmap(const esp_partition_t *partition, uint32_t offset, uint32_t size,
+        spi_flash_mmap_memory_t memory, const void **out_ptr, spi_flash_mmap_handle_t *out_handle)
+{
+    (void) memory;
+    if (offset>partition->size || size>partition->size-offset) return ESP_ERR_INVALID_SIZE;
+    int slot=0;
+    while (slot<HOST_MMAPS && mmaps[slot].addr) slot++;
+    if (slot==HOST_MMAPS) return ESP_ERR_NO_MEM;
+    int fd=open(partition_path(partition), O_RDONLY);
+    if (fd<0) return ESP_FAIL;
+    //Like the flash MMU, whole pages from below offset
+    long page=sysconf(_SC_PAGESIZE);
+    uint32_t start=offset&~(page-1);
+    size_t len=offset-start+size;
+    void *addr=mmap(NULL, len ? len : 1, PROT_READ, MAP_PRIVATE, fd, start);
+    close(fd);
+    if (addr==MAP_FAILED) return ESP_ERR_NO_MEM;
+    mmaps[slot].addr=addr;
+    mmaps[slot].len=len ? len : 1;
+    *out_ptr=(const uint8_t*) addr+(offset-start);
+    *out_handle=slot+1;
+    return ESP_OK;
+}
+
+void spi_flash_munmap(spi_flash_mmap_handle_t handle)
+{
+    if (handle==0 || handle>HOST_MMAPS || mmaps[handle-1].addr==NULL) return;
+    munmap(mmaps[handle-1].addr, mmaps[handle-1].len);
+    mmaps[handle-1].addr=NULL;
+}
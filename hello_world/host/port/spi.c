@@ -0,0 +1,307 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/prctl.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "driver/spi_master.h"
+#include "driver/gpio.h"
+#include "host_port.h"
+#include "pins.h"
+#include "display.h"
+
+//One thread per bus plays the part of the SPI hardware and its interrupt:
+//it takes queued transactions from the devices in turn, runs pre_cb, feeds
+//the bytes to the device's panel model, runs post_cb and posts the result.
+
+#define HOST_SPI_MAX_DEVICES 6
+#define HOST_SPI_DEFAULT_MAX_TRANSFER 4094
+
+typedef struct host_spi_bus host_spi_bus_t;
+
+//What the device queues hold: a transaction queued while the wire was busy
+//starts the moment the wire is free, however late the bus thread gets to it
+typedef struct {
+    spi_transaction_t *t;
+    int64_t queued_us;
+} host_spi_queued_t;
+
+struct host_spi_device {
+    host_spi_bus_t *bus;
+    spi_device_interface_config_t cfg;
+    QueueHandle_t trans_q;
+    QueueHandle_t ret_q;
+    host_panel_t panel;
+    host_spi_stats_t stats;
+};
+
+struct host_spi_bus {
+    bool initialized;
+    int max_transfer_sz;
+    struct host_spi_device *devices[HOST_SPI_MAX_DEVICES];
+    SemaphoreHandle_t pending;       //One count per queued transaction
+    int next;                        //Round robin position
+    int64_t wire_free_at;            //When the wire is done with what it was given
+    uint32_t idle;                   //Times it finished everything it was given
+    pthread_t thread;
+};
+
+static host_spi_bus_t buses[3];
+static spi_device_handle_t last_device;
+static volatile bool realtime=true;
+
+void host_spi_set_realtime(bool on)
+{
+    realtime=on;
+}
+
+//Parameter bytes following each SH1106/SSD1306 command
+static int host_panel_param_count(uint8_t cmd)
+{
+    switch (cmd) {
+        case 0x20: case 0x81: case 0x8D: case 0xA8: case 0xAD:
+        case 0xD3: case 0xD5: case 0xD9: case 0xDA: case 0xDB:
+            return 1;
+        case 0x21: case 0x22:
+            return 2;
+        default:
+            return 0;
+    }
+}
+
+//A command whose parameters have all arrived
+static void host_panel_command(host_panel_t *panel)
+{
+    switch (panel->cmd) {
+        case 0x20:
+            panel->horizontal=(panel->params[0]&3)==0;
+            break;
+        case 0x21:
+            panel->col_start=panel->column=panel->params[0];
+            panel->col_end=panel->params[1];
+            break;
+        case 0x22:
+            panel->page_start=panel->page=panel->params[0]&0x07;
+            panel->page_end=panel->params[1]&0x07;
+            break;
+    }
+}
+
+static void host_panel_feed(host_panel_t *panel, const uint8_t *bytes, int n, int dc)
+{
+    for (int i=0;i<n;i++) {
+        uint8_t b=bytes[i];
+        if (dc) {
+            if (panel->column<HOST_PANEL_COLUMNS) {
+                panel->ram[panel->page][panel->column]=b;
+            }
+            panel->column++;
+            if (panel->horizontal && panel->column>panel->col_end) {
+                panel->column=panel->col_start;
+                panel->page=panel->page>=panel->page_end ? panel->page_start : panel->page+1;
+            }
+            panel->data_bytes++;
+        } else if (panel->skip) {
+            int count=host_panel_param_count(panel->cmd);
+            panel->params[count-panel->skip]=b;
+            if (--panel->skip==0) host_panel_command(panel);
+        } else {
+            panel->commands++;
+            if (b<0x10) {
+                panel->column=(panel->column&0xF0)|b;
+            } else if (b<0x20) {
+                panel->column=(panel->column&0x0F)|((b&0x0F)<<4);
+            } else if ((b&0xF8)==0xB0) {
+                panel->page=b&0x07;
+            } else {
+                panel->cmd=b;
+                panel->skip=host_panel_param_count(b);
+            }
+        }
+    }
+}
+
+static void *host_spi_bus_main(void *arg)
+{
+    host_spi_bus_t *bus=arg;
+    //Wake up when the wire would be free, not up to 50us later
+    prctl(PR_SET_TIMERSLACK, 1);
+    while (1) {
+        if (xSemaphoreTake(bus->pending, 0)!=pdTRUE) {
+            bus->idle++;
+            xSemaphoreTake(bus->pending, portMAX_DELAY);
+        }
+        struct host_spi_device *dev=NULL;
+        host_spi_queued_t queued={NULL, 0};
+        for (int i=0;i<HOST_SPI_MAX_DEVICES && queued.t==NULL;i++) {
+            dev=bus->devices[(bus->next+i)%HOST_SPI_MAX_DEVICES];
+            if (dev && xQueueReceive(dev->trans_q, &queued, 0)==pdTRUE) {
+                bus->next=(bus->next+i+1)%HOST_SPI_MAX_DEVICES;
+            }
+        }
+        spi_transaction_t *t=queued.t;
+        if (t==NULL) continue;
+
+        int bytes=(t->length+7)/8;
+        const uint8_t *tx=(t->flags&SPI_TRANS_USE_TXDATA) ? t->tx_data : t->tx_buffer;
+        int64_t wire_ns=(int64_t) t->length*1000000000/dev->cfg.clock_speed_hz+HOST_SPI_TRANS_OVERHEAD_NS;
+        if (dev->cfg.pre_cb) dev->cfg.pre_cb(t);
+        if (realtime) {
+            if (bus->wire_free_at<queued.queued_us) bus->wire_free_at=queued.queued_us;
+            bus->wire_free_at+=wire_ns/1000;
+            host_sleep_until_us(bus->wire_free_at);
+        }
+        host_panel_feed(&dev->panel, tx, bytes, gpio_get_level(DC_PIN));
+        dev->stats.transactions++;
+        dev->stats.bytes+=bytes;
+        dev->stats.bus_ns+=wire_ns;
+        if (dev->cfg.post_cb) dev->cfg.post_cb(t);
+        xQueueSend(dev->ret_q, &t, portMAX_DELAY);
+    }
+    return NULL;
+}
+
+esp_err_t spi_bus_initialize(spi_host_device_t host, const spi_bus_config_t *bus_config, int dma_chan)
+{
+    (void) dma_chan;
+    if (host<SPI_HOST || host>VSPI_HOST) return ESP_ERR_INVALID_ARG;
+    host_spi_bus_t *bus=&buses[host];
+    if (bus->initialized) return ESP_ERR_INVALID_STATE;
+    memset(bus, 0, sizeof(*bus));
+    bus->max_transfer_sz=bus_config->max_transfer_sz ? bus_config->max_transfer_sz : HOST_SPI_DEFAULT_MAX_TRANSFER;
+    bus->pending=xSemaphoreCreateCounting(0xFFFF, 0);
+    bus->initialized=true;
+    pthread_create(&bus->thread, NULL, host_spi_bus_main, bus);
+    pthread_detach(bus->thread);
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_free(spi_host_device_t host)
+{
+    //The bus thread stays, there is nothing to give back to on a host
+    (void) host;
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_add_device(spi_host_device_t host, const spi_device_interface_config_t *dev_config, spi_device_handle_t *handle)
+{
+    if (host<SPI_HOST || host>VSPI_HOST || !buses[host].initialized) return ESP_ERR_INVALID_ARG;
+    host_spi_bus_t *bus=&buses[host];
+    for (int i=0;i<HOST_SPI_MAX_DEVICES;i++) {
+        if (bus->devices[i]==NULL) {
+            struct host_spi_device *dev=calloc(1, sizeof(struct host_spi_device));
+            dev->bus=bus;
+            dev->cfg=*dev_config;
+            dev->panel.col_end=HOST_PANEL_COLUMNS-1;
+            dev->panel.page_end=HOST_PANEL_PAGES-1;
+            dev->trans_q=xQueueCreate(dev_config->queue_size, sizeof(host_spi_queued_t));
+            dev->ret_q=xQueueCreate(dev_config->queue_size, sizeof(spi_transaction_t *));
+            bus->devices[i]=dev;
+            last_device=dev;
+            *handle=dev;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t spi_bus_remove_device(spi_device_handle_t handle)
+{
+    host_spi_bus_t *bus=handle->bus;
+    if (uxQueueMessagesWaiting(handle->trans_q) || uxQueueMessagesWaiting(handle->ret_q)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    for (int i=0;i<HOST_SPI_MAX_DEVICES;i++) {
+        if (bus->devices[i]==handle) bus->devices[i]=NULL;
+    }
+    if (last_device==handle) last_device=NULL;
+    vQueueDelete(handle->trans_q);
+    vQueueDelete(handle->ret_q);
+    free(handle);
+    return ESP_OK;
+}
+
+esp_err_t spi_device_queue_trans(spi_device_handle_t handle, spi_transaction_t *trans_desc, TickType_t ticks_to_wait)
+{
+    //Same limit the real driver enforces
+    if (trans_desc->length>(size_t) handle->bus->max_transfer_sz*8) return ESP_ERR_INVALID_ARG;
+    if ((trans_desc->flags&SPI_TRANS_USE_TXDATA) && trans_desc->length>32) return ESP_ERR_INVALID_ARG;
+    host_spi_queued_t queued={trans_desc, host_time_us()};
+    if (xQueueSend(handle->trans_q, &queued, ticks_to_wait)!=pdTRUE) return ESP_ERR_TIMEOUT;
+    xSemaphoreGive(handle->bus->pending);
+    return ESP_OK;
+}
+
+esp_err_t spi_device_get_trans_result(spi_device_handle_t handle, spi_transaction_t **trans_desc, TickType_t ticks_to_wait)
+{
+    int64_t start=host_time_us();
+    BaseType_t r=xQueueReceive(handle->ret_q, trans_desc, ticks_to_wait);
+    handle->stats.blocked_ns+=(host_time_us()-start)*1000;
+    return r==pdTRUE ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+esp_err_t spi_device_transmit(spi_device_handle_t handle, spi_transaction_t *trans_desc)
+{
+    spi_transaction_t *ret;
+    esp_err_t err=spi_device_queue_trans(handle, trans_desc, portMAX_DELAY);
+    if (err!=ESP_OK) return err;
+    return spi_device_get_trans_result(handle, &ret, portMAX_DELAY);
+}
+
+uint32_t host_spi_bus_idle(spi_host_device_t host)
+{
+    return buses[host].idle;
+}
+
+spi_device_handle_t host_spi_last_device(void)
+{
+    return last_device;
+}
+
+host_panel_t *host_panel(spi_device_handle_t dev)
+{
+    return &dev->panel;
+}
+
+void host_panel_read(spi_device_handle_t dev, uint8_t *frame)
+{
+    for (int p=0;p<HOST_PANEL_PAGES;p++) {
+        memcpy(frame+128*p, dev->panel.ram[p]+SCRN_COL_OFFSET, 128);
+    }
+}
+
+int host_frame_write_pbm(const uint8_t *frame, const char *path)
+{
+    FILE *f=fopen(path, "wb");
+    if (f==NULL) return -1;
+    fprintf(f, "P4\n128 64\n");
+    for (int y=0;y<64;y++) {
+        for (int xb=0;xb<16;xb++) {
+            uint8_t row=0;
+            for (int i=0;i<8;i++) {
+                if (frame[xb*8+i+128*(y/8)]&(1<<(y%8))) row|=0x80>>i;
+            }
+            fputc(row, f);
+        }
+    }
+    return fclose(f);
+}
+
+int host_panel_write_pbm(spi_device_handle_t dev, const char *path)
+{
+    uint8_t frame[HOST_PANEL_PAGES*128];
+    host_panel_read(dev, frame);
+    return host_frame_write_pbm(frame, path);
+}
+
+void host_spi_get_stats(spi_device_handle_t dev, host_spi_stats_t *stats)
+{
+    *stats=dev->stats;
+}
+
+void host_spi_reset_stats(spi_device_handle_t dev)
+{
+    memset(&dev->stats, 0, sizeof(dev->stats));
+}
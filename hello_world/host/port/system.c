@@ -0,0 +1,125 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "host_port.h"
+
+static int64_t start_us;
+
+static int64_t monotonic_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec*1000000+ts.tv_nsec/1000;
+}
+
+__attribute__((constructor)) static void host_time_init(void)
+{
+    start_us=monotonic_us();
+}
+
+int64_t host_time_us(void)
+{
+    return monotonic_us()-start_us;
+}
+
+void host_sleep_until_us(int64_t t)
+{
+    struct timespec ts;
+    t+=start_us;
+    ts.tv_sec=t/1000000;
+    ts.tv_nsec=(t%1000000)*1000;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL)!=0) {
+    }
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return host_time_us();
+}
+
+uint32_t esp_random(void)
+{
+    static uint32_t state=0x2545F491;
+    static pthread_mutex_t lock=PTHREAD_MUTEX_INITIALIZER;
+    pthread_mutex_lock(&lock);
+    //xorshift32, deterministic so runs can be compared
+    state^=state<<13;
+    state^=state>>17;
+    state^=state<<5;
+    uint32_t r=state;
+    pthread_mutex_unlock(&lock);
+    return r;
+}
+
+void esp_restart(void)
+{
+    exit(0);
+}
+
+//Each block carries its size in front so the totals can be kept
+typedef struct {
+    size_t size;
+    size_t pad;
+} heap_header_t;
+
+static pthread_mutex_t heap_lock=PTHREAD_MUTEX_INITIALIZER;
+static size_t heap_in_use, heap_peak, heap_limit;
+
+void *heap_caps_malloc(size_t size, int caps)
+{
+    (void) caps;
+    pthread_mutex_lock(&heap_lock);
+    bool fits=heap_limit==0 || heap_in_use+size<=heap_limit;
+    heap_header_t *h=fits ? malloc(sizeof(heap_header_t)+size) : NULL;
+    if (h) {
+        h->size=size;
+        heap_in_use+=size;
+        if (heap_in_use>heap_peak) heap_peak=heap_in_use;
+    }
+    pthread_mutex_unlock(&heap_lock);
+    return h ? h+1 : NULL;
+}
+
+void heap_caps_free(void *ptr)
+{
+    if (ptr==NULL) return;
+    heap_header_t *h=(heap_header_t *) ptr-1;
+    pthread_mutex_lock(&heap_lock);
+    heap_in_use-=h->size;
+    pthread_mutex_unlock(&heap_lock);
+    free(h);
+}
+
+size_t heap_caps_get_free_size(int caps)
+{
+    (void) caps;
+    //About what an ESP32 has left once WiFi and BT are out of the picture
+    size_t total=300*1024;
+    return heap_in_use<total ? total-heap_in_use : 0;
+}
+
+size_t host_heap_in_use(void)
+{
+    return heap_in_use;
+}
+
+size_t host_heap_peak(void)
+{
+    return heap_peak;
+}
+
+void host_heap_reset_peak(void)
+{
+    pthread_mutex_lock(&heap_lock);
+    heap_peak=heap_in_use;
+    pthread_mutex_unlock(&heap_lock);
+}
+
+void host_heap_limit(size_t bytes)
+{
+    heap_limit=bytes;
+}
@@ -0,0 +1,163 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+#include "driver/uart.h"
+#include "host_port.h"
+
+//Each UART reads and writes a file descriptor: a tty opened from a path, or
+//the master end of a pseudo terminal whose other end the peer opens.
+//uart_driver_install opens the path, or takes over the pty.
+
+typedef struct {
+    char path[256];
+    int fd;                          //Of the pty master, or once installed
+    bool installed;
+    uint32_t baudrate;
+} host_uart_t;
+
+static host_uart_t uarts[UART_NUM_MAX]={{.fd=-1}, {.fd=-1}, {.fd=-1}};
+
+bool host_uart_file(uart_port_t uart, const char *path)
+{
+    if (uart<0 || uart>=UART_NUM_MAX || strlen(path)>=sizeof(uarts[0].path)) return false;
+    snprintf(uarts[uart].path, sizeof(uarts[uart].path), "%s", path);
+    return true;
+}
+
+const char *host_uart_pty(uart_port_t uart)
+{
+    if (uart<0 || uart>=UART_NUM_MAX) return NULL;
+    host_uart_t *u=&uarts[uart];
+    if (u->fd>=0) return u->path;
+    int fd=posix_openpt(O_RDWR|O_NOCTTY);
+    if (fd<0) return NULL;
+    if (grantpt(fd)<0 || unlockpt(fd)<0 || ptsname_r(fd, u->path, sizeof(u->path))!=0) {
+        close(fd);
+        return NULL;
+    }
+    //Raw from the start, so nothing written before the peer sets it up is
+    //taken as line editing
+    struct termios tio;
+    int slave=open(u->path, O_RDWR|O_NOCTTY);
+    if (slave>=0) {
+        if (tcgetattr(slave, &tio)==0) {
+            cfmakeraw(&tio);
+            tcsetattr(slave, TCSANOW, &tio);
+        }
+        close(slave);
+    }
+    u->fd=fd;
+    return u->path;
+}
+
+esp_err_t uart_driver_install(uart_port_t uart_num, int rx_buffer_size, int tx_buffer_size, int queue_size,
+        QueueHandle_t *uart_queue, int intr_alloc_flags)
+{
+    (void) tx_buffer_size;
+    (void) queue_size;
+    (void) intr_alloc_flags;
+    if (uart_num<0 || uart_num>=UART_NUM_MAX || rx_buffer_size<=128) return ESP_ERR_INVALID_ARG;
+    host_uart_t *u=&uarts[uart_num];
+    if (u->installed) return ESP_FAIL;
+    if (u->fd<0) {
+        if (u->path[0]==0) return ESP_FAIL;
+        u->fd=open(u->path, O_RDWR|O_NOCTTY);
+        if (u->fd<0) return ESP_FAIL;
+        struct termios tio;
+        if (tcgetattr(u->fd, &tio)==0) {
+            cfmakeraw(&tio);
+            tcsetattr(u->fd, TCSANOW, &tio);
+        }
+    }
+    if (uart_queue) *uart_queue=NULL;
+    u->installed=true;
+    return ESP_OK;
+}
+
+esp_err_t uart_driver_delete(uart_port_t uart_num)
+{
+    if (uart_num<0 || uart_num>=UART_NUM_MAX || !uarts[uart_num].installed) return ESP_FAIL;
+    uarts[uart_num].installed=false;
+    return ESP_OK;
+}
+
+esp_err_t uart_set_baudrate(uart_port_t uart_num, uint32_t baudrate)
+{
+    if (uart_num<0 || uart_num>=UART_NUM_MAX) return ESP_FAIL;
+    uarts[uart_num].baudrate=baudrate;
+    return ESP_OK;
+}
+
+esp_err_t uart_get_baudrate(uart_port_t uart_num, uint32_t *baudrate)
+{
+    if (uart_num<0 || uart_num>=UART_NUM_MAX) return ESP_FAIL;
+    *baudrate=uarts[uart_num].baudrate;
+    return ESP_OK;
+}
+
+//Like the driver: wait until length bytes are in or the time is up
+int uart_read_bytes(uart_port_t uart_num, uint8_t *buf, uint32_t length, TickType_t ticks_to_wait)
+{
+    if (uart_num<0 || uart_num>=UART_NUM_MAX || !uarts[uart_num].installed) return -1;
+    int fd=uarts[uart_num].fd;
+    int64_t end=ticks_to_wait==portMAX_DELAY ? -1 : host_time_us()+(int64_t) ticks_to_wait*1000000/configTICK_RATE_HZ;
+    uint32_t got=0;
+    while (got<length) {
+        int timeout=-1;
+        if (end>=0) {
+            int64_t left=end-host_time_us();
+            timeout=left>0 ? (int) ((left+999)/1000) : 0;
+        }
+        struct pollfd pfd={.fd=fd, .events=POLLIN};
+        int r=poll(&pfd, 1, timeout);
+        if (r<0 && errno==EINTR) continue;
+        if (r<=0) break;
+        ssize_t n=read(fd, buf+got, length-got);
+        if (n<0 && errno==EINTR) continue;
+        if (n<=0) {
+            //The peer went away, which a pty master sees as EIO; wait as the
+            //driver would for bytes that will not come
+            if (timeout<0) pause();
+            if (timeout>0) usleep(timeout*1000);
+            break;
+        }
+        got+=n;
+    }
+    return got;
+}
+
+int uart_write_bytes(uart_port_t uart_num, const char *src, size_t size)
+{
+    if (uart_num<0 || uart_num>=UART_NUM_MAX || !uarts[uart_num].installed) return -1;
+    size_t done=0;
+    while (done<size) {
+        ssize_t n=write(uarts[uart_num].fd, src+done, size-done);
+        if (n<0 && errno==EINTR) continue;
+        if (n<=0) return -1;
+        done+=n;
+    }
+    return done;
+}
+
+esp_err_t uart_get_buffered_data_len(uart_port_t uart_num, size_t *size)
+{
+    int n=0;
+    if (uart_num<0 || uart_num>=UART_NUM_MAX || !uarts[uart_num].installed) return ESP_FAIL;
+    if (ioctl(uarts[uart_num].fd, FIONREAD, &n)<0) n=0;
+    *size=n;
+    return ESP_OK;
+}
+
+esp_err_t uart_flush_input(uart_port_t uart_num)
+{
+    if (uart_num<0 || uart_num>=UART_NUM_MAX || !uarts[uart_num].installed) return ESP_FAIL;
+    tcflush(uarts[uart_num].fd, TCIFLUSH);
+    return ESP_OK;
+}
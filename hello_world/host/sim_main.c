@@ -0,0 +1,202 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "host_port.h"
+#include "display.h"
+#include "effects.h"
+#include "input.h"
+#include "pattern.h"
+#include "stream.h"
+#include "trace.h"
+
+//Runs one effect (or app_main) against the panel model for a while, then
+//writes what the panel shows as a PBM image. -T prints the trace at the end,
+//for trace_view, in a build with TRACE_ENABLED 1.
+//
+//-g frames runs an effect of effect_list for that many frames instead, each
+//of the steps its rates give a frame, as fast as it can. The frame is then
+//the same on every run, for the golden frames `make golden` compares. -k
+//taps buttons before given frames, as MODE@0,R@100, each a press and a
+//release.
+
+void app_main(void);
+
+#define SIM_MAX_TAPS 16
+
+typedef struct {
+    const char *effect;
+    scrn_delta_t *scrn;
+    int golden_frames;                       //0 to run in real time
+    int taps;
+    input_event_t tap[SIM_MAX_TAPS];
+    int tap_frame[SIM_MAX_TAPS];
+    volatile bool done;
+} sim_t;
+
+static const char *const sim_buttons[INPUT_BUTTONS]={"U", "L", "D", "R", "C", "MODE"};
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: screen_runner_sim [-e app|life|ant|pattern|hashlife|life-pipelined|stream]\n"
+                    "                         [-t seconds] [-o final.pbm] [-d dir] [-i interval_ms]\n"
+                    "                         [-s input_script] [-p patterns.bin] [-u tty] [-T]\n"
+                    "                         [-g frames [-k button@frame,...]]\n");
+    exit(2);
+}
+
+//Taps such as MODE@0,R@100
+static bool sim_parse_taps(sim_t *sim, const char *taps)
+{
+    char button[8];
+    int frame, n;
+    while (*taps) {
+        if (sim->taps==SIM_MAX_TAPS || sscanf(taps, "%7[A-Z]@%d%n", button, &frame, &n)!=2) return false;
+        int b=0;
+        while (b<INPUT_BUTTONS && strcmp(sim_buttons[b], button)) b++;
+        if (b==INPUT_BUTTONS) return false;
+        sim->tap[sim->taps]=(input_event_t) {.button=b, .type=INPUT_PRESS};
+        sim->tap_frame[sim->taps++]=frame;
+        taps+=n;
+        if (*taps==',') taps++;
+    }
+    return true;
+}
+
+static void sim_golden(sim_t *sim)
+{
+    static effect_runner_t runner;
+    uint8_t *arena=heap_caps_malloc(EFFECT_ARENA_SIZE, MALLOC_CAP_8BIT);
+    int index;
+    if (!effect_runner_init(&runner, sim->scrn, effect_list, effect_list_count, arena, EFFECT_ARENA_SIZE, true)
+            || (index=effect_runner_find(&runner, sim->effect))<0 || !effect_runner_switch(&runner, index, 1, 0)) {
+        fprintf(stderr, "%s is not an effect of effect_list\n", sim->effect);
+        exit(2);
+    }
+    for (int frame=0;frame<sim->golden_frames;frame++) {
+        for (int i=0;i<sim->taps;i++) {
+            if (sim->tap_frame[i]!=frame) continue;
+            input_event_t event=sim->tap[i];
+            effect_runner_input(&runner, &event);
+            event.type=INPUT_RELEASE;
+            effect_runner_input(&runner, &event);
+        }
+        //The effect may have been switched by the taps
+        const effect_t *e=runner.slots[runner.current].effect;
+        effect_runner_frame_steps(&runner, (uint32_t) (e->steps_per_s/e->fps+0.5f));
+    }
+    sim->done=true;
+    vTaskDelete(NULL);
+}
+
+static void sim_effect_task(void *arg)
+{
+    sim_t *sim=arg;
+    if (!strcmp(sim->effect, "app")) {
+        app_main();
+        vTaskDelete(NULL);
+    }
+    spi_device_handle_t spi=scrn_open();
+    input_init();
+    sim->scrn=heap_caps_malloc(sizeof(scrn_delta_t), MALLOC_CAP_DMA);
+    scrn_delta_init(sim->scrn, spi);
+    if (sim->golden_frames) {
+        sim_golden(sim);
+    } else {
+        //Any of effect_list, which MODE with L/R goes on from
+        display_effects(sim->scrn, sim->effect);
+    }
+    fprintf(stderr, "unknown effect %s\n", sim->effect);
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    static sim_t sim={.effect="life"};
+    double seconds=2;
+    const char *out=NULL, *dir=NULL, *script=NULL, *patterns=NULL, *tty=NULL;
+    int interval_ms=100;
+    int opt;
+    bool trace=false;
+    while ((opt=getopt(argc, argv, "e:t:o:d:i:s:p:u:Tg:k:"))!=-1) {
+        switch (opt) {
+            case 'e': sim.effect=optarg; break;
+            case 't': seconds=atof(optarg); break;
+            case 'o': out=optarg; break;
+            case 'd': dir=optarg; break;
+            case 'i': interval_ms=atoi(optarg); break;
+            case 's': script=optarg; break;
+            case 'p': patterns=optarg; break;
+            case 'u': tty=optarg; break;
+            case 'T': trace=true; break;
+            case 'g': sim.golden_frames=atoi(optarg); break;
+            case 'k': if (!sim_parse_taps(&sim, optarg)) usage(); break;
+            default: usage();
+        }
+    }
+    char pack[512];
+    if (patterns==NULL) {
+        //The one the Makefile builds next to the simulator, if it is there
+        const char *slash=strrchr(argv[0], '/');
+        snprintf(pack, sizeof(pack), "%.*spatterns.bin", slash ? (int) (slash-argv[0]+1) : 0, argv[0]);
+        host_partition_file(PATTERN_PARTITION, PATTERN_PARTITION_SUBTYPE, pack);
+    } else if (!host_partition_file(PATTERN_PARTITION, PATTERN_PARTITION_SUBTYPE, patterns)) {
+        perror(patterns);
+        return 1;
+    }
+    //The console UART is a tty given with -u, or else a pseudo terminal
+    //for stream_send to write to. The stream effect's setup opens it
+    //whichever effect comes first.
+    if (tty) {
+        host_uart_file(STREAM_UART, tty);
+    } else {
+        const char *pty=host_uart_pty(STREAM_UART);
+        if (pty==NULL) {
+            perror("pty");
+            return 1;
+        }
+        if (!strcmp(sim.effect, "stream")) {
+            printf("stream: send to %s\n", pty);
+            fflush(stdout);
+        }
+    }
+    xTaskCreatePinnedToCore(sim_effect_task, "main", 4096, &sim, 1, NULL, 0);
+    if (script && host_gpio_replay(script)<0) {
+        perror(script);
+        return 1;
+    }
+
+    if (sim.golden_frames) {
+        int64_t start=host_time_us();
+        while (!sim.done) host_sleep_until_us(host_time_us()+1000);
+        seconds=(host_time_us()-start)/1e6;
+    }
+    int64_t end=sim.golden_frames ? host_time_us() : host_time_us()+(int64_t) (seconds*1e6);
+    int frame=0;
+    char path[512];
+    spi_device_handle_t spi;
+    for (int64_t t=host_time_us();t<end;t+=interval_ms*1000) {
+        host_sleep_until_us(t);
+        spi=host_spi_last_device();
+        if (dir && spi) {
+            snprintf(path, sizeof(path), "%s/frame_%05d.pbm", dir, frame++);
+            host_panel_write_pbm(spi, path);
+        }
+    }
+    host_sleep_until_us(end);
+    spi=host_spi_last_device();
+    if (spi==NULL) {
+        fprintf(stderr, "the effect never opened the screen\n");
+        return 1;
+    }
+    if (out) host_panel_write_pbm(spi, out);
+    host_spi_stats_t stats;
+    host_spi_get_stats(spi, &stats);
+    printf("%s: %.1f s, %u transactions, %llu bytes, bus busy %.1f%%, blocked %.1f ms\n", sim.effect, seconds,
+            (unsigned) stats.transactions, (unsigned long long) stats.bytes, stats.bus_ns/(seconds*1e7),
+            stats.blocked_ns/1e6);
+    if (trace) trace_dump();
+    return 0;
+}
@@ -0,0 +1,194 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <termios.h>
+#include "stream.h"
+#include "framebuffer.h"
+#include "life.h"
+#include "gfx.h"
+
+//Sends frames to a board running the stream effect (see stream.h), over its
+//serial port or, for screen_runner_sim -e stream, the pseudo terminal it
+//prints. Frames come from PBM files, 128x64 P4 as screen_runner_sim writes
+//them, shown in turn, or from a generator: life, a random soup, or plot, a
+//scrolling sine wave. Bytes are paced to the baud rate even where the line
+//itself has none, as a pseudo terminal.
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: stream_send [-b baud] [-k key_every] [-r fps] [-n frames] [-g life|plot]\n"
+                    "                   [-x drop_every] tty|- [frame.pbm...]\n");
+    exit(2);
+}
+
+static int64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec*1000000+ts.tv_nsec/1000;
+}
+
+static void sleep_until_us(int64_t t)
+{
+    int64_t d=t-now_us();
+    if (d>0) usleep(d);
+}
+
+static speed_t baud_speed(int baud)
+{
+    switch (baud) {
+        case 9600: return B9600;
+        case 57600: return B57600;
+        case 115200: return B115200;
+        case 230400: return B230400;
+        case 460800: return B460800;
+        case 921600: return B921600;
+        default: return 0;
+    }
+}
+
+//A 128x64 P4 PBM into page format
+static bool read_pbm(const char *path, uint8_t *frame)
+{
+    FILE *f=fopen(path, "rb");
+    int w, h;
+    if (f==NULL) return false;
+    if (fscanf(f, "P4 %d %d", &w, &h)!=2 || w!=SCRN_WIDTH || h!=SCRN_HEIGHT || fgetc(f)==EOF) {
+        fclose(f);
+        return false;
+    }
+    memset(frame, 0, SCRN_BUF_SIZE);
+    for (int y=0;y<SCRN_HEIGHT;y++) {
+        for (int xb=0;xb<SCRN_WIDTH/8;xb++) {
+            int row=fgetc(f);
+            if (row==EOF) {
+                fclose(f);
+                return false;
+            }
+            for (int i=0;i<8;i++) {
+                if (row&(0x80>>i)) frame[xb*8+i+SCRN_WIDTH*(y/8)]|=1<<(y%8);
+            }
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+static void generate(const char *generator, int i, uint8_t *frame)
+{
+    static uint8_t next[SCRN_BUF_SIZE];
+    if (!strcmp(generator, "life")) {
+        if (i==0) {
+            srand(1);
+            for (int j=0;j<SCRN_BUF_SIZE;j++) frame[j]=rand();
+        } else {
+            life_step(frame, next);
+            memcpy(frame, next, SCRN_BUF_SIZE);
+        }
+    } else {
+        //Axes and a wave moving left a pixel a frame
+        gfx_clear(frame);
+        gfx_hline(frame, 0, SCRN_HEIGHT/2, SCRN_WIDTH, GFX_SET);
+        gfx_vline(frame, 0, 0, SCRN_HEIGHT, GFX_SET);
+        int last=0;
+        for (int x=0;x<SCRN_WIDTH;x++) {
+            int y=SCRN_HEIGHT/2-(int) lrint(24*sin((x+i)*0.1)*cos((x+i)*0.013));
+            if (x) gfx_line(frame, x-1, last, x, y, GFX_SET);
+            last=y;
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int baud=115200, key_every=30, frames=0, drop_every=0, opt;
+    double fps=0;
+    const char *generator=NULL;
+    while ((opt=getopt(argc, argv, "b:k:r:n:g:x:"))!=-1) {
+        switch (opt) {
+            case 'b': baud=atoi(optarg); break;
+            case 'k': key_every=atoi(optarg); break;
+            case 'r': fps=atof(optarg); break;
+            case 'n': frames=atoi(optarg); break;
+            case 'g': generator=optarg; break;
+            case 'x': drop_every=atoi(optarg); break;
+            default: usage();
+        }
+    }
+    if (optind>=argc || baud<=0) usage();
+    const char *out=argv[optind++];
+    int files=argc-optind;
+    if (files==0 && generator==NULL) generator="life";
+    if (generator && strcmp(generator, "life") && strcmp(generator, "plot")) usage();
+    if (frames==0) frames=generator ? 300 : files;
+
+    int fd=1;
+    if (strcmp(out, "-")) {
+        fd=open(out, O_WRONLY|O_NOCTTY);
+        if (fd<0) {
+            perror(out);
+            return 1;
+        }
+    }
+    struct termios tio;
+    if (tcgetattr(fd, &tio)==0) {
+        cfmakeraw(&tio);
+        if (baud_speed(baud)) {
+            cfsetispeed(&tio, baud_speed(baud));
+            cfsetospeed(&tio, baud_speed(baud));
+        }
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+
+    static uint8_t frame[SCRN_BUF_SIZE], shown[SCRN_BUF_SIZE];
+    static uint8_t key[STREAM_MAX_PAYLOAD], delta[STREAM_MAX_PAYLOAD], packet[STREAM_MAX_PACKET];
+    uint64_t sent=0, payload=0;
+    int keys=0, dropped=0;
+    int64_t start=now_us();
+    for (int i=0;i<frames;i++) {
+        if (generator) {
+            generate(generator, i, frame);
+        } else if (!read_pbm(argv[optind+i%files], frame)) {
+            fprintf(stderr, "%s: not a 128x64 P4 PBM\n", argv[optind+i%files]);
+            return 1;
+        }
+        if (fps>0) sleep_until_us(start+(int64_t) (i*1e6/fps));
+        //A key frame now and then, or whenever it is the shorter
+        int key_len=stream_encode(NULL, frame, key);
+        int delta_len=i ? stream_encode(shown, frame, delta) : key_len;
+        bool is_key=i%key_every==0 || key_len<=delta_len;
+        int len=stream_packet(packet, is_key ? STREAM_KEY : 0, i, is_key ? key : delta, is_key ? key_len : delta_len);
+        memcpy(shown, frame, SCRN_BUF_SIZE);
+        keys+=is_key;
+        payload+=is_key ? key_len : delta_len;
+        //A start bit, eight data bits and a stop bit per byte
+        for (int j=0;j<len;) {
+            int n=len-j<64 ? len-j : 64;
+            sleep_until_us(start+(int64_t) (sent*10*1e6/baud));
+            if (drop_every && rand()%drop_every<n) {
+                //Lose a byte of this chunk, for trying out the receiver
+                int k=rand()%n;
+                memmove(packet+j+k, packet+j+k+1, len-j-k-1);
+                len--;
+                n--;
+                dropped++;
+            }
+            if (write(fd, packet+j, n)!=n) {
+                perror(out);
+                return 1;
+            }
+            j+=n;
+            sent+=n;
+        }
+    }
+    double s=(now_us()-start)/1e6;
+    fprintf(stderr, "%d frames (%d key) in %.1f s: %.1f frames/s, %.0f bytes/frame, %.0f bytes/s"
+            ", %d bytes dropped; raw frames would be %.1f frames/s\n", frames, keys, s, frames/s,
+            (double) payload/frames, sent/s, dropped, baud/10.0/SCRN_BUF_SIZE);
+    return 0;
+}
@@ -0,0 +1,263 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+//Reads what trace_dump printed (see trace.h), from a file or the console
+//log on stdin with anything else mixed in, and prints for every trace point
+//a histogram of how long it took. -o writes the events as Chrome trace JSON,
+//for chrome://tracing or Perfetto, a row per core.
+//
+//The cycle counts only go forward 2^32 cycles before they wrap, so each
+//event is placed back from the one after it, and the newest from the ring's
+//sync pair. Two events further apart than that, 18 s at 240 MHz, come out
+//too close together.
+
+#define VIEW_MAX_CORES 2
+#define VIEW_MAX_POINTS 32
+#define VIEW_MAX_DEPTH 16
+#define VIEW_BUCKETS 24
+#define VIEW_BAR 40
+
+typedef struct {
+    uint32_t cycles;
+    int point;
+    int type;
+    double us;
+} view_event_t;
+
+typedef struct {
+    uint32_t sync_cycles;
+    long long sync_us;
+    unsigned recorded;
+    view_event_t *events;
+    int count;
+    int size;
+} view_core_t;
+
+typedef struct {
+    double *us;
+    int count;
+    int size;
+} view_spans_t;
+
+static int cores, cycles_per_us, points;
+static char names[VIEW_MAX_POINTS][32];
+static view_core_t core[VIEW_MAX_CORES];
+static view_spans_t spans[VIEW_MAX_POINTS];
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: trace_view [-o trace.json] [dump.txt]\n");
+    exit(2);
+}
+
+static void *grow(void *p, int *size, int count, size_t item)
+{
+    if (count<*size) return p;
+    *size=*size ? *size*2 : 1024;
+    p=realloc(p, *size*item);
+    if (p==NULL) {
+        perror("trace_view");
+        exit(1);
+    }
+    return p;
+}
+
+static void add_event(int c, uint32_t cycles, int point, int type)
+{
+    view_core_t *v=&core[c];
+    v->events=grow(v->events, &v->size, v->count, sizeof(view_event_t));
+    v->events[v->count++]=(view_event_t) {cycles, point, type, 0};
+}
+
+static void add_span(int point, double us)
+{
+    view_spans_t *s=&spans[point];
+    s->us=grow(s->us, &s->size, s->count, sizeof(double));
+    s->us[s->count++]=us;
+}
+
+//False for a line that is not a well formed part of the dump
+static bool parse_line(const char *line)
+{
+    const char *p=strstr(line, "trace: ");
+    int c, n, i;
+    unsigned sync_cycles, recorded;
+    long long sync_us;
+    char name[32];
+    if (p==NULL) return true;
+    p+=7;
+    if (sscanf(p, "begin %d %d %d", &c, &n, &i)==3) {
+        if (c<1 || c>VIEW_MAX_CORES || n<1 || i<1 || i>VIEW_MAX_POINTS) return false;
+        cores=c;
+        cycles_per_us=n;
+        points=i;
+        return true;
+    }
+    if (sscanf(p, "point %d %31s", &i, name)==2) {
+        if (i<0 || i>=points) return false;
+        strcpy(names[i], name);
+        return true;
+    }
+    if (sscanf(p, "core %d %u %lld %d %u", &c, &sync_cycles, &sync_us, &n, &recorded)==5) {
+        if (c<0 || c>=cores) return false;
+        core[c].sync_cycles=sync_cycles;
+        core[c].sync_us=sync_us;
+        core[c].recorded=recorded;
+        core[c].count=0;
+        return true;
+    }
+    if (!strncmp(p, "end", 3) || !strncmp(p, "compiled out", 12)) return true;
+    if (sscanf(p, "%d%n", &c, &n)!=1 || c<0 || c>=cores) return false;
+    p+=n;
+    unsigned cycles, point, type;
+    while (sscanf(p, " %8x%2x%2x%n", &cycles, &point, &type, &n)==3) {
+        if (point>=(unsigned) points) return false;
+        add_event(c, cycles, point, type);
+        p+=n;
+    }
+    return true;
+}
+
+//Microseconds on the esp_timer clock, from the newest event back
+static void place(view_core_t *v)
+{
+    if (v->count==0) return;
+    view_event_t *e=v->events;
+    int last=v->count-1;
+    e[last].us=v->sync_us+(double) (int32_t) (e[last].cycles-v->sync_cycles)/cycles_per_us;
+    for (int i=last-1;i>=0;i--) {
+        //A little backwards when an interrupt stamped between reserving a slot and reading the count
+        uint32_t d=e[i+1].cycles-e[i].cycles;
+        double us=d<0x80000000u ? (double) d : -(double) (uint32_t) -d;
+        e[i].us=e[i+1].us-us/cycles_per_us;
+    }
+}
+
+static int compare_us(const void *a, const void *b)
+{
+    double x=*(const double *) a, y=*(const double *) b;
+    return x<y ? -1 : x>y;
+}
+
+static void histogram(int point)
+{
+    view_spans_t *s=&spans[point];
+    if (s->count==0) return;
+    qsort(s->us, s->count, sizeof(double), compare_us);
+    double sum=0;
+    int buckets[VIEW_BUCKETS]={0}, most=0, first=VIEW_BUCKETS, last=0;
+    for (int i=0;i<s->count;i++) {
+        sum+=s->us[i];
+        //[2^(b-1), 2^b) us, below 1 us in the first
+        int b=0;
+        while (b<VIEW_BUCKETS-1 && s->us[i]>=(double) (1u<<b)) b++;
+        buckets[b]++;
+        if (buckets[b]>most) most=buckets[b];
+        if (b<first) first=b;
+        if (b>last) last=b;
+    }
+    printf("%s: %d, min %.1f us, avg %.1f, p50 %.1f, p99 %.1f, max %.1f\n", names[point], s->count, s->us[0],
+            sum/s->count, s->us[s->count/2], s->us[(int) (s->count*0.99)], s->us[s->count-1]);
+    for (int b=first;b<=last;b++) {
+        char range[32];
+        if (b==0) snprintf(range, sizeof(range), "< 1");
+        else snprintf(range, sizeof(range), "%u-%u", 1u<<(b-1), 1u<<b);
+        printf("  %14s us %7d ", range, buckets[b]);
+        for (int i=0;i<(buckets[b]*VIEW_BAR+most-1)/most;i++) putchar('#');
+        putchar('\n');
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *out=NULL;
+    int opt;
+    while ((opt=getopt(argc, argv, "o:"))!=-1) {
+        switch (opt) {
+            case 'o': out=optarg; break;
+            default: usage();
+        }
+    }
+    if (argc-optind>1) usage();
+    FILE *in=stdin;
+    if (optind<argc && strcmp(argv[optind], "-")) {
+        in=fopen(argv[optind], "r");
+        if (in==NULL) {
+            perror(argv[optind]);
+            return 1;
+        }
+    }
+    char line[4096];
+    int bad=0;
+    while (fgets(line, sizeof(line), in)) {
+        if (!parse_line(line)) bad++;
+    }
+    if (cores==0) {
+        fprintf(stderr, "no trace in the input\n");
+        return 1;
+    }
+
+    FILE *json=NULL;
+    if (out) {
+        json=fopen(out, "w");
+        if (json==NULL) {
+            perror(out);
+            return 1;
+        }
+        fprintf(json, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+    }
+    //Times in the JSON start at the oldest event
+    double start=0;
+    bool started=false;
+    for (int c=0;c<cores;c++) {
+        place(&core[c]);
+        if (core[c].count && (!started || core[c].events[0].us<start)) start=core[c].events[0].us;
+        started|=core[c].count>0;
+    }
+    int unmatched=0;
+    bool comma=false;
+    for (int c=0;c<cores;c++) {
+        view_core_t *v=&core[c];
+        int stack[VIEW_MAX_POINTS][VIEW_MAX_DEPTH], depth[VIEW_MAX_POINTS]={0};
+        printf("core %d: %d events of %u recorded\n", c, v->count, v->recorded);
+        if (json) {
+            fprintf(json, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": %d,"
+                    " \"args\": {\"name\": \"core %d\"}}", comma ? ",\n" : "", c, c);
+            comma=true;
+        }
+        for (int i=0;i<v->count;i++) {
+            view_event_t *e=&v->events[i];
+            if (e->type==0) {
+                if (depth[e->point]<VIEW_MAX_DEPTH) stack[e->point][depth[e->point]++]=i;
+                else unmatched++;
+            } else if (e->type==1) {
+                //Its begin went out of the ring, or the ring wrapped under the dump
+                if (depth[e->point]==0) {
+                    unmatched++;
+                    continue;
+                }
+                view_event_t *b=&v->events[stack[e->point][--depth[e->point]]];
+                add_span(e->point, e->us-b->us);
+                if (json) {
+                    fprintf(json, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 0, \"tid\": %d, \"ts\": %.3f,"
+                            " \"dur\": %.3f}", names[e->point], c, b->us-start, e->us-b->us);
+                }
+            } else if (json) {
+                fprintf(json, ",\n{\"name\": \"%s\", \"ph\": \"i\", \"s\": \"t\", \"pid\": 0, \"tid\": %d,"
+                        " \"ts\": %.3f}", names[e->point], c, e->us-start);
+            }
+        }
+        for (int p=0;p<points;p++) unmatched+=depth[p];
+    }
+    if (json) {
+        fprintf(json, "\n]}\n");
+        fclose(json);
+    }
+    for (int p=0;p<points;p++) histogram(p);
+    if (unmatched || bad) printf("%d events without a pair, %d lines not understood\n", unmatched, bad);
+    return 0;
+}
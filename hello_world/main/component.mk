@@ -3,3 +3,7 @@
 #
 # (Uses default behaviour of compiling all source files in directory, adding 'include' to include path.)
 
+
+# Begin and end events of the hot paths in a ring per core, printed with
+# MODE+U (see trace.h)
+#CFLAGS += -DTRACE_ENABLED=1
@@ -0,0 +1,125 @@
+#include <string.h>
+#include "compose.h"
+#include "gfx.h"
+#include "text.h"
+
+static inline uint64_t compose_load(const uint8_t *buf, int offset) {
+    uint64_t w;
+    memcpy(&w, buf+offset, sizeof(w));
+    return w;
+}
+
+static void compose_mark_tiles(compose_t *c, compose_layer_t *layer, const scrn_tiles_t *tiles) {
+    scrn_tiles_or(&layer->used, tiles);
+    scrn_tiles_or(&c->dirty, tiles);
+}
+
+//Mark the tiles under a rectangle, clipped to the screen
+static void compose_mark(compose_t *c, compose_layer_t *layer, int x, int y, int width, int height) {
+    int x0 = x<0 ? 0 : x;
+    int y0 = y<0 ? 0 : y;
+    int x1 = width>SCRN_WIDTH-x ? SCRN_WIDTH : x+width;
+    int y1 = height>SCRN_HEIGHT-y ? SCRN_HEIGHT : y+height;
+    if (x0>=x1 || y0>=y1) return;
+    uint16_t bits = (0xFFFF<<(x0/SCRN_TILE_COLS)) & (0xFFFF>>(SCRN_TILES_X-1-(x1-1)/SCRN_TILE_COLS));
+    for (int page=y0>>3;page<=(y1-1)>>3;page++) {
+        layer->used.rows[page] |= bits;
+        c->dirty.rows[page] |= bits;
+    }
+}
+
+void compose_init(compose_t *c, uint32_t blink_frames) {
+    memset(c, 0, sizeof(*c));
+    c->blink_frames = blink_frames;
+    c->blink_on = true;
+    scrn_tiles_fill(&c->dirty);
+}
+
+void compose_clear(compose_t *c, compose_layer_t *layer) {
+    for (int p=0;p<SCRN_PAGES;p++) {
+        for (uint16_t row=layer->used.rows[p];row;row&=row-1) {
+            int offset = SCRN_WIDTH*p+SCRN_TILE_COLS*__builtin_ctz(row);
+            memset(layer->ink+offset, 0, SCRN_TILE_COLS);
+            memset(layer->mask+offset, 0, SCRN_TILE_COLS);
+        }
+    }
+    scrn_tiles_or(&c->dirty, &layer->used);
+    scrn_tiles_clear(&layer->used);
+}
+
+void compose_pixel(compose_t *c, compose_layer_t *layer, int x, int y, bool on) {
+    gfx_pixel(layer->ink, x, y, on ? GFX_SET : GFX_CLEAR);
+    gfx_pixel(layer->mask, x, y, GFX_SET);
+    compose_mark(c, layer, x, y, 1, 1);
+}
+
+void compose_rect(compose_t *c, compose_layer_t *layer, int x, int y, int width, int height, bool on) {
+    if (width<=0 || height<=0) return;
+    gfx_rect(layer->ink, x, y, width, height, on ? GFX_SET : GFX_CLEAR);
+    gfx_rect(layer->mask, x, y, width, height, GFX_SET);
+    //Each side on its own, the tiles inside a large box stay untouched
+    compose_mark(c, layer, x, y, width, 1);
+    compose_mark(c, layer, x, y+height-1, width, 1);
+    compose_mark(c, layer, x, y, 1, height);
+    compose_mark(c, layer, x+width-1, y, 1, height);
+}
+
+int compose_text(compose_t *c, compose_layer_t *layer, int x, int y, const char *s, bool opaque) {
+    scrn_tiles_t tiles;
+    int end;
+    scrn_tiles_clear(&tiles);
+    if (opaque) {
+        end = text_draw(layer->ink, x, y, s, TEXT_OPAQUE, &tiles);
+        //Every glyph cell, line by line
+        for (int ly=y;*s;ly+=TEXT_GLYPH_H) {
+            int n = strcspn(s, "\n");
+            gfx_rect_fill(layer->mask, x, ly, TEXT_GLYPH_W*n, TEXT_GLYPH_H, GFX_SET);
+            s += n;
+            if (*s=='\n') s++;
+        }
+    } else {
+        text_draw(layer->mask, x, y, s, TEXT_OR, NULL);
+        end = text_draw(layer->ink, x, y, s, TEXT_OR, &tiles);
+    }
+    compose_mark_tiles(c, layer, &tiles);
+    return end;
+}
+
+void compose_blink_restart(compose_t *c) {
+    if (!c->blink_on) scrn_tiles_or(&c->dirty, &c->blink.used);
+    c->blink_on = true;
+    c->frame = 0;
+}
+
+void compose_frame(compose_t *c, const uint8_t *sim, const scrn_tiles_t *tiles, scrn_tiles_t *flush) {
+    if (c->blink_frames && ++c->frame>=c->blink_frames) {
+        c->frame = 0;
+        c->blink_on = !c->blink_on;
+        scrn_tiles_or(&c->dirty, &c->blink.used);
+    }
+    if (tiles) {
+        *flush = *tiles;
+        scrn_tiles_or(flush, &c->dirty);
+    } else {
+        scrn_tiles_fill(flush);
+    }
+    c->composed = 0;
+    for (int p=0;p<SCRN_PAGES;p++) {
+        uint16_t over = c->overlay.used.rows[p], blink = c->blink.used.rows[p];
+        for (uint16_t row=flush->rows[p];row;row&=row-1) {
+            int t = __builtin_ctz(row);
+            int offset = SCRN_WIDTH*p+SCRN_TILE_COLS*t;
+            uint64_t v = compose_load(sim, offset);
+            if ((over>>t)&1) {
+                v = (v&~compose_load(c->overlay.mask, offset)) | compose_load(c->overlay.ink, offset);
+            }
+            if ((blink>>t)&1) {
+                v &= ~compose_load(c->blink.mask, offset);
+                if (c->blink_on) v |= compose_load(c->blink.ink, offset);
+            }
+            memcpy(c->out+offset, &v, sizeof(v));
+            c->composed++;
+        }
+    }
+    scrn_tiles_clear(&c->dirty);
+}
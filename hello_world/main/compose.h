@@ -0,0 +1,50 @@
+#ifndef COMPOSE_H
+#define COMPOSE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "framebuffer.h"
+
+//Builds the frame that goes to the panel from the simulation's buffer with
+//overlays on top, so cursors, boxes and text never touch the simulation.
+//A layer is two page format bitmaps: mask, the pixels it covers, and ink,
+//which of those are on. The blink layer shows its ink and its pixels off by
+//turns. A frame only composes the tiles the simulation changed and those
+//the layers drew in, cleared or blinked since the last one, a tile being a
+//64 bit word of each buffer.
+
+typedef struct {
+    uint8_t ink[SCRN_BUF_SIZE];
+    uint8_t mask[SCRN_BUF_SIZE];
+    scrn_tiles_t used;                       //Tiles where mask has anything set
+} compose_layer_t;
+
+typedef struct {
+    uint8_t out[SCRN_BUF_SIZE];              //What goes to the flush
+    compose_layer_t overlay;
+    compose_layer_t blink;                   //Above the overlay
+    scrn_tiles_t dirty;                      //Tiles to compose next frame whatever the simulation did
+    uint32_t blink_frames;                   //Frames each way, 0 to keep the blink layer on
+    uint32_t frame;                          //Into the blink phase
+    bool blink_on;
+    uint32_t composed;                       //Tiles composed by the last frame
+} compose_t;
+
+//The first frame composes every tile
+void compose_init(compose_t *c, uint32_t blink_frames);
+//Empty the layer, its tiles showing the simulation again
+void compose_clear(compose_t *c, compose_layer_t *layer);
+void compose_pixel(compose_t *c, compose_layer_t *layer, int x, int y, bool on);
+//The outline
+void compose_rect(compose_t *c, compose_layer_t *layer, int x, int y, int width, int height, bool on);
+//Opaque text covers the whole cell of each glyph, otherwise only the glyph
+//pixels. Returns the x after it.
+int compose_text(compose_t *c, compose_layer_t *layer, int x, int y, const char *s, bool opaque);
+//Start the blink layer over in its on phase, so that a cursor that just moved shows
+void compose_blink_restart(compose_t *c);
+//Bring out up to date with sim, which changed at most in tiles (NULL for
+//anywhere), and move the blink on a frame. flush gets the tiles of out
+//that may have changed, for scrn_delta_flush_tiles.
+void compose_frame(compose_t *c, const uint8_t *sim, const scrn_tiles_t *tiles, scrn_tiles_t *flush);
+
+#endif
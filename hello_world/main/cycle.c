@@ -0,0 +1,129 @@
+#include <stdlib.h>
+#include <string.h>
+#include "cycle.h"
+
+//The 8 bytes of a tile are next to each other, so a frame is hashed as
+//SCRN_TILES_X*SCRN_PAGES words: what tile t holding w adds to the hash
+static inline uint64_t cycle_mix(int t, uint64_t w) {
+    uint64_t z = w+(uint64_t) (t+1)*0x9E3779B97F4A7C15ull;
+    z = (z^(z>>32))*0xD6E8FEB86659FD93ull;
+    z = (z^(z>>32))*0xD6E8FEB86659FD93ull;
+    return z^(z>>32);
+}
+
+static inline uint64_t cycle_tile(const uint8_t *frame, int t) {
+    uint64_t w;
+    memcpy(&w, frame+SCRN_TILE_COLS*t, sizeof(w));
+    return w;
+}
+
+static uint64_t cycle_hash(const uint8_t *frame) {
+    uint64_t h = 0;
+    for (int t=0;t<SCRN_TILES_X*SCRN_PAGES;t++) {
+        h ^= cycle_mix(t, cycle_tile(frame, t));
+    }
+    return h;
+}
+
+static void cycle_search(cycle_t *c) {
+    if (c->frames!=c->store) free(c->frames);
+    c->frames = NULL;
+    c->state = CYCLE_SEARCHING;
+    c->period = 0;
+}
+
+void cycle_init(cycle_t *c, const uint8_t *frame, uint32_t confirm) {
+    memset(c, 0, sizeof(*c));
+    c->confirm = confirm ? confirm : 1;
+    cycle_reset(c, frame);
+}
+
+void cycle_free(cycle_t *c) {
+    cycle_search(c);
+}
+
+void cycle_set_store(cycle_t *c, uint8_t *store) {
+    cycle_search(c);
+    c->store = store;
+}
+
+void cycle_reset(cycle_t *c, const uint8_t *frame) {
+    cycle_search(c);
+    c->hash = cycle_hash(frame);
+    c->history[0] = c->hash;
+    c->generation = 0;
+    c->seen = 1;
+}
+
+cycle_state_t cycle_update(cycle_t *c, const uint8_t *prev, const uint8_t *next, const scrn_tiles_t *tiles) {
+    uint8_t period = 0;
+    //Only the tiles marked can have changed
+    for (int p=0;p<SCRN_PAGES;p++) {
+        uint16_t row = tiles ? tiles->rows[p] : 0xFFFF;
+        for (;row;row&=row-1) {
+            int t = SCRN_TILES_X*p+__builtin_ctz(row);
+            uint64_t before = cycle_tile(prev, t), after = cycle_tile(next, t);
+            if (before!=after) c->hash ^= cycle_mix(t, before)^cycle_mix(t, after);
+        }
+    }
+    c->generation++;
+    if (c->state==CYCLE_SEARCHING) {
+        //Shortest period first. history[generation%MAX] is about to be
+        //overwritten but still holds the hash from CYCLE_MAX_PERIOD back.
+        for (int p=1;p<=c->seen && p<=CYCLE_MAX_PERIOD;p++) {
+            if (c->history[(c->generation-p)%CYCLE_MAX_PERIOD]==c->hash) {
+                period = p;
+                break;
+            }
+        }
+        if (period) {
+            c->frames = c->store ? c->store : malloc(period*SCRN_BUF_SIZE);
+            if (c->frames) {
+                c->state = CYCLE_CAPTURING;
+                c->period = period;
+                c->captured = 0;
+                c->capture_gen = c->generation;
+            }
+        }
+    } else if (c->state==CYCLE_CAPTURING) {
+        if (c->history[(c->generation-c->period)%CYCLE_MAX_PERIOD]!=c->hash) {
+            cycle_search(c);
+        }
+    } else if (c->state==CYCLE_CONFIRMING) {
+        //The frame has to be the captured one exactly, not only hash like it
+        const uint8_t *expect = c->frames+SCRN_BUF_SIZE*((c->generation-c->capture_gen)%c->period);
+        if (memcmp(next, expect, SCRN_BUF_SIZE)) {
+            cycle_search(c);
+        } else if (++c->confirmed>=c->confirm) {
+            c->state = CYCLE_LOCKED;
+            c->phase = (c->generation-c->capture_gen)%c->period;
+            for (int f=0;f<c->period;f++) {
+                const uint8_t *a = c->frames+SCRN_BUF_SIZE*f;
+                const uint8_t *b = c->frames+SCRN_BUF_SIZE*((f+c->period-1)%c->period);
+                scrn_tiles_clear(&c->changes[f]);
+                for (int i=0;i<SCRN_BUF_SIZE;i++) {
+                    if (a[i]!=b[i]) scrn_tiles_mark(&c->changes[f], i%SCRN_WIDTH, 8*(i/SCRN_WIDTH));
+                }
+            }
+            c->locks++;
+        }
+    }
+    if (c->state==CYCLE_CAPTURING) {
+        memcpy(c->frames+SCRN_BUF_SIZE*c->captured++, next, SCRN_BUF_SIZE);
+        if (c->captured==c->period) {
+            c->state = CYCLE_CONFIRMING;
+            c->confirmed = 0;
+        }
+    }
+    c->history[c->generation%CYCLE_MAX_PERIOD] = c->hash;
+    if (c->seen<CYCLE_MAX_PERIOD) c->seen++;
+    return c->state;
+}
+
+const uint8_t *cycle_next(cycle_t *c, scrn_tiles_t *changed) {
+    c->phase = (c->phase+1)%c->period;
+    *changed = c->changes[c->phase];
+    c->replayed++;
+    if (c->period==1) c->unchanged++;
+    return c->frames+SCRN_BUF_SIZE*c->phase;
+}
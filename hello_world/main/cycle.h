@@ -0,0 +1,64 @@
+#ifndef CYCLE_H
+#define CYCLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "framebuffer.h"
+
+//Spots a simulation that has settled into a cycle, so the frames can be
+//replayed instead of computed. Each frame has a 64 bit hash, the XOR over
+//its tiles of a mix of the tile's 8 bytes and where it is, which a step
+//updates from the tiles it changed. A hash matching one from up to
+//CYCLE_MAX_PERIOD generations back starts capturing that many frames; the
+//cycle is locked in once the frames after them match the captured ones
+//exactly for the number of generations asked for.
+
+#define CYCLE_MAX_PERIOD 16
+
+typedef enum {
+    CYCLE_SEARCHING,
+    CYCLE_CAPTURING,
+    CYCLE_CONFIRMING,
+    CYCLE_LOCKED
+} cycle_state_t;
+
+typedef struct {
+    uint64_t hash;                           //Of the newest frame
+    uint64_t history[CYCLE_MAX_PERIOD];      //Hashes by generation, a ring
+    uint32_t generation;
+    uint8_t seen;                            //Entries of history filled
+    uint8_t state;                           //cycle_state_t
+    uint8_t period;
+    uint8_t captured;
+    uint8_t phase;                           //Frame shown while locked
+    uint32_t capture_gen;                    //Generation of frames[0]
+    uint32_t confirm;                        //Generations to match before locking
+    uint32_t confirmed;
+    uint8_t *frames;                         //period frames once capturing
+    uint8_t *store;                          //Where they go, NULL for the heap
+    scrn_tiles_t changes[CYCLE_MAX_PERIOD];  //Tiles where each frame differs from the one before
+    //Stats
+    uint32_t locks;
+    uint32_t replayed;                       //Generations served from frames
+    uint32_t unchanged;                      //Of those, frames identical to the one before
+} cycle_t;
+
+//Start watching from frame. confirm is at least 1; Generations rules want
+//their dying states counted in, as cells fading out do not show.
+void cycle_init(cycle_t *c, const uint8_t *frame, uint32_t confirm);
+void cycle_free(cycle_t *c);
+//Capture into store, room for CYCLE_MAX_PERIOD frames, instead of the heap.
+//After cycle_init, NULL goes back to the heap.
+void cycle_set_store(cycle_t *c, uint8_t *store);
+//Start over from frame, after it was edited or the rule changed
+void cycle_reset(cycle_t *c, const uint8_t *frame);
+//After a step from prev to next. tiles holds every tile where they may
+//differ, NULL for all of them. Not to be called once locked.
+cycle_state_t cycle_update(cycle_t *c, const uint8_t *prev, const uint8_t *next, const scrn_tiles_t *tiles);
+//Once locked, the frame following the last one and the tiles it changed
+const uint8_t *cycle_next(cycle_t *c, scrn_tiles_t *changed);
+static inline bool cycle_locked(const cycle_t *c) {
+    return c->state==CYCLE_LOCKED;
+}
+
+#endif
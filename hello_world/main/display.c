@@ -0,0 +1,384 @@
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/gpio.h"
+#include "pins.h"
+#include "display.h"
+#include "trace.h"
+
+DRAM_ATTR const scrn_init_cmd_t scrn_init_cmds[]={
+    {0xAE, {0}, 0}, // 0 disp off
+    {0xD5, {0}, 0}, // 1 clk div
+    {0x50, {0}, 0}, // 2 suggested ratio
+    {0xA8, {0x3F}, 1}, // 3 set multiplex
+    {0xD3,{0x0}, 1}, // 5 display offset
+    {0x40, {0}, 0}, // 7 start line
+#ifdef SCRN_SSD1306
+    {0x8D,{0x14}, 1}, // 8 enable charge pump
+    {0x20,{0x02}, 1}, // 9 page addressing
+#else
+    {0xAD,{0x8B}, 1}, // 8 enable charge pump
+#endif
+    {0xA1, {0}, 0}, // 10 seg remap 1, pin header at the top
+    {0xC8, {0}, 0}, // 11 comscandec, pin header at the top
+    {0xDA,{0x12}, 1}, // 12 set compins
+    {0x81,{0x80}, 1}, // 14 set contrast
+    {0xD9,{0x22}, 1}, // 16 set precharge
+    {0xDB,{0x35}, 1}, // 18 set vcom detect
+    {0xA6, {0}, 0}, // 20 display normal (non-inverted)
+    {0xAF, {0}, 0}, // 21 disp on
+    {0, {0}, 0xFF}
+};
+
+void scrn_cmd(spi_device_handle_t spi, const uint8_t cmd)
+{
+    esp_err_t ret;
+    spi_transaction_t t;
+    memset(&t, 0, sizeof(t));       //Zero out the transaction
+    t.length=8;                     //Command is 8 bits
+    t.tx_buffer=&cmd;               //The data is the cmd itself
+    t.user=(void*)0;                //D/C needs to be set to 0
+    ret=spi_device_transmit(spi, &t);  //Transmit!
+    assert(ret==ESP_OK);            //Should have had no issues.
+}
+
+void scrn_data(spi_device_handle_t spi, const uint8_t *data, int len)
+{
+    esp_err_t ret;
+    spi_transaction_t t;
+    if (len==0) return;             //no need to send anything
+    memset(&t, 0, sizeof(t));       //Zero out the transaction
+    t.length=len*8;                 //Len is in bytes, transaction length is in bits.
+    t.tx_buffer=data;               //Data
+    t.user=(void*)0;                //D/C needs to be set to 1
+    ret=spi_device_transmit(spi, &t);  //Transmit!
+    assert(ret==ESP_OK);            //Should have had no issues.
+}
+
+void scrn_spi_pre_transfer_callback(spi_transaction_t *t)
+{
+    int dc=(int)(intptr_t)t->user&SCRN_TRANS_DC;
+    gpio_set_level(DC_PIN, dc);
+}
+
+//Runs in the SPI interrupt. The last transaction of a frame carries its
+//scrn_flush_t in user, see scrn_flush_init.
+void IRAM_ATTR scrn_spi_post_transfer_callback(spi_transaction_t *t)
+{
+    if (!((int)(intptr_t)t->user&SCRN_TRANS_FRAME_END)) return;
+    scrn_flush_t *f=(scrn_flush_t *)((intptr_t)t->user&~(intptr_t)SCRN_TRANS_BITS);
+    BaseType_t woken=pdFALSE;
+    if (f->on_done) f->on_done(f->on_done_arg);
+    xSemaphoreGiveFromISR(f->done, &woken);
+    if (woken) portYIELD_FROM_ISR();
+}
+
+void scrn_reset(void)
+{
+    //Initialize non-SPI GPIOs, the buttons are set up by input_init
+    gpio_set_direction(DC_PIN, GPIO_MODE_OUTPUT);
+    gpio_set_direction(RST_PIN, GPIO_MODE_OUTPUT);
+    //Reset the display
+    gpio_set_level(RST_PIN, 0);
+    vTaskDelay(100 / portTICK_RATE_MS);
+    gpio_set_level(RST_PIN, 1);
+    vTaskDelay(100 / portTICK_RATE_MS);
+}
+
+void scrn_send_init(spi_device_handle_t spi, const scrn_init_cmd_t *init_cmds)
+{
+    int cmd=0;
+    //Send all the commands
+    while (init_cmds[cmd].databytes!=0xff) {
+        scrn_cmd(spi, init_cmds[cmd].cmd);
+        scrn_data(spi, init_cmds[cmd].data, init_cmds[cmd].databytes&0x1F);
+        cmd++;
+    }
+}
+
+//Initialize the display
+void scrn_init(spi_device_handle_t spi)
+{
+    scrn_reset();
+    scrn_send_init(spi, scrn_init_cmds);
+}
+
+esp_err_t scrn_bus_init(void)
+{
+    spi_bus_config_t buscfg={
+        .mosi_io_num=MOSI_PIN,
+        .sclk_io_num=CLK_PIN,
+        .quadwp_io_num=-1,
+        .quadhd_io_num=-1,
+        .max_transfer_sz=SCRN_MAX_TRANSFER
+    };
+    return spi_bus_initialize(HSPI_HOST, &buscfg, 1);
+}
+
+esp_err_t scrn_add_device(int cs_pin, spi_device_handle_t *spi)
+{
+    spi_device_interface_config_t devcfg={
+        .clock_speed_hz=SCRN_CLOCK_HZ,
+        .mode=0,                                //SPI mode 0
+        .spics_io_num=cs_pin,                   //CS pin
+        .queue_size=SCRN_QUEUE_SIZE,            //We want to be able to queue 17 transactions at a time
+        .pre_cb=scrn_spi_pre_transfer_callback, //Specify pre-transfer callback to handle D/C line
+        .post_cb=scrn_spi_post_transfer_callback //And post-transfer callback to signal finished frames
+    };
+    return spi_bus_add_device(HSPI_HOST, &devcfg, spi);
+}
+
+//Bring up the SPI bus, attach the screen to it and initialize the screen
+spi_device_handle_t scrn_open(void)
+{
+    esp_err_t ret;
+    spi_device_handle_t spi;
+    //Initialize the SPI bus
+    ret=scrn_bus_init();
+    ESP_ERROR_CHECK(ret);
+    //Attach the scrn to the SPI bus
+    ret=scrn_add_device(CS_PIN, &spi);
+    ESP_ERROR_CHECK(ret);
+    //Initialize the scrn
+    scrn_init(spi);
+    return spi;
+}
+
+void send_lines(spi_device_handle_t spi, uint8_t *linedata)
+{
+    esp_err_t ret;
+    static spi_transaction_t trans[16];
+
+    memset(&trans, 0, sizeof(trans));
+    for (int i=0;i<16;i+=2) {
+        trans[i].length=8*3;
+        trans[i].user=(void*)0;
+        trans[i].flags=SPI_TRANS_USE_TXDATA;
+        trans[i].tx_data[0]=0xB0+(i/2);
+        trans[i].tx_data[1]=SCRN_COL_OFFSET&0x0F;
+        trans[i].tx_data[2]=0x10|(SCRN_COL_OFFSET>>4);
+        trans[i+1].length=1024;
+        trans[i+1].user=(void*)1;  
+        trans[i+1].tx_buffer=linedata+128*(i/2);
+        trans[i+1].flags=0; //undo SPI_TRANS_USE_TXDATA flag
+    }
+
+    spi_transaction_t *rtrans;
+    for (int i=0;i<16;i+=1) {
+        ret=spi_device_queue_trans(spi, &trans[i], portMAX_DELAY);
+        assert(ret==ESP_OK);
+    }
+    TRACE_BEGIN(TRACE_SPI_WAIT);
+    for (int i=0;i<16;i++) {
+        ret=spi_device_get_trans_result(spi, &rtrans, portMAX_DELAY);
+        assert(ret==ESP_OK);
+    }
+    TRACE_END(TRACE_SPI_WAIT);
+}
+
+#ifdef SCRN_SSD1306
+DRAM_ATTR static const uint8_t scrn_flush_window[]={
+    0x20, 0x00,                      //Horizontal addressing
+    0x21, 0, SCRN_WIDTH-1,           //Columns
+    0x22, 0, SCRN_PAGES-1            //Pages
+};
+#endif
+
+bool scrn_flush_init(scrn_flush_t *f, spi_device_handle_t spi)
+{
+    memset(f, 0, sizeof(*f));
+    f->spi=spi;
+    f->done=xSemaphoreCreateBinary();
+    if (f->done==NULL) return false;
+#ifdef SCRN_SSD1306
+    f->trans[0].length=8*sizeof(scrn_flush_window);
+    f->trans[0].user=(void*)0;
+    f->trans[0].tx_buffer=scrn_flush_window;
+    f->trans[1].length=8*SCRN_BUF_SIZE;
+    f->trans[1].user=(void*)SCRN_TRANS_DC;
+    f->trans[2].length=8*2;
+    f->trans[2].flags=SPI_TRANS_USE_TXDATA;
+    f->trans[2].tx_data[0]=0x20;
+    f->trans[2].tx_data[1]=0x02;
+#else
+    for (int page=0;page<SCRN_PAGES;page++) {
+        spi_transaction_t *t=&f->trans[2*page];
+        t[0].length=8*3;
+        t[0].user=(void*)0;
+        t[0].flags=SPI_TRANS_USE_TXDATA;
+        t[0].tx_data[0]=0xB0+page;
+        t[0].tx_data[1]=SCRN_COL_OFFSET&0x0F;
+        t[0].tx_data[2]=0x10|(SCRN_COL_OFFSET>>4);
+        t[1].length=8*SCRN_WIDTH;
+        t[1].user=(void*)SCRN_TRANS_DC;
+    }
+#endif
+    //scrn_flush_t is at least pointer aligned, which leaves the low bits free
+    f->trans[SCRN_FLUSH_TRANS-1].user=(void*)((intptr_t)f|(intptr_t)f->trans[SCRN_FLUSH_TRANS-1].user|SCRN_TRANS_FRAME_END);
+    return true;
+}
+
+void scrn_flush_free(scrn_flush_t *f)
+{
+    scrn_flush_wait(f);
+    vSemaphoreDelete(f->done);
+    f->done=NULL;
+}
+
+void scrn_flush_wait(scrn_flush_t *f)
+{
+    esp_err_t ret;
+    spi_transaction_t *rtrans;
+    if (f->in_flight==0) return;
+    TRACE_BEGIN(TRACE_SPI_WAIT);
+    xSemaphoreTake(f->done, portMAX_DELAY);
+    //All off the wire by now, the results follow at once
+    for (;f->in_flight>0;f->in_flight--) {
+        ret=spi_device_get_trans_result(f->spi, &rtrans, portMAX_DELAY);
+        assert(ret==ESP_OK);
+    }
+    TRACE_END(TRACE_SPI_WAIT);
+}
+
+void scrn_flush_async(scrn_flush_t *f, const uint8_t *lines)
+{
+    esp_err_t ret;
+    scrn_flush_wait(f);
+#ifdef SCRN_SSD1306
+    f->trans[1].tx_buffer=lines;
+#else
+    for (int page=0;page<SCRN_PAGES;page++) {
+        f->trans[2*page+1].tx_buffer=lines+SCRN_WIDTH*page;
+    }
+#endif
+    for (int i=0;i<SCRN_FLUSH_TRANS;i++) {
+        ret=spi_device_queue_trans(f->spi, &f->trans[i], portMAX_DELAY);
+        assert(ret==ESP_OK);
+    }
+    f->in_flight=SCRN_FLUSH_TRANS;
+    f->frames++;
+}
+
+void scrn_flush(scrn_flush_t *f, const uint8_t *lines)
+{
+    scrn_flush_async(f, lines);
+    scrn_flush_wait(f);
+}
+
+void scrn_delta_init(scrn_delta_t *d, spi_device_handle_t spi)
+{
+    memset(d, 0, sizeof(*d));
+    d->spi=spi;
+}
+
+void scrn_delta_invalidate(scrn_delta_t *d)
+{
+    d->shadow_valid=false;
+}
+
+//Wait for n queued transactions to complete
+static void scrn_delta_drain(spi_device_handle_t spi, int n)
+{
+    esp_err_t ret;
+    spi_transaction_t *rtrans;
+    TRACE_BEGIN(TRACE_SPI_WAIT);
+    for (int i=0;i<n;i++) {
+        ret=spi_device_get_trans_result(spi, &rtrans, portMAX_DELAY);
+        assert(ret==ESP_OK);
+    }
+    TRACE_END(TRACE_SPI_WAIT);
+}
+
+//Columns outside the tiles of row count as unchanged
+static inline bool scrn_delta_changed(uint16_t row, const uint8_t *src, const uint8_t *shadow, int x)
+{
+    return ((row>>(x/SCRN_TILE_COLS))&1) && src[x]!=shadow[x];
+}
+
+bool scrn_delta_next_range(uint16_t row, const uint8_t *src, const uint8_t *shadow, int *x, int *start, int *end)
+{
+    int c=*x;
+    while (c<SCRN_WIDTH && !scrn_delta_changed(row, src, shadow, c)) c++;
+    if (c==SCRN_WIDTH) {
+        *x=c;
+        return false;
+    }
+    *start=c;
+    *end=c+1;
+    //Extend the range over short unchanged gaps
+    while (c<SCRN_WIDTH) {
+        if (scrn_delta_changed(row, src, shadow, c)) {
+            *end=++c;
+        } else if (c-*end<SCRN_DELTA_GAP) {
+            c++;
+        } else {
+            break;
+        }
+    }
+    *x=c;
+    return true;
+}
+
+void scrn_delta_flush(scrn_delta_t *d, const uint8_t *lines)
+{
+    scrn_tiles_t all;
+    scrn_tiles_fill(&all);
+    scrn_delta_flush_tiles(d, lines, &all);
+}
+
+void scrn_delta_flush_tiles(scrn_delta_t *d, const uint8_t *lines, const scrn_tiles_t *tiles)
+{
+    esp_err_t ret;
+    //Two transactions per column range: the address, then the data
+    static spi_transaction_t trans[SCRN_QUEUE_SIZE&~1];
+    int queued=0;
+
+    d->frame_bytes=0;
+    d->frame_transactions=0;
+    for (int page=0;page<SCRN_PAGES;page++) {
+        const uint8_t *src=lines+SCRN_WIDTH*page;
+        uint8_t *shadow=d->shadow+SCRN_WIDTH*page;
+        uint16_t row=tiles->rows[page];
+        int x=0;
+        if (d->shadow_valid && row==0) continue;
+        while (x<SCRN_WIDTH) {
+            int start, end;
+            if (d->shadow_valid) {
+                if (!scrn_delta_next_range(row, src, shadow, &x, &start, &end)) break;
+            } else {
+                start=0;
+                end=x=SCRN_WIDTH;
+            }
+            memcpy(shadow+start, src+start, end-start);
+
+            if (queued==sizeof(trans)/sizeof(trans[0])) {
+                scrn_delta_drain(d->spi, queued);
+                queued=0;
+            }
+            uint8_t col=start+SCRN_COL_OFFSET;
+            spi_transaction_t *t=&trans[queued];
+            memset(t, 0, 2*sizeof(spi_transaction_t));
+            t[0].length=8*3;
+            t[0].user=(void*)0;
+            t[0].flags=SPI_TRANS_USE_TXDATA;
+            t[0].tx_data[0]=0xB0+page;
+            t[0].tx_data[1]=col&0x0F;
+            t[0].tx_data[2]=0x10|(col>>4);
+            t[1].length=8*(end-start);
+            t[1].user=(void*)SCRN_TRANS_DC;
+            //Sent from the shadow, which stays put until the transaction is done
+            t[1].tx_buffer=shadow+start;
+            for (int i=0;i<2;i++) {
+                ret=spi_device_queue_trans(d->spi, &t[i], portMAX_DELAY);
+                assert(ret==ESP_OK);
+            }
+            queued+=2;
+            d->frame_bytes+=3+end-start;
+            d->frame_transactions+=2;
+        }
+    }
+    scrn_delta_drain(d->spi, queued);
+    d->shadow_valid=true;
+    d->frames++;
+    d->total_bytes+=d->frame_bytes;
+}
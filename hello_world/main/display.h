@@ -0,0 +1,112 @@
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "driver/spi_master.h"
+#include "framebuffer.h"
+
+//Define SCRN_SSD1306 for an SSD1306 panel instead of the SH1106. It can take
+//a whole frame in one transaction, the SH1106 needs a new address every page.
+
+//Depth of the SPI transaction queue of the screen device
+#define SCRN_QUEUE_SIZE 17
+#define SCRN_CLOCK_HZ 20000000
+#ifdef SCRN_SSD1306
+#define SCRN_COL_OFFSET 0
+#else
+//The SH1106 has 132 columns of RAM, the visible 128 start at column 2
+#define SCRN_COL_OFFSET 2
+#endif
+//Largest single transfer the bus is set up for, a whole frame
+#define SCRN_MAX_TRANSFER SCRN_BUF_SIZE
+//Bits of spi_transaction_t.user: the D/C level, and whether the transaction
+//ends a scrn_flush_t frame. The transaction that does holds the address of
+//its scrn_flush_t in the rest of user.
+#define SCRN_TRANS_DC 1
+#define SCRN_TRANS_FRAME_END 2
+#define SCRN_TRANS_BITS 3
+//Unchanged runs shorter than this are sent anyway rather than paying
+//for a new column address and two more transactions
+#define SCRN_DELTA_GAP 24
+
+typedef struct {
+    uint8_t cmd;
+    uint8_t data[16];
+    uint8_t databytes; //No of data in data; bit 7 = delay after set; 0xFF = end of cmds.
+} scrn_init_cmd_t;
+
+//What scrn_init sends, ending with databytes 0xFF
+extern const scrn_init_cmd_t scrn_init_cmds[];
+
+void scrn_cmd(spi_device_handle_t spi, const uint8_t cmd);
+void scrn_data(spi_device_handle_t spi, const uint8_t *data, int len);
+void scrn_spi_pre_transfer_callback(spi_transaction_t *t);
+void scrn_spi_post_transfer_callback(spi_transaction_t *t);
+//Pulse RST_PIN, which resets every panel wired to it
+void scrn_reset(void);
+void scrn_send_init(spi_device_handle_t spi, const scrn_init_cmd_t *init_cmds);
+//scrn_reset, then scrn_init_cmds
+void scrn_init(spi_device_handle_t spi);
+//HSPI_HOST with the screen's pins, then a screen device with its CS on cs_pin
+esp_err_t scrn_bus_init(void);
+esp_err_t scrn_add_device(int cs_pin, spi_device_handle_t *spi);
+spi_device_handle_t scrn_open(void);
+void send_lines(spi_device_handle_t spi, uint8_t *linedata);
+
+//Whole frame flush. The transactions are built once by scrn_flush_init,
+//a flush only points them at the new frame and queues them.
+#ifdef SCRN_SSD1306
+//Horizontal addressing over the whole screen, the frame, back to page
+//addressing for the delta flush
+#define SCRN_FLUSH_TRANS 3
+#else
+//Address and data for each page
+#define SCRN_FLUSH_TRANS (2*SCRN_PAGES)
+#endif
+
+typedef struct {
+    spi_transaction_t trans[SCRN_FLUSH_TRANS];
+    spi_device_handle_t spi;
+    SemaphoreHandle_t done;          //Given when the last transaction of a frame is off the wire
+    void (*on_done)(void *arg);      //Called from the SPI interrupt at the same time, may be NULL
+    void *on_done_arg;
+    int in_flight;                   //Transactions queued whose results were not collected yet
+    uint32_t frames;
+} scrn_flush_t;
+
+bool scrn_flush_init(scrn_flush_t *f, spi_device_handle_t spi);
+void scrn_flush_free(scrn_flush_t *f);
+//Start sending lines and return straight away. lines must not change until
+//the flush is done. Waits for the previous frame if it is still going.
+void scrn_flush_async(scrn_flush_t *f, const uint8_t *lines);
+//Wait until the last frame started is on the panel
+void scrn_flush_wait(scrn_flush_t *f);
+void scrn_flush(scrn_flush_t *f, const uint8_t *lines);
+
+//Delta flush: remembers what the panel shows and only sends what changed
+typedef struct {
+    spi_device_handle_t spi;
+    uint8_t shadow[SCRN_BUF_SIZE];   //Copy of the panel contents
+    bool shadow_valid;               //False until a full frame has been sent
+    uint32_t frame_bytes;            //Bytes sent by the last flush, addressing included
+    uint32_t frame_transactions;     //Transactions queued by the last flush
+    uint32_t frames;                 //Number of flushes
+    uint64_t total_bytes;            //Bytes sent since init
+} scrn_delta_t;
+
+void scrn_delta_init(scrn_delta_t *d, spi_device_handle_t spi);
+//Forget the panel contents, the next flush sends the whole frame
+void scrn_delta_invalidate(scrn_delta_t *d);
+//Send the columns of lines that differ from what the panel shows
+void scrn_delta_flush(scrn_delta_t *d, const uint8_t *lines);
+//Same, only looking for changes inside the given tiles
+void scrn_delta_flush_tiles(scrn_delta_t *d, const uint8_t *lines, const scrn_tiles_t *tiles);
+//The next range of columns of a page to send: from *x on, the columns in
+//the tiles of row where src differs from shadow, with gaps shorter than
+//SCRN_DELTA_GAP between them. *x moves past it. False if there is none.
+bool scrn_delta_next_range(uint16_t row, const uint8_t *src, const uint8_t *shadow, int *x, int *start, int *end);
+
+#endif
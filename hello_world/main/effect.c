@@ -0,0 +1,228 @@
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "effect.h"
+#include "trace.h"
+
+//States are carved on this, which is enough for any field in them
+#define EFFECT_ALIGN 8
+
+static size_t effect_align(size_t size) {
+    return (size+EFFECT_ALIGN-1)&~(size_t) (EFFECT_ALIGN-1);
+}
+
+bool effect_runner_init(effect_runner_t *r, scrn_delta_t *scrn, const effect_t *const *effects, int count,
+        uint8_t *arena, size_t arena_size, bool keep) {
+    memset(r, 0, sizeof(*r));
+    if (count<1 || count>EFFECT_MAX || arena==NULL) return false;
+    r->scrn = scrn;
+    r->count = count;
+    r->current = -1;
+    r->keep = keep;
+    r->arena = arena;
+    r->arena_size = arena_size;
+    for (int i=0;i<count;i++) {
+        size_t size = effect_align(effects[i]->state_size);
+        r->slots[i].effect = effects[i];
+        r->slots[i].set_up = effects[i]->setup==NULL || effects[i]->setup();
+        if (keep) {
+            r->slots[i].state = arena+r->arena_used;
+            r->arena_used += size;
+        } else {
+            //All of them at the start, the largest decides
+            r->slots[i].state = arena;
+            if (size>r->arena_used) r->arena_used = size;
+        }
+    }
+    if (r->arena_used>arena_size) {
+        printf("effect: states need %u bytes, the arena has %u\n", (unsigned) r->arena_used, (unsigned) arena_size);
+        return false;
+    }
+    //Whatever was on the panel before, the first frame sends all of it
+    scrn_delta_invalidate(scrn);
+    return true;
+}
+
+static void effect_drop(effect_slot_t *slot) {
+    if (!slot->ready) return;
+    if (slot->effect->release) slot->effect->release(slot->state);
+    slot->ready = false;
+}
+
+//Make index the running effect, starting it if its state is not there
+static bool effect_enter(effect_runner_t *r, int index) {
+    effect_slot_t *slot = &r->slots[index];
+    const effect_t *e = slot->effect;
+    if (slot->ready) {
+        frame_sched_resume(&slot->sched);
+    } else {
+        memset(slot->state, 0, e->state_size);
+        frame_sched_init(&slot->sched, e->name, e->fps, e->steps_per_s);
+        if (!slot->set_up || !e->init(slot->state, &slot->sched)) {
+            printf("effect: %s did not start\n", e->name);
+            r->failures++;
+            return false;
+        }
+        slot->ready = true;
+    }
+    r->current = index;
+    r->redraw = true;
+    return true;
+}
+
+bool effect_runner_switch(effect_runner_t *r, int index, int direction, int64_t since) {
+    if (index==r->current) return true;
+    //Sharing the region, the one leaving goes
+    if (!r->keep && r->current>=0) effect_drop(&r->slots[r->current]);
+    for (int i=0;i<r->count;i++) {
+        if (effect_enter(r, index)) {
+            if (since) r->switch_at = since;
+            printf("effect: %s\n", r->slots[index].effect->name);
+            return true;
+        }
+        index = (index+direction+r->count)%r->count;
+    }
+    r->current = -1;
+    return false;
+}
+
+bool effect_runner_restart(effect_runner_t *r, int64_t since) {
+    int index = r->current;
+    if (index<0) return false;
+    effect_drop(&r->slots[index]);
+    r->current = -1;
+    return effect_runner_switch(r, index, 1, since);
+}
+
+static void effect_pass(effect_runner_t *r, const input_event_t *event) {
+    effect_slot_t *slot = &r->slots[r->current];
+    slot->effect->handle_input(slot->state, event);
+}
+
+//MODE is held back until it is let go or used for a switch
+static void effect_input(effect_runner_t *r, const input_event_t *event) {
+    if (r->current<0) return;
+    if (event->button==INPUT_MODE) {
+        if (event->type==INPUT_PRESS) {
+            r->mode_down = true;
+            r->mode_chord = false;
+            r->mode_press = *event;
+        } else if (event->type==INPUT_RELEASE && r->mode_down) {
+            r->mode_down = false;
+            if (!r->mode_chord) {
+                effect_pass(r, &r->mode_press);
+                effect_pass(r, event);
+            }
+        }
+        return;
+    }
+    if (!r->mode_down || event->button==INPUT_C) {
+        effect_pass(r, event);
+        return;
+    }
+    //U/L/D/R with MODE held are the runner's
+    r->mode_chord = true;
+    if (event->type!=INPUT_PRESS) return;
+    if (event->button==INPUT_R) {
+        effect_runner_switch(r, (r->current+1)%r->count, 1, event->time_us);
+    } else if (event->button==INPUT_L) {
+        effect_runner_switch(r, (r->current+r->count-1)%r->count, -1, event->time_us);
+    } else if (event->button==INPUT_D) {
+        effect_runner_restart(r, event->time_us);
+    } else if (event->button==INPUT_U) {
+        trace_dump();
+    }
+}
+
+void effect_runner_input(effect_runner_t *r, const input_event_t *event) {
+    effect_input(r, event);
+}
+
+void effect_runner_frame(effect_runner_t *r) {
+    input_event_t event;
+    TRACE_BEGIN(TRACE_INPUT);
+    while (input_poll(&event)) effect_input(r, &event);
+    TRACE_END(TRACE_INPUT);
+    if (r->current<0) {
+        vTaskDelay(1);
+        return;
+    }
+    effect_runner_frame_steps(r, frame_sched_begin(&r->slots[r->current].sched));
+}
+
+void effect_runner_frame_steps(effect_runner_t *r, uint32_t steps) {
+    scrn_tiles_t tiles;
+    if (r->current<0) return;
+    effect_slot_t *slot = &r->slots[r->current];
+    const effect_t *e = slot->effect;
+    TRACE_BEGIN(TRACE_STEP);
+    steps = e->step(slot->state, steps);
+    TRACE_END(TRACE_STEP);
+    TRACE_BEGIN(TRACE_RENDER);
+    const uint8_t *frame = e->render(slot->state, &tiles);
+    TRACE_END(TRACE_RENDER);
+    if (r->redraw) {
+        r->redraw = false;
+        scrn_tiles_fill(&tiles);
+    }
+    frame_sched_computed(&slot->sched, steps);
+    if (scrn_tiles_count(&tiles)) {
+        TRACE_BEGIN(TRACE_FLUSH);
+        scrn_delta_flush_tiles(r->scrn, frame, &tiles);
+        TRACE_END(TRACE_FLUSH);
+    }
+    if (e->shown) e->shown(slot->state);
+    r->frame = frame;
+    frame_sched_flushed(&slot->sched);
+    if (r->switch_at) {
+        int64_t us = esp_timer_get_time()-r->switch_at;
+        r->switch_at = 0;
+        r->switches++;
+        r->switch_last_us = us;
+        r->switch_total_us += us;
+        if (us>r->switch_max_us) r->switch_max_us = us;
+        if (us>(int64_t) slot->sched.period*1000000/configTICK_RATE_HZ) r->switches_late++;
+    }
+}
+
+void effect_runner_wait(effect_runner_t *r) {
+    input_event_t event;
+    TickType_t left;
+    if (r->current<0) return;
+    int current = r->current;
+    TRACE_BEGIN(TRACE_IDLE);
+    //The last tick goes to frame_sched_wait, which keeps the grid of frames;
+    //what comes in then waits for the next frame
+    while ((left = frame_sched_remaining(&r->slots[current].sched))>1 && input_wait(&event, left-1)) {
+        effect_input(r, &event);
+        if (r->switch_at || r->current!=current) {
+            TRACE_END(TRACE_IDLE);
+            return;
+        }
+    }
+    frame_sched_wait(&r->slots[current].sched);
+    TRACE_END(TRACE_IDLE);
+}
+
+void effect_runner_run(effect_runner_t *r) {
+    while (1) {
+        effect_runner_frame(r);
+        effect_runner_wait(r);
+    }
+}
+
+int effect_runner_find(const effect_runner_t *r, const char *name) {
+    for (int i=0;i<r->count;i++) {
+        if (!strcmp(r->slots[i].effect->name, name)) return i;
+    }
+    return -1;
+}
+
+void effect_runner_print_stats(const effect_runner_t *r) {
+    printf("effect: %d effects in %u of %u arena bytes (%s), %u did not start, %u switches, %u over a frame,"
+            " %.0f us average, %lld us max\n", r->count, (unsigned) r->arena_used, (unsigned) r->arena_size,
+            r->keep ? "kept" : "shared", (unsigned) r->failures, (unsigned) r->switches, (unsigned) r->switches_late,
+            r->switches ? (double) r->switch_total_us/r->switches : 0.0, (long long) r->switch_max_us);
+}
@@ -0,0 +1,115 @@
+#ifndef EFFECT_H
+#define EFFECT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "display.h"
+#include "input.h"
+#include "frame_sched.h"
+
+//Runs effects one at a time, each a state struct and the functions below,
+//and switches between them on the buttons. The runner polls the buttons,
+//paces the frames and flushes; an effect only steps and draws.
+//
+//Every state comes out of one arena handed to the runner, so switching
+//allocates nothing. Either each effect has a region of its own and keeps
+//its state while the others run, or they all share one as large as the
+//largest and start over each time they come back. What does not fit in a
+//state (the HashLife pool, the pipeline's frames and task, the stream's UART
+//driver) an effect takes in setup, which effect_runner_init calls, and holds
+//from then on; init and release only start and park it. After
+//effect_runner_init a switch takes nothing from the heap.
+//
+//MODE held with R goes to the next effect, with L to the one before, with
+//D starts the one running over and with U prints the trace (trace.h). A
+//press of MODE on its own reaches the effect when MODE is let go, as a press
+//and a release.
+
+//An effect that needs more does not fit
+#define EFFECT_ARENA_SIZE (48*1024)
+#define EFFECT_MAX 8
+
+typedef struct {
+    const char *name;
+    float fps;                               //As for frame_sched_init
+    uint32_t steps_per_s;
+    size_t state_size;
+    //Take what does not fit in a state, the first time it is called; later
+    //calls find it there. False leaves the effect out. May be NULL.
+    bool (*setup)(void);
+    //Start in state, state_size bytes zeroed. sched paces the effect for as
+    //long as the state lives. False if it cannot run.
+    bool (*init)(void *state, frame_sched_t *sched);
+    //The state is dropped, may be NULL
+    void (*release)(void *state);
+    void (*handle_input)(void *state, const input_event_t *event);
+    //Run up to steps steps, return how many ran
+    uint32_t (*step)(void *state, uint32_t steps);
+    //The frame to show, and in tiles where it may differ from the one
+    //returned before. It stays as it is until the next step.
+    const uint8_t *(*render)(void *state, scrn_tiles_t *tiles);
+    //The frame render returned is on the panel now, may be NULL
+    void (*shown)(void *state);
+} effect_t;
+
+typedef struct {
+    const effect_t *effect;
+    void *state;                             //In the arena
+    bool set_up;                             //setup did not fail
+    bool ready;                              //init ran and the state is still there
+    frame_sched_t sched;
+} effect_slot_t;
+
+typedef struct {
+    scrn_delta_t *scrn;
+    effect_slot_t slots[EFFECT_MAX];
+    int count;
+    int current;                             //-1 until the first switch
+    bool keep;                               //Each effect has its own region
+    uint8_t *arena;
+    size_t arena_size;
+    size_t arena_used;                       //Carved out for the states
+    bool redraw;                             //Flush every tile, the panel shows another effect
+    const uint8_t *frame;                    //Flushed last
+    bool mode_down;                          //MODE held, its press not passed on
+    bool mode_chord;                         //A switch was made with it held
+    input_event_t mode_press;
+    int64_t switch_at;                       //When the button asking for a switch was read, 0 for none pending
+    uint32_t switches;
+    uint32_t switches_late;                  //Took longer than a frame of the effect switched to
+    uint32_t failures;                       //Effects that did not start
+    int64_t switch_last_us;                  //From the button to the first frame on the panel
+    int64_t switch_max_us;
+    int64_t switch_total_us;
+} effect_runner_t;
+
+//Carve the states of count effects out of arena, one region each with keep
+//or one for all of them. False if they do not fit. Nothing runs until the
+//first effect_runner_switch, whose first frame is sent whole. Each effect's
+//setup is called here.
+bool effect_runner_init(effect_runner_t *r, scrn_delta_t *scrn, const effect_t *const *effects, int count,
+        uint8_t *arena, size_t arena_size, bool keep);
+//Go to effect index, or the first that starts going on from it in direction,
+//1 or -1. since is when the switch was asked for, for the stats, 0 not to
+//count it. False if none starts.
+bool effect_runner_switch(effect_runner_t *r, int index, int direction, int64_t since);
+//Drop the running effect's state and start it again
+bool effect_runner_restart(effect_runner_t *r, int64_t since);
+//Take the events waiting, then step, render and flush a frame
+void effect_runner_frame(effect_runner_t *r);
+//A frame of exactly steps steps, whenever it is called: for golden frames,
+//which have to come out the same on every run
+void effect_runner_frame_steps(effect_runner_t *r, uint32_t steps);
+//Handle event as if it had come from the buttons
+void effect_runner_input(effect_runner_t *r, const input_event_t *event);
+//Until the next frame is due, passing events on as they come. A switch
+//cuts it short, so the new effect's first frame starts at once.
+void effect_runner_wait(effect_runner_t *r);
+//Frames for ever
+void effect_runner_run(effect_runner_t *r);
+//Index of the effect called name, -1 if there is none
+int effect_runner_find(const effect_runner_t *r, const char *name);
+void effect_runner_print_stats(const effect_runner_t *r);
+
+#endif
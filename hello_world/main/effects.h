@@ -0,0 +1,28 @@
+#ifndef EFFECTS_H
+#define EFFECTS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "display.h"
+#include "effect.h"
+
+//Life patterns, as x, y pairs
+extern const uint8_t glider[10];
+extern const uint8_t glider_gun[72];
+
+extern const effect_t effect_life;
+extern const effect_t effect_ant;
+extern const effect_t effect_pattern;
+extern const effect_t effect_hashlife;
+extern const effect_t effect_life_pipelined;
+extern const effect_t effect_stream;
+//What app_main runs
+extern const effect_t *const effect_list[];
+extern const int effect_list_count;
+
+//Run the effects of effect_list from the one called first, NULL for the
+//first of them. Returns only if there is no such effect or no memory.
+void display_effects(scrn_delta_t *scrn, const char *first);
+void langton_ant_move(uint8_t position[2], uint8_t *direction, bool a, uint8_t *lines);
+
+#endif
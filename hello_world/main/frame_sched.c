@@ -0,0 +1,193 @@
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "frame_sched.h"
+#include "trace.h"
+
+//Weight of the newest frame in the running cost per step, out of 1
+#define FRAME_SCHED_COST_WEIGHT 0.25f
+
+static void frame_sched_add(frame_sched_timing_t *t, int64_t us)
+{
+    uint32_t v=us>0 ? (uint32_t) us : 0;
+    if (t->count==0 || v<t->min_us) t->min_us=v;
+    if (v>t->max_us) t->max_us=v;
+    t->sum_us+=v;
+    t->samples[t->count%FRAME_SCHED_WINDOW]=v;
+    t->count++;
+}
+
+static void frame_sched_summarise(const frame_sched_timing_t *t, frame_sched_summary_t *out)
+{
+    uint32_t sorted[FRAME_SCHED_WINDOW];
+    uint32_t n=t->count<FRAME_SCHED_WINDOW ? t->count : FRAME_SCHED_WINDOW;
+    memset(out, 0, sizeof(*out));
+    if (n==0) return;
+    out->min_us=t->min_us;
+    out->max_us=t->max_us;
+    out->avg_us=t->sum_us/t->count;
+    //Insertion sort, the window is small and this only runs for reports
+    for (uint32_t i=0;i<n;i++) {
+        uint32_t v=t->samples[i], j=i;
+        while (j>0 && sorted[j-1]>v) {
+            sorted[j]=sorted[j-1];
+            j--;
+        }
+        sorted[j]=v;
+    }
+    out->p99_us=sorted[(n*99+99)/100-1];
+}
+
+void frame_sched_init(frame_sched_t *s, const char *name, float fps, uint32_t steps_per_s)
+{
+    memset(s, 0, sizeof(*s));
+    s->name=name;
+    s->period=(TickType_t) (configTICK_RATE_HZ/fps+0.5f);
+    if (s->period==0) s->period=1;
+    s->steps_per_s=steps_per_s;
+    s->started_at=esp_timer_get_time();
+    s->reported_at=s->started_at;
+    s->flushed_at=s->started_at;
+    s->resumed_at=s->started_at;
+    s->last_wake=xTaskGetTickCount();
+}
+
+void frame_sched_set_rate(frame_sched_t *s, uint32_t steps_per_s)
+{
+    s->steps_per_s=steps_per_s;
+    s->steps_due=0;
+}
+
+uint32_t frame_sched_begin(frame_sched_t *s)
+{
+    int64_t now=esp_timer_get_time();
+    float period_us=(float) s->period*1000000/configTICK_RATE_HZ;
+    float wanted;
+    s->frame_at=now;
+    if (s->steps_per_s==0) {
+        s->steps=1;
+        return s->steps;
+    }
+    if (s->steps_per_s==FRAME_SCHED_FLAT_OUT) {
+        wanted=UINT32_MAX;
+    } else {
+        s->steps_due+=s->steps_per_s*period_us/1000000;
+        wanted=s->steps_due;
+    }
+    //What the frame has left once the flush is paid for
+    if (s->step_cost_us>0) {
+        float budget=period_us*(100-FRAME_SCHED_MARGIN_PCT)/100;
+        if (s->flush.count) budget-=(float) s->flush.sum_us/s->flush.count;
+        float fits=budget>s->step_cost_us ? budget/s->step_cost_us : 1;
+        if (wanted>fits) {
+            wanted=fits;
+            if (s->steps_per_s!=FRAME_SCHED_FLAT_OUT) s->starved++;
+        }
+    } else if (s->steps_per_s==FRAME_SCHED_FLAT_OUT) {
+        //Nothing measured yet, one step to learn the cost
+        wanted=1;
+    }
+    s->steps=wanted<1 ? 0 : wanted>=UINT32_MAX ? UINT32_MAX : (uint32_t) wanted;
+    if (s->steps_per_s!=FRAME_SCHED_FLAT_OUT) {
+        s->steps_due-=s->steps;
+        //Steps that did not fit are dropped rather than owed, or a slow
+        //patch would be followed by frames trying to catch up
+        if (s->steps_due>1) s->steps_due=1;
+    }
+    return s->steps;
+}
+
+void frame_sched_computed(frame_sched_t *s, uint32_t steps)
+{
+    int64_t now=esp_timer_get_time();
+    frame_sched_add(&s->compute, now-s->frame_at);
+    s->computed_at=now;
+    s->total_steps+=steps;
+    if (steps) {
+        float cost=(float) (now-s->frame_at)/steps;
+        if (s->step_cost_us==0) {
+            s->step_cost_us=cost;
+        } else {
+            s->step_cost_us+=(cost-s->step_cost_us)*FRAME_SCHED_COST_WEIGHT;
+        }
+        //Keep it above zero so it still counts as measured
+        if (s->step_cost_us<0.001f) s->step_cost_us=0.001f;
+    }
+}
+
+void frame_sched_flushed(frame_sched_t *s)
+{
+    int64_t now=esp_timer_get_time();
+    frame_sched_add(&s->flush, now-s->computed_at);
+    s->flushed_at=now;
+}
+
+void frame_sched_wait(frame_sched_t *s)
+{
+    TickType_t now=xTaskGetTickCount();
+    s->frames++;
+    if ((int32_t) (now-(s->last_wake+s->period))>=0) {
+        //Late already: start the grid again from here instead of rushing
+        //through frames to catch up
+        s->overruns++;
+        s->last_wake=now;
+        frame_sched_add(&s->idle, 0);
+    } else {
+        TRACE_BEGIN(TRACE_DELAY);
+        vTaskDelayUntil(&s->last_wake, s->period);
+        TRACE_END(TRACE_DELAY);
+        frame_sched_add(&s->idle, esp_timer_get_time()-s->flushed_at);
+    }
+    if (FRAME_SCHED_REPORT_US && s->name!=NULL && esp_timer_get_time()-s->reported_at>=FRAME_SCHED_REPORT_US) {
+        frame_sched_print(s);
+        s->reported_at=esp_timer_get_time();
+    }
+}
+
+TickType_t frame_sched_remaining(const frame_sched_t *s)
+{
+    int32_t left=s->last_wake+s->period-xTaskGetTickCount();
+    return left>0 ? left : 0;
+}
+
+void frame_sched_resume(frame_sched_t *s)
+{
+    int64_t now=esp_timer_get_time();
+    s->last_wake=xTaskGetTickCount();
+    s->started_at+=now-s->flushed_at;
+    s->resumed_at=now;
+    s->flushed_at=now;
+    s->steps_due=0;
+}
+
+void frame_sched_get_stats(frame_sched_t *s, frame_sched_stats_t *stats)
+{
+    float elapsed=(esp_timer_get_time()-s->started_at)/1000000.0f;
+    memset(stats, 0, sizeof(*stats));
+    stats->frames=s->frames;
+    stats->overruns=s->overruns;
+    stats->starved=s->starved;
+    if (elapsed>0) {
+        stats->fps=s->frames/elapsed;
+        stats->steps_per_s=s->total_steps/elapsed;
+    }
+    frame_sched_summarise(&s->compute, &stats->compute);
+    frame_sched_summarise(&s->flush, &stats->flush);
+    frame_sched_summarise(&s->idle, &stats->idle);
+}
+
+void frame_sched_print(frame_sched_t *s)
+{
+    frame_sched_stats_t stats;
+    const frame_sched_summary_t *phases[]={&stats.compute, &stats.flush, &stats.idle};
+    const char *names[]={"compute", "flush", "idle"};
+    frame_sched_get_stats(s, &stats);
+    printf("%s: %.1f fps, %.0f steps/s, %u overruns, %u starved\n", s->name ? s->name : "frame",
+            stats.fps, stats.steps_per_s, (unsigned) stats.overruns, (unsigned) stats.starved);
+    for (int i=0;i<3;i++) {
+        printf("  %-7s min %u avg %u max %u p99 %u us\n", names[i], (unsigned) phases[i]->min_us,
+                (unsigned) phases[i]->avg_us, (unsigned) phases[i]->max_us, (unsigned) phases[i]->p99_us);
+    }
+}
@@ -0,0 +1,101 @@
+#ifndef FRAME_SCHED_H
+#define FRAME_SCHED_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+
+//Frame pacing for the effects. Each frame goes
+//
+//    steps = frame_sched_begin(&s);
+//    ...run steps simulation steps, draw...
+//    frame_sched_computed(&s, steps);
+//    ...flush...
+//    frame_sched_flushed(&s);
+//    frame_sched_wait(&s);
+//
+//Frames start on a fixed grid of ticks through vTaskDelayUntil, so time spent
+//computing and flushing does not add up into drift. The number of steps a
+//frame runs follows the target simulation rate, but no more than the
+//measured cost per step lets fit in what the frame has left after flushing.
+
+//Samples kept for the percentiles
+#define FRAME_SCHED_WINDOW 128
+//Share of the frame left unplanned, for the cost estimate being off
+#define FRAME_SCHED_MARGIN_PCT 10
+//How often frame_sched_wait prints the stats, 0 never
+#define FRAME_SCHED_REPORT_US 10000000
+//Steps per second meaning as many as fit
+#define FRAME_SCHED_FLAT_OUT UINT32_MAX
+
+typedef struct {
+    uint32_t samples[FRAME_SCHED_WINDOW];    //Last durations in us, a ring
+    uint32_t count;                          //Samples ever added
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t sum_us;
+} frame_sched_timing_t;
+
+typedef struct {
+    uint32_t min_us;
+    uint32_t avg_us;
+    uint32_t max_us;
+    uint32_t p99_us;                 //Over the last FRAME_SCHED_WINDOW frames
+} frame_sched_summary_t;
+
+typedef struct {
+    float fps;                       //Frames per second since init
+    float steps_per_s;               //Simulation steps per second since init
+    uint32_t frames;
+    uint32_t overruns;               //Frames that ended after the next should have started
+    uint32_t starved;                //Frames that ran fewer steps than the rate asked for
+    frame_sched_summary_t compute;
+    frame_sched_summary_t flush;
+    frame_sched_summary_t idle;
+} frame_sched_stats_t;
+
+typedef struct {
+    const char *name;
+    TickType_t period;               //Ticks per frame
+    TickType_t last_wake;
+    uint32_t steps_per_s;            //Target simulation rate, FRAME_SCHED_FLAT_OUT for all that fits
+    float steps_due;                 //Steps owed, fractions carried to the next frame
+    float step_cost_us;              //Running average of compute time per step, 0 until measured
+    uint32_t steps;                  //Steps handed out for the current frame
+    int64_t frame_at;                //When the current frame started
+    int64_t computed_at;
+    int64_t flushed_at;
+    int64_t started_at;              //Moved on by the time away, the rates count only time running
+    int64_t resumed_at;              //Init or the last frame_sched_resume
+    int64_t reported_at;
+    uint64_t total_steps;
+    uint32_t frames;
+    uint32_t overruns;
+    uint32_t starved;
+    frame_sched_timing_t compute;
+    frame_sched_timing_t flush;
+    frame_sched_timing_t idle;
+} frame_sched_t;
+
+//fps is rounded to a whole number of ticks per frame, at least one.
+//A steps_per_s of 0 runs one step a frame.
+void frame_sched_init(frame_sched_t *s, const char *name, float fps, uint32_t steps_per_s);
+//Change the simulation rate, keeping the frame rate and the stats
+void frame_sched_set_rate(frame_sched_t *s, uint32_t steps_per_s);
+//Start a frame, return how many steps to run in it
+uint32_t frame_sched_begin(frame_sched_t *s);
+//The steps of the frame are done, steps of them actually ran
+void frame_sched_computed(frame_sched_t *s, uint32_t steps);
+void frame_sched_flushed(frame_sched_t *s);
+//Sleep until the next frame is due
+void frame_sched_wait(frame_sched_t *s);
+//Ticks until the next frame is due, 0 if it is already
+TickType_t frame_sched_remaining(const frame_sched_t *s);
+//Start the grid of frames again from now, keeping the rates and the stats,
+//for an effect coming back after others ran. Nothing is owed for the time
+//away and it does not count in the rates.
+void frame_sched_resume(frame_sched_t *s);
+void frame_sched_get_stats(frame_sched_t *s, frame_sched_stats_t *stats);
+void frame_sched_print(frame_sched_t *s);
+
+#endif
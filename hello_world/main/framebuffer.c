@@ -0,0 +1,26 @@
+#include "framebuffer.h"
+
+void set_pixel(uint8_t x, uint8_t y, uint8_t value, uint8_t *lines) {
+    if (value) {
+        lines[x+128*(y/8)] |= 1<<y%8;
+    } else {
+        lines[x+128*(y/8)] &= ~(1<<y%8);
+    }
+}
+
+bool get_pixel(uint8_t x, uint8_t y, uint8_t *lines) {
+    return lines[x+128*(y/8)]&(1<<(y%8));
+}
+
+void set_rect(uint8_t x, uint8_t y, uint8_t width, uint8_t height, uint8_t *lines) {
+    if (height>8-(y%8)) {
+        for (int i=0;i<width;i++) {
+            lines[x+i+128*(y/8)] |= ((uint8_t) ~0)<<(y%8);
+        }
+        set_rect(x, y+8-(y%8), width, height-8+(y%8), lines);
+    } else {
+        for (int i=0;i<width;i++) {
+            lines[x+i+128*(y/8)] |= (uint8_t) (((1<<height)-1)<<(y%8));
+        }
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+//The screen is 128x64 pixels, stored as 8 pages of 128 columns.
+//Each byte is one column of 8 pixels in a page, bit 0 being the top one.
+#define SCRN_WIDTH 128
+#define SCRN_HEIGHT 64
+#define SCRN_PAGES (SCRN_HEIGHT/8)
+#define SCRN_BUF_SIZE (SCRN_WIDTH*SCRN_PAGES)
+
+//A set of tiles of 8 columns by one page, used to track what changed.
+//Bit t of rows[page] covers columns 8t to 8t+7 of that page.
+#define SCRN_TILE_COLS 8
+#define SCRN_TILES_X (SCRN_WIDTH/SCRN_TILE_COLS)
+
+typedef struct {
+    uint16_t rows[SCRN_PAGES];
+} scrn_tiles_t;
+
+static inline void scrn_tiles_clear(scrn_tiles_t *t) {
+    memset(t, 0, sizeof(*t));
+}
+
+static inline void scrn_tiles_fill(scrn_tiles_t *t) {
+    memset(t, 0xFF, sizeof(*t));
+}
+
+static inline void scrn_tiles_mark(scrn_tiles_t *t, uint8_t x, uint8_t y) {
+    t->rows[(y/8)%SCRN_PAGES] |= 1<<((x%SCRN_WIDTH)/SCRN_TILE_COLS);
+}
+
+static inline void scrn_tiles_or(scrn_tiles_t *t, const scrn_tiles_t *other) {
+    for (int p=0;p<SCRN_PAGES;p++) {
+        t->rows[p] |= other->rows[p];
+    }
+}
+
+static inline int scrn_tiles_count(const scrn_tiles_t *t) {
+    int n=0;
+    for (int p=0;p<SCRN_PAGES;p++) {
+        n += __builtin_popcount(t->rows[p]);
+    }
+    return n;
+}
+
+void set_pixel(uint8_t x, uint8_t y, uint8_t value, uint8_t *lines);
+bool get_pixel(uint8_t x, uint8_t y, uint8_t *lines);
+void set_rect(uint8_t x, uint8_t y, uint8_t width, uint8_t height, uint8_t *lines);
+
+#endif
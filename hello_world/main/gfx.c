@@ -0,0 +1,249 @@
+#include <stdlib.h>
+#include <string.h>
+#include "gfx.h"
+
+//Four columns at once. may_alias as the buffers are bytes.
+typedef uint32_t __attribute__((may_alias)) gfx_word_t;
+#define GFX_LANES(byte) ((uint32_t) (uint8_t) (byte)*0x01010101u)
+
+static inline uint32_t gfx_apply(uint32_t v, uint32_t mask, gfx_colour_t colour) {
+    if (colour==GFX_SET) return v|mask;
+    if (colour==GFX_CLEAR) return v&~mask;
+    return v^mask;
+}
+
+//Apply mask to n columns from col, whole words in the middle
+static void gfx_span(uint8_t *col, int n, uint8_t mask, gfx_colour_t colour) {
+    uint32_t wide = GFX_LANES(mask);
+    for (;n>0 && ((uintptr_t) col&3);n--, col++) {
+        *col = gfx_apply(*col, mask, colour);
+    }
+    gfx_word_t *w = (gfx_word_t*) col;
+    for (;n>=4;n-=4, w++) {
+        *w = gfx_apply(*w, wide, colour);
+    }
+    for (col=(uint8_t*) w;n>0;n--, col++) {
+        *col = gfx_apply(*col, mask, colour);
+    }
+}
+
+void gfx_fill(uint8_t *lines, bool value) {
+    memset(lines, value ? 0xFF : 0x00, SCRN_BUF_SIZE);
+}
+
+void gfx_pixel(uint8_t *lines, int x, int y, gfx_colour_t colour) {
+    if (x<0 || x>=SCRN_WIDTH || y<0 || y>=SCRN_HEIGHT) return;
+    lines[x+SCRN_WIDTH*(y>>3)] = gfx_apply(lines[x+SCRN_WIDTH*(y>>3)], 1<<(y&7), colour);
+}
+
+void gfx_rect_fill(uint8_t *lines, int x, int y, int width, int height, gfx_colour_t colour) {
+    int x0 = x<0 ? 0 : x;
+    int y0 = y<0 ? 0 : y;
+    //Exclusive, and computed so that huge sizes do not overflow
+    int x1 = width>SCRN_WIDTH-x ? SCRN_WIDTH : x+width;
+    int y1 = height>SCRN_HEIGHT-y ? SCRN_HEIGHT : y+height;
+    if (x0>=x1 || y0>=y1) return;
+    for (int page=y0>>3;page<=(y1-1)>>3;page++) {
+        int top = page==y0>>3 ? y0&7 : 0;
+        int bottom = page==(y1-1)>>3 ? (y1-1)&7 : 7;
+        uint8_t mask = (0xFF<<top) & (0xFF>>(7-bottom));
+        gfx_span(lines+SCRN_WIDTH*page+x0, x1-x0, mask, colour);
+    }
+}
+
+void gfx_hline(uint8_t *lines, int x, int y, int width, gfx_colour_t colour) {
+    gfx_rect_fill(lines, x, y, width, 1, colour);
+}
+
+void gfx_vline(uint8_t *lines, int x, int y, int height, gfx_colour_t colour) {
+    gfx_rect_fill(lines, x, y, 1, height, colour);
+}
+
+void gfx_rect(uint8_t *lines, int x, int y, int width, int height, gfx_colour_t colour) {
+    if (width<=0 || height<=0) return;
+    gfx_hline(lines, x, y, width, colour);
+    if (height>1) gfx_hline(lines, x, y+height-1, width, colour);
+    if (height>2) {
+        gfx_vline(lines, x, y+1, height-2, colour);
+        if (width>1) gfx_vline(lines, x+width-1, y+1, height-2, colour);
+    }
+}
+
+void gfx_line(uint8_t *lines, int x0, int y0, int x1, int y1, gfx_colour_t colour) {
+    if (y0==y1) {
+        gfx_hline(lines, x0<x1 ? x0 : x1, y0, abs(x1-x0)+1, colour);
+        return;
+    }
+    if (x0==x1) {
+        gfx_vline(lines, x0, y0<y1 ? y0 : y1, abs(y1-y0)+1, colour);
+        return;
+    }
+    //Bresenham, every octant
+    int dx = abs(x1-x0), sx = x0<x1 ? 1 : -1;
+    int dy = -abs(y1-y0), sy = y0<y1 ? 1 : -1;
+    int err = dx+dy;
+    while (1) {
+        gfx_pixel(lines, x0, y0, colour);
+        if (x0==x1 && y0==y1) break;
+        int e2 = 2*err;
+        if (e2>=dy) {
+            err += dy;
+            x0 += sx;
+        }
+        if (e2<=dx) {
+            err += dx;
+            y0 += sy;
+        }
+    }
+}
+
+//(cx±a, cy±b), each pixel once even when a or b is 0
+static void gfx_plot4(uint8_t *lines, int cx, int cy, int a, int b, gfx_colour_t colour) {
+    gfx_pixel(lines, cx+a, cy+b, colour);
+    if (a) gfx_pixel(lines, cx-a, cy+b, colour);
+    if (b) gfx_pixel(lines, cx+a, cy-b, colour);
+    if (a && b) gfx_pixel(lines, cx-a, cy-b, colour);
+}
+
+void gfx_circle(uint8_t *lines, int cx, int cy, int r, gfx_colour_t colour) {
+    int x = r, y = 0, err = 1-r;
+    //Midpoint circle over one octant, mirrored. x>=y throughout, so the
+    //mirrored points only meet where x==y.
+    while (x>=y) {
+        gfx_plot4(lines, cx, cy, x, y, colour);
+        if (x!=y) gfx_plot4(lines, cx, cy, y, x, colour);
+        y++;
+        if (err<0) {
+            err += 2*y+1;
+        } else {
+            x--;
+            err += 2*(y-x)+1;
+        }
+    }
+}
+
+void gfx_circle_fill(uint8_t *lines, int cx, int cy, int r, gfx_colour_t colour) {
+    int x = r, y = 0, err = 1-r;
+    //Same walk as gfx_circle, one span per row: rows cy±y as they come,
+    //rows cy±x once x is about to move on
+    while (x>=y) {
+        gfx_hline(lines, cx-x, cy+y, 2*x+1, colour);
+        if (y) gfx_hline(lines, cx-x, cy-y, 2*x+1, colour);
+        y++;
+        if (err<0) {
+            err += 2*y+1;
+        } else {
+            if (x!=y-1) {
+                gfx_hline(lines, cx-(y-1), cy+x, 2*(y-1)+1, colour);
+                gfx_hline(lines, cx-(y-1), cy-x, 2*(y-1)+1, colour);
+            }
+            x--;
+            err += 2*(y-x)+1;
+        }
+    }
+}
+
+void gfx_blit(uint8_t *lines, int x, int y, const gfx_sprite_t *sprite, gfx_rop_t rop) {
+    int pages = (sprite->height+7)/8;
+    int c0 = x<0 ? -x : 0;
+    int c1 = sprite->width>SCRN_WIDTH-x ? SCRN_WIDTH-x : sprite->width;
+    int shift = y&7;
+    if (c0>=c1) return;
+    for (int sp=0;sp<pages;sp++) {
+        const uint8_t *src = sprite->data+sprite->width*sp;
+        uint8_t valid = sp==pages-1 && sprite->height%8 ? 0xFF>>(8-sprite->height%8) : 0xFF;
+        //A sprite page lands on two screen pages unless y is a multiple of 8
+        for (int half=0;half<(shift ? 2 : 1);half++) {
+            int page = (y>>3)+sp+half;
+            uint8_t mask = half ? valid>>(8-shift) : valid<<shift;
+            if (page<0 || page>=SCRN_PAGES || !mask) continue;
+            //Indexed from x rather than offset by it, x may be negative
+            uint8_t *dst = lines+SCRN_WIDTH*page;
+            for (int c=c0;c<c1;c++) {
+                uint8_t bits = (half ? src[c]>>(8-shift) : src[c]<<shift) & mask;
+                if (rop==GFX_COPY) {
+                    dst[x+c] = (dst[x+c]&~mask) | bits;
+                } else if (rop==GFX_OR) {
+                    dst[x+c] |= bits;
+                } else if (rop==GFX_AND) {
+                    dst[x+c] &= bits|~mask;
+                } else {
+                    dst[x+c] ^= bits;
+                }
+            }
+        }
+    }
+}
+
+void gfx_scroll_x(uint8_t *lines, int dx) {
+    if (dx>=SCRN_WIDTH || dx<=-SCRN_WIDTH) {
+        gfx_clear(lines);
+        return;
+    }
+    for (int page=0;page<SCRN_PAGES;page++) {
+        uint8_t *row = lines+SCRN_WIDTH*page;
+        if (dx>0) {
+            memmove(row+dx, row, SCRN_WIDTH-dx);
+            memset(row, 0, dx);
+        } else if (dx<0) {
+            memmove(row, row-dx, SCRN_WIDTH+dx);
+            memset(row+SCRN_WIDTH+dx, 0, -dx);
+        }
+    }
+}
+
+//One page of the result from the two source pages it straddles: near is
+//the one the rows mostly come from, far the neighbour on the side they move away from
+static void gfx_shift_page(uint8_t *dst, const uint8_t *near, const uint8_t *far, int bits, bool down) {
+    uint32_t near_mask = GFX_LANES(down ? 0xFF<<bits : 0xFF>>bits);
+    uint32_t far_mask = ~near_mask;
+    if (((uintptr_t) dst|(uintptr_t) near|(uintptr_t) (far ? far : near))&3) {
+        for (int c=0;c<SCRN_WIDTH;c++) {
+            uint8_t n = down ? near[c]<<bits : near[c]>>bits;
+            uint8_t f = far==NULL ? 0 : down ? far[c]>>(8-bits) : far[c]<<(8-bits);
+            dst[c] = n|f;
+        }
+        return;
+    }
+    //Shifting a whole word moves bits between lanes, the masks cut them off
+    const gfx_word_t *n = (const gfx_word_t*) near, *f = (const gfx_word_t*) far;
+    gfx_word_t *d = (gfx_word_t*) dst;
+    for (int w=0;w<SCRN_WIDTH/4;w++) {
+        uint32_t v = (down ? n[w]<<bits : n[w]>>bits) & near_mask;
+        if (f) v |= (down ? f[w]>>(8-bits) : f[w]<<(8-bits)) & far_mask;
+        d[w] = v;
+    }
+}
+
+void gfx_scroll_y(uint8_t *lines, int dy) {
+    int n = abs(dy), pages = n>>3, bits = n&7;
+    if (n>=SCRN_HEIGHT) {
+        gfx_clear(lines);
+        return;
+    }
+    if (dy==0) return;
+    if (bits==0) {
+        if (dy>0) {
+            memmove(lines+SCRN_WIDTH*pages, lines, SCRN_WIDTH*(SCRN_PAGES-pages));
+            memset(lines, 0, SCRN_WIDTH*pages);
+        } else {
+            memmove(lines, lines+SCRN_WIDTH*pages, SCRN_WIDTH*(SCRN_PAGES-pages));
+            memset(lines+SCRN_WIDTH*(SCRN_PAGES-pages), 0, SCRN_WIDTH*pages);
+        }
+        return;
+    }
+    if (dy>0) {
+        //Bottom up, so each page is read before it is written
+        for (int p=SCRN_PAGES-1;p>=pages;p--) {
+            const uint8_t *far = p-pages-1>=0 ? lines+SCRN_WIDTH*(p-pages-1) : NULL;
+            gfx_shift_page(lines+SCRN_WIDTH*p, lines+SCRN_WIDTH*(p-pages), far, bits, true);
+        }
+        memset(lines, 0, SCRN_WIDTH*pages);
+    } else {
+        for (int p=0;p<SCRN_PAGES-pages;p++) {
+            const uint8_t *far = p+pages+1<SCRN_PAGES ? lines+SCRN_WIDTH*(p+pages+1) : NULL;
+            gfx_shift_page(lines+SCRN_WIDTH*p, lines+SCRN_WIDTH*(p+pages), far, bits, false);
+        }
+        memset(lines+SCRN_WIDTH*(SCRN_PAGES-pages), 0, SCRN_WIDTH*pages);
+    }
+}
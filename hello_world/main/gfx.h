@@ -0,0 +1,57 @@
+#ifndef GFX_H
+#define GFX_H
+
+#include <stdint.h>
+#include "framebuffer.h"
+
+//Drawing on a page format framebuffer a page at a time rather than a pixel
+//at a time: a rectangle is one mask per page applied along its columns,
+//four columns to a word store. Everything clips to the screen, so any
+//coordinates are safe, negative ones included.
+
+typedef enum {
+    GFX_SET,
+    GFX_CLEAR,
+    GFX_INVERT
+} gfx_colour_t;
+
+//How a sprite combines with what is under it
+typedef enum {
+    GFX_COPY,                        //Sprite pixels replace the screen's
+    GFX_OR,
+    GFX_AND,
+    GFX_XOR
+} gfx_rop_t;
+
+//A 1bpp image laid out like the screen: (height+7)/8 pages of width bytes,
+//bit 0 of a byte the top pixel. Bits below height in the last page are ignored.
+typedef struct {
+    uint8_t width;
+    uint8_t height;
+    const uint8_t *data;
+} gfx_sprite_t;
+
+//Every pixel on or off
+void gfx_fill(uint8_t *lines, bool value);
+static inline void gfx_clear(uint8_t *lines) {
+    gfx_fill(lines, 0);
+}
+void gfx_pixel(uint8_t *lines, int x, int y, gfx_colour_t colour);
+void gfx_hline(uint8_t *lines, int x, int y, int width, gfx_colour_t colour);
+void gfx_vline(uint8_t *lines, int x, int y, int height, gfx_colour_t colour);
+void gfx_rect_fill(uint8_t *lines, int x, int y, int width, int height, gfx_colour_t colour);
+//The outline, each pixel touched once so GFX_INVERT works
+void gfx_rect(uint8_t *lines, int x, int y, int width, int height, gfx_colour_t colour);
+//Both ends included
+void gfx_line(uint8_t *lines, int x0, int y0, int x1, int y1, gfx_colour_t colour);
+void gfx_circle(uint8_t *lines, int cx, int cy, int r, gfx_colour_t colour);
+void gfx_circle_fill(uint8_t *lines, int cx, int cy, int r, gfx_colour_t colour);
+//Top left of the sprite at x, y
+void gfx_blit(uint8_t *lines, int x, int y, const gfx_sprite_t *sprite, gfx_rop_t rop);
+//Move everything dx columns right (left if negative), clearing what is uncovered
+void gfx_scroll_x(uint8_t *lines, int dx);
+//Move everything dy rows down (up if negative), clearing what is uncovered.
+//Whole pages move with memmove, the rest is a shift across page pairs.
+void gfx_scroll_y(uint8_t *lines, int dy);
+
+#endif
@@ -0,0 +1,476 @@
+#include <string.h>
+#include "esp_heap_caps.h"
+#include "framebuffer.h"
+#include "hashlife.h"
+
+//Index 0 is never handed out and stands for "no node", which is also how
+//running out of nodes travels back up through the recursion.
+#define HL_NONE 0
+
+#define HL_NW 0
+#define HL_NE 1
+#define HL_SW 2
+#define HL_SE 3
+
+static inline hl_node_t *hl(hashlife_t *h, hl_index_t i) {
+    return &h->chunks[i/HASHLIFE_CHUNK_NODES][i%HASHLIFE_CHUNK_NODES];
+}
+
+static inline uint32_t hl_hash_leaf(uint64_t cells) {
+    uint64_t x = cells*0x9E3779B97F4A7C15ull;
+    return (uint32_t) (x>>32)^(uint32_t) x;
+}
+
+static inline uint32_t hl_hash_node(const hl_index_t *c) {
+    uint32_t x = c[0]*0x9E3779B1u;
+    x = (x^c[1])*0x85EBCA77u;
+    x = (x^c[2])*0xC2B2AE3Du;
+    x = (x^c[3])*0x27D4EB2Fu;
+    return x^(x>>15);
+}
+
+static hl_index_t hl_alloc(hashlife_t *h) {
+    hl_index_t i = h->free_list;
+    if (i==HL_NONE) {
+        h->out_of_nodes = true;
+        return HL_NONE;
+    }
+    h->free_list = hl(h, i)->next;
+    if (++h->stats.live>h->stats.peak) {
+        h->stats.peak = h->stats.live;
+    }
+    return i;
+}
+
+static hl_index_t hl_leaf(hashlife_t *h, uint64_t cells) {
+    uint32_t b = hl_hash_leaf(cells)&h->mask;
+    for (hl_index_t i=h->buckets[b];i!=HL_NONE;i=hl(h, i)->next) {
+        if (hl(h, i)->level==HASHLIFE_LEAF_LEVEL && hl(h, i)->cells==cells) return i;
+    }
+    hl_index_t i = hl_alloc(h);
+    if (i==HL_NONE) return HL_NONE;
+    hl_node_t *n = hl(h, i);
+    n->cells = cells;
+    n->level = HASHLIFE_LEAF_LEVEL;
+    n->result = HL_NONE;
+    n->mark = 0;
+    n->next = h->buckets[b];
+    h->buckets[b] = i;
+    return i;
+}
+
+//The node of the level above with these four children
+static hl_index_t hl_join(hashlife_t *h, hl_index_t nw, hl_index_t ne, hl_index_t sw, hl_index_t se) {
+    if (nw==HL_NONE || ne==HL_NONE || sw==HL_NONE || se==HL_NONE) return HL_NONE;
+    hl_index_t c[4] = {nw, ne, sw, se};
+    uint8_t level = hl(h, nw)->level+1;
+    uint32_t b = hl_hash_node(c)&h->mask;
+    for (hl_index_t i=h->buckets[b];i!=HL_NONE;i=hl(h, i)->next) {
+        hl_node_t *n = hl(h, i);
+        if (n->level==level && !memcmp(n->child, c, sizeof(c))) return i;
+    }
+    hl_index_t i = hl_alloc(h);
+    if (i==HL_NONE) return HL_NONE;
+    hl_node_t *n = hl(h, i);
+    memcpy(n->child, c, sizeof(c));
+    n->level = level;
+    n->result = HL_NONE;
+    n->mark = 0;
+    n->next = h->buckets[b];
+    h->buckets[b] = i;
+    return i;
+}
+
+static hl_index_t hl_empty(hashlife_t *h, uint8_t level) {
+    if (h->empty[level]==HL_NONE) {
+        if (level==HASHLIFE_LEAF_LEVEL) {
+            h->empty[level] = hl_leaf(h, 0);
+        } else {
+            hl_index_t e = hl_empty(h, level-1);
+            h->empty[level] = hl_join(h, e, e, e, e);
+        }
+    }
+    return h->empty[level];
+}
+
+//Leaf made of the 4x4 quarters of four leaves that meet in its middle
+static uint64_t hl_leaf_centre(uint64_t nw, uint64_t ne, uint64_t sw, uint64_t se) {
+    uint64_t c = 0;
+    for (int y=0;y<4;y++) {
+        c |= ((nw>>(8*(y+4)+4))&0x0F)<<(8*y);
+        c |= ((ne>>(8*(y+4)))&0x0F)<<(8*y+4);
+        c |= ((sw>>(8*y+4))&0x0F)<<(8*(y+4));
+        c |= ((se>>(8*y))&0x0F)<<(8*(y+4)+4);
+    }
+    return c;
+}
+
+//The node of the level below at the middle of n
+static hl_index_t hl_centre(hashlife_t *h, hl_index_t n) {
+    if (n==HL_NONE) return HL_NONE;
+    hl_node_t *m = hl(h, n);
+    hl_node_t *nw = hl(h, m->child[HL_NW]), *ne = hl(h, m->child[HL_NE]);
+    hl_node_t *sw = hl(h, m->child[HL_SW]), *se = hl(h, m->child[HL_SE]);
+    if (m->level==HASHLIFE_LEAF_LEVEL+1) {
+        return hl_leaf(h, hl_leaf_centre(nw->cells, ne->cells, sw->cells, se->cells));
+    }
+    return hl_join(h, nw->child[HL_SE], ne->child[HL_SW], sw->child[HL_NE], se->child[HL_NW]);
+}
+
+//Middle of the pair side by side / one above the other
+static hl_index_t hl_centre_h(hashlife_t *h, hl_index_t w, hl_index_t e) {
+    if (w==HL_NONE || e==HL_NONE) return HL_NONE;
+    hl_node_t *a = hl(h, w), *b = hl(h, e);
+    return hl_join(h, a->child[HL_NE], b->child[HL_NW], a->child[HL_SE], b->child[HL_SW]);
+}
+
+static hl_index_t hl_centre_v(hashlife_t *h, hl_index_t n, hl_index_t s) {
+    if (n==HL_NONE || s==HL_NONE) return HL_NONE;
+    hl_node_t *a = hl(h, n), *b = hl(h, s);
+    return hl_join(h, a->child[HL_SW], a->child[HL_SE], b->child[HL_NW], b->child[HL_NE]);
+}
+
+//Run Life gens times on a 16x16 block with nothing around it, rows as bit rows
+static void hl_run_block(uint16_t rows[16], int gens) {
+    uint16_t next[16];
+    for (int g=0;g<gens;g++) {
+        for (int y=0;y<16;y++) {
+            uint16_t up = y>0 ? rows[y-1] : 0;
+            uint16_t down = y<15 ? rows[y+1] : 0;
+            uint16_t c = rows[y];
+            //Vertical 3-sums, then the horizontal ones as in life.c
+            uint16_t v0 = up^c^down;
+            uint16_t v1 = (up&c)|(down&(up^c));
+            uint16_t l0 = v0<<1, l1 = v1<<1, r0 = v0>>1, r1 = v1>>1;
+            uint16_t w0 = l0^v0^r0;
+            uint16_t k = (l0&v0)|(r0&(l0^v0));
+            uint16_t a = l1^v1, ac = l1&v1;
+            uint16_t b = r1^k, bc = r1&k;
+            uint16_t w1 = a^b;
+            uint16_t w2 = (ac^bc)|(a&b);
+            uint16_t w3 = ac&bc;
+            next[y] = ~w3&((w0&w1&~w2)|(c&w2&~w0&~w1));
+        }
+        memcpy(rows, next, sizeof(next));
+    }
+}
+
+//Centre of a 16x16 node after 2^min(step, 2) generations
+static hl_index_t hl_result_base(hashlife_t *h, hl_node_t *m) {
+    uint16_t rows[16];
+    uint64_t nw = hl(h, m->child[HL_NW])->cells, ne = hl(h, m->child[HL_NE])->cells;
+    uint64_t sw = hl(h, m->child[HL_SW])->cells, se = hl(h, m->child[HL_SE])->cells;
+    for (int y=0;y<8;y++) {
+        rows[y] = ((nw>>(8*y))&0xFF)|(((ne>>(8*y))&0xFF)<<8);
+        rows[y+8] = ((sw>>(8*y))&0xFF)|(((se>>(8*y))&0xFF)<<8);
+    }
+    hl_run_block(rows, 1<<(h->step_log2<2 ? h->step_log2 : 2));
+    uint64_t c = 0;
+    for (int y=0;y<8;y++) {
+        c |= (uint64_t) ((rows[y+4]>>4)&0xFF)<<(8*y);
+    }
+    return hl_leaf(h, c);
+}
+
+//Centre of n (one level down) 2^min(step, level-2) generations on
+static hl_index_t hl_result(hashlife_t *h, hl_index_t n) {
+    //Once the pool is empty nothing more can be remembered, so give up
+    //straight away instead of recomputing the rest of the tree
+    if (n==HL_NONE || h->out_of_nodes) return HL_NONE;
+    hl_node_t *m = hl(h, n);
+    if (m->result!=HL_NONE) {
+        h->stats.memo_hits++;
+        return m->result;
+    }
+    h->stats.memo_misses++;
+    hl_index_t r;
+    if (m->level==HASHLIFE_LEAF_LEVEL+1) {
+        r = hl_result_base(h, m);
+    } else {
+        hl_index_t nw = m->child[HL_NW], ne = m->child[HL_NE], sw = m->child[HL_SW], se = m->child[HL_SE];
+        hl_index_t sub[9] = {
+            nw, hl_centre_h(h, nw, ne), ne,
+            hl_centre_v(h, nw, sw), hl_centre(h, n), hl_centre_v(h, ne, se),
+            sw, hl_centre_h(h, sw, se), se,
+        };
+        //At full speed both halves of the time step are results, otherwise the
+        //first half is only the centres and the whole step is in the second
+        bool full = h->step_log2>=m->level-2;
+        for (int i=0;i<9;i++) {
+            sub[i] = full ? hl_result(h, sub[i]) : hl_centre(h, sub[i]);
+        }
+        r = hl_join(h,
+                hl_result(h, hl_join(h, sub[0], sub[1], sub[3], sub[4])),
+                hl_result(h, hl_join(h, sub[1], sub[2], sub[4], sub[5])),
+                hl_result(h, hl_join(h, sub[3], sub[4], sub[6], sub[7])),
+                hl_result(h, hl_join(h, sub[4], sub[5], sub[7], sub[8])));
+    }
+    m->result = r;
+    return r;
+}
+
+//Same node, one level up, with n in the middle of empty space
+static hl_index_t hl_expand(hashlife_t *h, hl_index_t n) {
+    hl_node_t *m = hl(h, n);
+    hl_index_t e = hl_empty(h, m->level-1);
+    hl_index_t nw = m->child[HL_NW], ne = m->child[HL_NE], sw = m->child[HL_SW], se = m->child[HL_SE];
+    return hl_join(h,
+            hl_join(h, e, e, e, nw),
+            hl_join(h, e, e, ne, e),
+            hl_join(h, e, sw, e, e),
+            hl_join(h, se, e, e, e));
+}
+
+//True if everything alive in n is in its middle half
+static bool hl_is_centred(hashlife_t *h, hl_index_t n) {
+    hl_node_t *m = hl(h, n);
+    hl_index_t e = hl_empty(h, m->level-2);
+    for (int q=0;q<4;q++) {
+        hl_node_t *c = hl(h, m->child[q]);
+        for (int i=0;i<4;i++) {
+            //Only the grandchild closest to the middle may have anything
+            if (i!=3-q && c->child[i]!=e) return false;
+        }
+    }
+    return true;
+}
+
+static void hl_mark(hashlife_t *h, hl_index_t n) {
+    if (n==HL_NONE) return;
+    hl_node_t *m = hl(h, n);
+    if (m->mark) return;
+    m->mark = 1;
+    if (m->level>HASHLIFE_LEAF_LEVEL) {
+        for (int i=0;i<4;i++) {
+            hl_mark(h, m->child[i]);
+        }
+    }
+}
+
+void hashlife_gc(hashlife_t *h) {
+    hl_mark(h, h->root);
+    for (int l=HASHLIFE_LEAF_LEVEL;l<=HASHLIFE_MAX_LEVEL;l++) {
+        hl_mark(h, h->empty[l]);
+    }
+    memset(h->buckets, 0, (h->mask+1)*sizeof(hl_index_t));
+    h->free_list = HL_NONE;
+    uint32_t freed = 0;
+    //Walk down so the free list hands out low indices first
+    for (uint32_t i=h->stats.capacity-1;i>0;i--) {
+        hl_node_t *n = hl(h, i);
+        if (n->level && !n->mark) {
+            n->level = 0;
+            freed++;
+        }
+        if (n->level==0) {
+            n->next = h->free_list;
+            h->free_list = i;
+            continue;
+        }
+        uint32_t b = (n->level==HASHLIFE_LEAF_LEVEL ? hl_hash_leaf(n->cells) : hl_hash_node(n->child))&h->mask;
+        n->next = h->buckets[b];
+        h->buckets[b] = i;
+    }
+    //Results pointing at collected nodes are forgotten, the others kept
+    for (uint32_t i=1;i<h->stats.capacity;i++) {
+        hl_node_t *n = hl(h, i);
+        if (n->level && n->result!=HL_NONE && !hl(h, n->result)->mark) {
+            n->result = HL_NONE;
+        }
+    }
+    for (uint32_t i=1;i<h->stats.capacity;i++) {
+        hl(h, i)->mark = 0;
+    }
+    h->stats.live -= freed;
+    h->stats.gc_freed += freed;
+    h->stats.gc_runs++;
+}
+
+bool hashlife_init(hashlife_t *h, uint32_t max_nodes) {
+    int chunks = 0;
+    memset(h, 0, sizeof(*h));
+    if (max_nodes>65536) max_nodes = 65536;
+    while (chunks<(int) (max_nodes/HASHLIFE_CHUNK_NODES)) {
+        h->chunks[chunks] = heap_caps_malloc(HASHLIFE_CHUNK_NODES*sizeof(hl_node_t), MALLOC_CAP_8BIT);
+        if (h->chunks[chunks]==NULL) break;
+        chunks++;
+    }
+    //A power of two buckets, up to one a node. When the chunks took what
+    //they were needed for, give chunks back until they fit.
+    uint32_t capacity, buckets;
+    while (1) {
+        capacity = chunks*HASHLIFE_CHUNK_NODES;
+        if (capacity<HASHLIFE_MIN_NODES) {
+            hashlife_free(h);
+            return false;
+        }
+        buckets = 1;
+        while (buckets*2<=capacity) {
+            buckets *= 2;
+        }
+        h->buckets = heap_caps_malloc(buckets*sizeof(hl_index_t), MALLOC_CAP_8BIT);
+        if (h->buckets!=NULL) break;
+        chunks--;
+        heap_caps_free(h->chunks[chunks]);
+        h->chunks[chunks] = NULL;
+    }
+    h->mask = buckets-1;
+    h->stats.capacity = capacity;
+    hashlife_clear(h);
+    return true;
+}
+
+void hashlife_free(hashlife_t *h) {
+    for (int i=0;i<HASHLIFE_MAX_CHUNKS;i++) {
+        heap_caps_free(h->chunks[i]);
+        h->chunks[i] = NULL;
+    }
+    heap_caps_free(h->buckets);
+    h->buckets = NULL;
+}
+
+void hashlife_clear(hashlife_t *h) {
+    for (uint32_t i=0;i<h->stats.capacity/HASHLIFE_CHUNK_NODES;i++) {
+        memset(h->chunks[i], 0, HASHLIFE_CHUNK_NODES*sizeof(hl_node_t));
+    }
+    memset(h->buckets, 0, (h->mask+1)*sizeof(hl_index_t));
+    memset(h->empty, 0, sizeof(h->empty));
+    h->free_list = HL_NONE;
+    for (uint32_t i=h->stats.capacity-1;i>0;i--) {
+        hl(h, i)->next = h->free_list;
+        h->free_list = i;
+    }
+    h->stats.live = 0;
+    h->stats.generation = 0;
+    h->out_of_nodes = false;
+    h->root = hl_empty(h, HASHLIFE_LEAF_LEVEL+2);
+}
+
+void hashlife_set_step_log2(hashlife_t *h, uint8_t step_log2) {
+    if (step_log2>HASHLIFE_MAX_STEP_LOG2) step_log2 = HASHLIFE_MAX_STEP_LOG2;
+    if (step_log2==h->step_log2) return;
+    h->step_log2 = step_log2;
+    for (uint32_t i=1;i<h->stats.capacity;i++) {
+        hl(h, i)->result = HL_NONE;
+    }
+}
+
+static inline int64_t hl_half(uint8_t level) {
+    return (int64_t) 1<<(level-1);
+}
+
+//n with the cell at (x, y) from its top left corner changed
+static hl_index_t hl_set(hashlife_t *h, hl_index_t n, int64_t x, int64_t y, bool alive) {
+    hl_node_t *m = hl(h, n);
+    if (m->level==HASHLIFE_LEAF_LEVEL) {
+        uint64_t bit = (uint64_t) 1<<(8*y+x);
+        return hl_leaf(h, alive ? m->cells|bit : m->cells&~bit);
+    }
+    int64_t half = hl_half(m->level);
+    int q = (x>=half)+2*(y>=half);
+    hl_index_t c[4];
+    memcpy(c, m->child, sizeof(c));
+    c[q] = hl_set(h, c[q], x%half, y%half, alive);
+    return hl_join(h, c[0], c[1], c[2], c[3]);
+}
+
+//Retry an operation on the universe once after collecting, if it ran out of nodes
+static bool hl_retry(hashlife_t *h) {
+    if (!h->out_of_nodes) return false;
+    h->out_of_nodes = false;
+    hashlife_gc(h);
+    return true;
+}
+
+void hashlife_set_cell(hashlife_t *h, int64_t x, int64_t y, bool alive) {
+    for (int attempt=0;attempt<2;attempt++) {
+        hl_index_t root = h->root;
+        int64_t half = hl_half(hl(h, root)->level);
+        while (root!=HL_NONE && (x<-half || x>=half || y<-half || y>=half)) {
+            root = hl_expand(h, root);
+            if (root!=HL_NONE) half = hl_half(hl(h, root)->level);
+        }
+        if (root!=HL_NONE) root = hl_set(h, root, x+half, y+half, alive);
+        if (root!=HL_NONE) {
+            h->root = root;
+            return;
+        }
+        if (!hl_retry(h)) break;
+    }
+    h->stats.alloc_failures++;
+}
+
+bool hashlife_get_cell(hashlife_t *h, int64_t x, int64_t y) {
+    hl_node_t *m = hl(h, h->root);
+    int64_t half = hl_half(m->level);
+    if (x<-half || x>=half || y<-half || y>=half) return false;
+    x += half;
+    y += half;
+    while (m->level>HASHLIFE_LEAF_LEVEL) {
+        half = hl_half(m->level);
+        m = hl(h, m->child[(x>=half)+2*(y>=half)]);
+        x %= half;
+        y %= half;
+    }
+    return (m->cells>>(8*y+x))&1;
+}
+
+bool hashlife_step(hashlife_t *h) {
+    //Keep half the pool free for the step itself
+    if (h->stats.live>h->stats.capacity/2) {
+        hashlife_gc(h);
+    }
+    for (int attempt=0;attempt<2;attempt++) {
+        //Grow until everything alive is in the middle quarter of the root and
+        //the step fits, so nothing can leave the centre that is kept
+        hl_index_t root = h->root;
+        while (root!=HL_NONE && hl(h, root)->level<HASHLIFE_MAX_LEVEL &&
+                (hl(h, root)->level<h->step_log2+2 || !hl_is_centred(h, root))) {
+            root = hl_expand(h, root);
+        }
+        if (root!=HL_NONE && hl(h, root)->level<HASHLIFE_MAX_LEVEL) {
+            root = hl_expand(h, root);
+        } else {
+            root = HL_NONE;
+        }
+        root = hl_result(h, root);
+        if (root!=HL_NONE) {
+            h->root = root;
+            h->stats.generation += (uint64_t) 1<<h->step_log2;
+            return true;
+        }
+        if (!hl_retry(h)) break;
+    }
+    h->stats.alloc_failures++;
+    return false;
+}
+
+static void hl_render(hashlife_t *h, hl_index_t n, int64_t ox, int64_t oy, uint8_t *lines, int64_t x0, int64_t y0) {
+    hl_node_t *m = hl(h, n);
+    int64_t size = (int64_t) 1<<m->level;
+    if (n==h->empty[m->level]) return;
+    if (ox+size<=x0 || oy+size<=y0 || ox>=x0+SCRN_WIDTH || oy>=y0+SCRN_HEIGHT) return;
+    if (m->level==HASHLIFE_LEAF_LEVEL) {
+        uint64_t cells = m->cells;
+        while (cells) {
+            int bit = __builtin_ctzll(cells);
+            int64_t x = ox+(bit&7)-x0, y = oy+(bit>>3)-y0;
+            cells &= cells-1;
+            if (x>=0 && x<SCRN_WIDTH && y>=0 && y<SCRN_HEIGHT) {
+                lines[x+SCRN_WIDTH*(y/8)] |= 1<<(y%8);
+            }
+        }
+        return;
+    }
+    int64_t half = size/2;
+    hl_render(h, m->child[HL_NW], ox, oy, lines, x0, y0);
+    hl_render(h, m->child[HL_NE], ox+half, oy, lines, x0, y0);
+    hl_render(h, m->child[HL_SW], ox, oy+half, lines, x0, y0);
+    hl_render(h, m->child[HL_SE], ox+half, oy+half, lines, x0, y0);
+}
+
+void hashlife_render(hashlife_t *h, uint8_t *lines, int64_t x0, int64_t y0) {
+    int64_t half = hl_half(hl(h, h->root)->level);
+    memset(lines, 0, SCRN_BUF_SIZE);
+    hl_render(h, h->root, -half, -half, lines, x0, y0);
+}
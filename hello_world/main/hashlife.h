@@ -0,0 +1,83 @@
+#ifndef HASHLIFE_H
+#define HASHLIFE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//Conway's Life on an unbounded plane with Gosper's HashLife: the universe is
+//a quadtree of hash-consed nodes, each remembering its centre some time
+//ahead, so repeated structure in space and time is only computed once.
+//All nodes come from a pool allocated up front, in chunks, since the heap
+//seldom has one block as large as the whole pool once the rest of the
+//firmware is up. When it runs low, nodes not reachable from the current
+//universe are collected.
+
+//Default pool size, 16 bytes a node plus 2 of hash table, 144 KB in all
+#define HASHLIFE_MAX_NODES 8192
+//Nodes a chunk of the pool holds, 8 KB
+#define HASHLIFE_CHUNK_NODES 512
+#define HASHLIFE_MAX_CHUNKS (65536/HASHLIFE_CHUNK_NODES)
+//Fewer than this and init gives up
+#define HASHLIFE_MIN_NODES 1024
+//Leaves are 8x8 blocks of cells, level 3
+#define HASHLIFE_LEAF_LEVEL 3
+#define HASHLIFE_MAX_LEVEL 62
+#define HASHLIFE_MAX_STEP_LOG2 (HASHLIFE_MAX_LEVEL-3)
+
+typedef uint16_t hl_index_t;
+
+typedef struct {
+    union {
+        hl_index_t child[4];         //nw, ne, sw, se
+        uint64_t cells;              //Leaf cells, bit 8*y+x
+    };
+    hl_index_t next;                 //Next node in the same hash bucket
+    hl_index_t result;               //Centre 2^step generations on, 0 if not known yet
+    uint8_t level;                   //0 for a free node
+    uint8_t mark;
+} hl_node_t;
+
+typedef struct {
+    uint32_t capacity;               //Nodes in the pool
+    uint32_t live;                   //Nodes in use
+    uint32_t peak;
+    uint32_t gc_runs;
+    uint32_t gc_freed;               //Nodes reclaimed by all collections
+    uint32_t memo_hits;              //Results found already computed
+    uint32_t memo_misses;
+    uint32_t alloc_failures;         //Steps that ran out of nodes half way
+    uint64_t generation;
+} hashlife_stats_t;
+
+typedef struct {
+    hl_node_t *chunks[HASHLIFE_MAX_CHUNKS];
+    hl_index_t *buckets;
+    uint32_t mask;                   //Bucket count-1
+    hl_index_t free_list;
+    hl_index_t root;
+    hl_index_t empty[HASHLIFE_MAX_LEVEL+1];
+    uint8_t step_log2;               //Each step advances 2^step_log2 generations
+    bool out_of_nodes;
+    hashlife_stats_t stats;
+} hashlife_t;
+
+//Up to max_nodes nodes, at most 65536, in whole chunks. With less memory
+//than that the pool is as many chunks as the heap gives, less what the hash
+//table needs; stats.capacity says how many nodes there are. False below
+//HASHLIFE_MIN_NODES.
+bool hashlife_init(hashlife_t *h, uint32_t max_nodes);
+void hashlife_free(hashlife_t *h);
+void hashlife_clear(hashlife_t *h);
+void hashlife_set_cell(hashlife_t *h, int64_t x, int64_t y, bool alive);
+bool hashlife_get_cell(hashlife_t *h, int64_t x, int64_t y);
+//Change how far each step goes. Forgets all memoised results.
+void hashlife_set_step_log2(hashlife_t *h, uint8_t step_log2);
+//Advance 2^step_log2 generations. False if even after collecting there was
+//not enough memory for it, the universe is unchanged then.
+bool hashlife_step(hashlife_t *h);
+//Draw the 128x64 window whose top left cell is (x0, y0) into a page format framebuffer
+void hashlife_render(hashlife_t *h, uint8_t *lines, int64_t x0, int64_t y0);
+//Collect the nodes not reachable from the universe
+void hashlife_gc(hashlife_t *h);
+
+#endif
@@ -7,512 +7,738 @@
 #include "soc/gpio_struct.h"
 #include "driver/gpio.h"
 #include <string.h>
+#include "pins.h"
+#include "framebuffer.h"
+#include "display.h"
+#include "life.h"
+#include "pipeline.h"
+#include "hashlife.h"
+#include "turmite.h"
+#include "input.h"
+#include "frame_sched.h"
+#include "text.h"
+#include "gfx.h"
+#include "cycle.h"
+#include "pattern.h"
+#include "compose.h"
+#include "stream.h"
+#include "esp_timer.h"
+#include "effects.h"
+#include "trace.h"
 
-#define MOSI_PIN 13
-#define CLK_PIN 14
-#define RST_PIN 23
-#define CS_PIN 15
-#define DC_PIN 22
-#define U_PIN 16
-#define L_PIN 17
-#define D_PIN 18
-#define R_PIN 19
-#define C_PIN 5
-#define MODE_PIN 2
+const uint8_t glider[10] = {50, 50, 51, 51, 52, 49, 52, 50, 52, 51};
+const uint8_t glider_gun[72] = {50, 50, 50, 51, 51, 50, 51, 51, 60, 50, 60, 51, 60, 52,
+        61, 49, 61, 53, 62, 48, 62, 54, 63, 48, 63, 54, 64, 51, 65, 49, 65, 53,
+        66, 50, 66, 51, 66, 52, 67, 51, 70, 48, 70, 49, 70, 50, 71, 48, 71, 49,
+        71, 50, 72, 47, 72, 51, 74, 46, 74, 47, 74, 51, 74, 52, 84, 48, 84, 49,
+        85, 48, 85, 49};
 
+//Frame and simulation rates the effects ask the scheduler for
+#define LIFE_FPS 30
+#define LIFE_GENS_PER_S 30
+#define HASHLIFE_FPS 30
+#define HASHLIFE_STEPS_PER_S 30
+#define LANGTON_FPS 30
+#define LANGTON_MOVES_PER_S 2000
+#define PATTERN_FPS (1/3.0f)
+//Most the stream is shown at, frames that come faster are decoded but not all shown
+#define STREAM_FPS 30
+//How often life-pipelined prints the pipeline's stats
+#define LIFE_PIPELINED_REPORT_MS 5000
+//A life field stuck in a cycle this long is reseeded, 0 never
+#define LIFE_RESEED_MS 60000
+//What the life field starts with, top left corner at LIFE_SEED_X, LIFE_SEED_Y
+#define LIFE_SEED "Gosper glider gun"
+#define LIFE_SEED_X 50
+#define LIFE_SEED_Y 46
+//Frames the Edit mode cursor stays on, then off
+#define LIFE_CURSOR_BLINK_FRAMES 16
+#define LANGTON_ANTS 2
+//1 keeps each effect as it was while the others run, 0 starts it over each
+//time it comes back and needs only the arena of the largest
+#define EFFECTS_KEEP_STATE 1
+
+static void life_cycle_report(const cycle_t *cycle, float step_cost_us) {
+    printf("life: held period %u for %u generations, %u frames unchanged, about %u us of compute saved\n",
+            (unsigned) cycle->period, (unsigned) cycle->replayed, (unsigned) cycle->unchanged,
+            (unsigned) (cycle->replayed*step_cost_us));
+}
+
+//Life on the 128x64 torus. MODE switches between Play and Edit mode. In
+//Edit mode U/L/D/R move the cursor and a tap of C toggles the cell under it;
+//with C held, L/R go through the patterns partition, U turns the pattern
+//and D places it. The cursor and the box around the pattern are composed
+//over the field on the way out, field only ever holds cells.
 typedef struct {
-    uint8_t cmd;
-    uint8_t data[16];
-    uint8_t databytes; //No of data in data; bit 7 = delay after set; 0xFF = end of cmds.
-} scrn_init_cmd_t;
-
-DRAM_ATTR static const scrn_init_cmd_t scrn_init_cmds[]={
-    {0xAE, {0}, 0}, // 0 disp off
-    {0xD5, {0}, 0}, // 1 clk div
-    {0x50, {0}, 0}, // 2 suggested ratio
-    {0xA8, {0x3F}, 1}, // 3 set multiplex
-    {0xD3,{0x0}, 1}, // 5 display offset
-    {0x40, {0}, 0}, // 7 start line
-    {0xAD,{0x8B}, 1}, // 8 enable charge pump
-    {0xA1, {0}, 0}, // 10 seg remap 1, pin header at the top
-    {0xC8, {0}, 0}, // 11 comscandec, pin header at the top
-    {0xDA,{0x12}, 1}, // 12 set compins
-    {0x81,{0x80}, 1}, // 14 set contrast
-    {0xD9,{0x22}, 1}, // 16 set precharge
-    {0xDB,{0x35}, 1}, // 18 set vcom detect
-    {0xA6, {0}, 0}, // 20 display normal (non-inverted)
-    {0xAF, {0}, 0}, // 21 disp on
-    {0, {0}, 0xFF}
+    uint8_t field[2][SCRN_BUF_SIZE];
+    bool adress;                             //Records which memory buffer is being used for what
+    uint8_t cursor[2];                       //Records position of cursor in edit mode
+    bool mode;                               //Play mode or Edit mode
+    compose_t compose;                       //The cursor, pattern box and name over the field
+    bool overlay_stale;                      //They moved or changed
+    life_sparse_t sparse;                    //Which tiles the next generation has to look at
+    scrn_tiles_t touched;                    //Tiles edited since the last generation
+    scrn_tiles_t flush;                      //Tiles the frame changed
+    frame_sched_t *sched;
+    life_ages_t ages;                        //Dying cells, for Generations rules
+    life_rule_t rule;
+    int preset;
+    cycle_t cycle;                           //Replays the field once it repeats
+    uint8_t cycle_frames[CYCLE_MAX_PERIOD*SCRN_BUF_SIZE];  //What cycle captures, rather than on the heap
+    bool cycle_stale;                        //The field was changed other than by stepping
+    int64_t locked_at;
+    float locked_cost_us;
+    pattern_pack_t pack;                     //Patterns C and D place in Edit mode
+    int selected;
+    pattern_rotation_t rotation;
+    bool c_down;                             //C is held, U/L/D/R work the patterns
+    bool chord;                              //Something was done with C held, so it does not toggle the cell
+} life_effect_t;
+
+static bool life_init(void *state, frame_sched_t *sched) {
+    life_effect_t *s = state;
+    pattern_t pattern;
+    s->cursor[0] = 49;
+    s->cursor[1] = 49;
+    s->overlay_stale = true;
+    s->sched = sched;
+    s->rule = life_conway;
+    s->cycle_stale = true;
+    life_sparse_init(&s->sparse);
+    life_ages_clear(&s->ages);
+    compose_init(&s->compose, LIFE_CURSOR_BLINK_FRAMES);
+    pattern_pack_open(&s->pack);
+    s->selected = pattern_find(&s->pack, LIFE_SEED);
+    if (s->selected >= 0 && pattern_get(&s->pack, s->selected, &pattern)) {
+        pattern_draw(&pattern, s->field[0], LIFE_SEED_X, LIFE_SEED_Y, PATTERN_ROT_0, NULL);
+    } else {
+        //No patterns partition, the gun is built in
+        s->selected = 0;
+        for (int i=0;i<sizeof(glider_gun);i+=2) {
+            set_pixel(glider_gun[i], glider_gun[i+1], 1, s->field[0]);
+        }
+    }
+    cycle_init(&s->cycle, s->field[0], s->rule.states-1);
+    cycle_set_store(&s->cycle, s->cycle_frames);
+    return true;
+}
+
+static void life_release(void *state) {
+    life_effect_t *s = state;
+    if (cycle_locked(&s->cycle)) {
+        life_cycle_report(&s->cycle, s->locked_cost_us);
+    }
+    cycle_free(&s->cycle);
+    pattern_pack_close(&s->pack);
+}
+
+static void life_handle_input(void *state, const input_event_t *event) {
+    life_effect_t *s = state;
+    pattern_t pattern;
+    if (event->button == INPUT_C) {
+        s->c_down = event->type != INPUT_RELEASE;
+    }
+    s->overlay_stale = true;
+    //Letting go of C is a tap in Edit mode
+    if (event->type == INPUT_RELEASE && (s->mode || event->button != INPUT_C)) return;
+    //Edit mode or a new rule, the cycle found is no good any more
+    if (!s->cycle_stale && (event->button == INPUT_MODE || (s->mode && (event->button == INPUT_L || event->button == INPUT_R)))) {
+        if (cycle_locked(&s->cycle)) {
+            //The other buffer and the dying cells were left behind while replaying
+            life_cycle_report(&s->cycle, s->locked_cost_us);
+            scrn_tiles_fill(&s->sparse.changed);
+            life_ages_clear(&s->ages);
+        }
+        s->cycle_stale = true;
+        cycle_free(&s->cycle);
+    }
+    if (event->button == INPUT_MODE) {
+        if (event->type == INPUT_PRESS) {
+            s->mode = !s->mode;
+            //C held across the switch is not a tap
+            s->chord = true;
+        }
+        return;
+    }
+    if (s->mode) {
+        //In Play mode L/R go through the rules
+        if (event->button != INPUT_L && event->button != INPUT_R) return;
+        s->preset = (s->preset+(event->button == INPUT_R ? 1 : life_preset_count-1))%life_preset_count;
+        if (life_rule_parse(&s->rule, life_presets[s->preset].rule)) {
+            char rule_name[24];
+            life_rule_format(&s->rule, rule_name, sizeof(rule_name));
+            printf("life: %s, %s\n", life_presets[s->preset].name, rule_name);
+            life_ages_clear(&s->ages);
+            scrn_tiles_fill(&s->sparse.changed);
+            //Dying cells do not show, the field has to repeat while they all go
+            s->cycle.confirm = s->rule.states-1;
+        }
+        return;
+    }
+    uint8_t *lines = s->field[s->adress];
+    if (event->button == INPUT_C) {
+        //A tap toggles the cell, C held with another button does not
+        if (event->type == INPUT_PRESS) {
+            s->chord = false;
+        } else if (!s->chord) {
+            set_pixel(s->cursor[0], s->cursor[1], !get_pixel(s->cursor[0], s->cursor[1], lines), lines);
+            scrn_tiles_mark(&s->touched, s->cursor[0], s->cursor[1]);
+        }
+    } else if (s->c_down) {
+        //L/R choose a pattern, U turns it, D puts its top left corner on the cursor
+        s->chord = true;
+        if (event->button == INPUT_L || event->button == INPUT_R) {
+            s->selected = (s->selected+(event->button == INPUT_R ? 1 : s->pack.count-1))%(s->pack.count ? s->pack.count : 1);
+        } else if (event->button == INPUT_U) {
+            s->rotation = (s->rotation+1)%4;
+        } else if (event->type == INPUT_PRESS && pattern_get(&s->pack, s->selected, &pattern)) {
+            pattern_draw(&pattern, lines, s->cursor[0], s->cursor[1], s->rotation, &s->touched);
+        }
+    } else if (event->button == INPUT_U) {
+        s->cursor[1]--;
+    } else if (event->button == INPUT_L) {
+        s->cursor[0]--;
+    } else if (event->button == INPUT_D) {
+        s->cursor[1]++;
+    } else if (event->button == INPUT_R) {
+        s->cursor[0]++;
+    }
+    s->cursor[0] %= 128;
+    s->cursor[1] %= 64;
+}
+
+static uint32_t life_step_frame(void *state, uint32_t steps) {
+    life_effect_t *s = state;
+    uint8_t *lines[2] = {s->field[0], s->field[1]};
+    bool adress = s->adress;
+    if (!s->mode) {
+        //Edits stay in touched until the next generation
+        s->flush = s->touched;
+        return 0;
+    }
+    if (s->cycle_stale) {
+        cycle_reset(&s->cycle, lines[adress]);
+        s->cycle_stale = false;
+    }
+    scrn_tiles_or(&s->sparse.changed, &s->touched);
+    //The flush has to cover every tile any of the generations changed
+    s->flush = s->touched;
+    scrn_tiles_clear(&s->touched);
+    if (cycle_locked(&s->cycle)) {
+        const uint8_t *frame = NULL;
+        scrn_tiles_t changed;
+        for (uint32_t i=0;i<steps;i++) {
+            frame = cycle_next(&s->cycle, &changed);
+            scrn_tiles_or(&s->flush, &changed);
+        }
+        if (frame && s->cycle.period>1) {
+            memcpy(lines[adress], frame, SCRN_BUF_SIZE);
+        }
+        if (LIFE_RESEED_MS && esp_timer_get_time()-s->locked_at>=LIFE_RESEED_MS*1000ll) {
+            life_cycle_report(&s->cycle, s->locked_cost_us);
+            for (int i=0;i<SCRN_BUF_SIZE;i++) {
+                lines[adress][i] = esp_random();
+            }
+            scrn_tiles_fill(&s->sparse.changed);
+            scrn_tiles_fill(&s->flush);
+            life_ages_clear(&s->ages);
+            cycle_reset(&s->cycle, lines[adress]);
+        }
+    } else {
+        for (uint32_t i=0;i<steps;i++) {
+            TRACE_BEGIN(TRACE_LIFE_GEN);
+            life_step_sparse_rule(&s->sparse, &s->rule, &s->ages, lines[adress], lines[1-adress]);
+            TRACE_END(TRACE_LIFE_GEN);
+            adress = 1-adress;
+            scrn_tiles_or(&s->flush, &s->sparse.changed);
+            if (cycle_update(&s->cycle, lines[1-adress], lines[adress], &s->sparse.changed) == CYCLE_LOCKED) {
+                s->locked_at = esp_timer_get_time();
+                s->locked_cost_us = s->sched->step_cost_us;
+                printf("life: period %u from generation %u\n", (unsigned) s->cycle.period,
+                        (unsigned) (s->cycle.generation-s->cycle.period));
+                //The rest of the frame's generations can be replayed next frame
+                steps = i+1;
+                break;
+            }
+        }
+    }
+    s->adress = adress;
+    return steps;
+}
+
+static const uint8_t *life_render(void *state, scrn_tiles_t *tiles) {
+    life_effect_t *s = state;
+    pattern_t pattern;
+    char label[TEXT_MAX_LEN];
+    if (s->overlay_stale) {
+        s->overlay_stale = false;
+        compose_clear(&s->compose, &s->compose.overlay);
+        compose_clear(&s->compose, &s->compose.blink);
+        if (!s->mode) {
+            compose_pixel(&s->compose, &s->compose.blink, s->cursor[0], s->cursor[1], 1);
+            compose_blink_restart(&s->compose);
+            if (s->c_down && pattern_get(&s->pack, s->selected, &pattern)) {
+                //Where D puts the pattern, and which one it is
+                compose_rect(&s->compose, &s->compose.overlay, s->cursor[0]-1, s->cursor[1]-1,
+                        pattern_width(&pattern, s->rotation)+2, pattern_height(&pattern, s->rotation)+2, 1);
+                snprintf(label, sizeof(label), "%s %d", pattern.name, 90*s->rotation);
+                compose_text(&s->compose, &s->compose.overlay, 0, SCRN_HEIGHT-TEXT_GLYPH_H, label, true);
+            }
+        }
+    }
+    compose_frame(&s->compose, s->field[s->adress], &s->flush, tiles);
+    scrn_tiles_clear(&s->flush);
+    return s->compose.out;
+}
+
+const effect_t effect_life = {
+    .name = "life",
+    .fps = LIFE_FPS,
+    .steps_per_s = LIFE_GENS_PER_S,
+    .state_size = sizeof(life_effect_t),
+    .init = life_init,
+    .release = life_release,
+    .handle_input = life_handle_input,
+    .step = life_step_frame,
+    .render = life_render,
 };
 
-void scrn_cmd(spi_device_handle_t spi, const uint8_t cmd)
-{
-    esp_err_t ret;
-    spi_transaction_t t;
-    memset(&t, 0, sizeof(t));       //Zero out the transaction
-    t.length=8;                     //Command is 8 bits
-    t.tx_buffer=&cmd;               //The data is the cmd itself
-    t.user=(void*)0;                //D/C needs to be set to 0
-    ret=spi_device_transmit(spi, &t);  //Transmit!
-    assert(ret==ESP_OK);            //Should have had no issues.
+static void life_produce(void *ctx, const uint8_t *prev, uint8_t *next) {
+    TRACE_BEGIN(TRACE_LIFE_GEN);
+    life_step(prev, next);
+    TRACE_END(TRACE_LIFE_GEN);
 }
 
-void scrn_data(spi_device_handle_t spi, const uint8_t *data, int len)
-{
-    esp_err_t ret;
-    spi_transaction_t t;
-    if (len==0) return;             //no need to send anything
-    memset(&t, 0, sizeof(t));       //Zero out the transaction
-    t.length=len*8;                 //Len is in bytes, transaction length is in bits.
-    t.tx_buffer=data;               //Data
-    t.user=(void*)0;                //D/C needs to be set to 1
-    ret=spi_device_transmit(spi, &t);  //Transmit!
-    assert(ret==ESP_OK);            //Should have had no issues.
-}
-
-void scrn_spi_pre_transfer_callback(spi_transaction_t *t)
-{
-    int dc=(int)t->user;
-    gpio_set_level(DC_PIN, dc);
+//Frame ring and task on the heap from setup on, parked when not running
+static pipeline_t life_pipeline;
+
+//Play mode only: each generation is computed on the other core while the
+//runner flushes the one before
+typedef struct {
+    pipeline_t *pipeline;                    //life_pipeline
+    const uint8_t *frame;                    //Taken last
+    bool fresh;                              //frame came in with the last step
+    frame_sched_t *sched;
+    int64_t report_at;
+} life_pipelined_effect_t;
+
+//Frames per second of the time it was shown, latency to the end of the flush
+static void life_pipelined_report(life_pipelined_effect_t *s) {
+    pipeline_stats_t stats;
+    pipeline_get_stats(s->pipeline, &stats);
+    int64_t shown_us = s->sched->flushed_at-s->sched->started_at;
+    printf("life: %u frames, %.1f fps, latency avg %d us max %d us\n", (unsigned) stats.frames,
+            shown_us>0 ? stats.frames*1e6f/shown_us : 0.0f, (int) stats.latency_avg_us, (int) stats.latency_max_us);
 }
 
-//Initialize the display
-void scrn_init(spi_device_handle_t spi)
-{
-    int cmd=0;
-    const scrn_init_cmd_t* init_cmds = scrn_init_cmds;
-
-    //Initialize non-SPI GPIOs
-    gpio_set_direction(DC_PIN, GPIO_MODE_OUTPUT);
-    gpio_set_direction(RST_PIN, GPIO_MODE_OUTPUT);
-    gpio_set_direction(MODE_PIN, GPIO_MODE_INPUT);
-    gpio_set_direction(U_PIN, GPIO_MODE_INPUT);
-    gpio_set_direction(L_PIN, GPIO_MODE_INPUT);
-    gpio_set_direction(D_PIN, GPIO_MODE_INPUT);
-    gpio_set_direction(R_PIN, GPIO_MODE_INPUT);
-    gpio_set_direction(C_PIN, GPIO_MODE_INPUT);
-    gpio_set_pull_mode(MODE_PIN, GPIO_PULLUP_ONLY);
-    //Reset the display
-    gpio_set_level(RST_PIN, 0);
-    vTaskDelay(100 / portTICK_RATE_MS);
-    gpio_set_level(RST_PIN, 1);
-    vTaskDelay(100 / portTICK_RATE_MS);
-
-    //Send all the commands
-    while (init_cmds[cmd].databytes!=0xff) {
-        scrn_cmd(spi, init_cmds[cmd].cmd);
-        scrn_data(spi, init_cmds[cmd].data, init_cmds[cmd].databytes&0x1F);
-        cmd++;
-    }
-}
-
-static void send_lines(spi_device_handle_t spi, uint8_t *linedata)
-{
-    esp_err_t ret;
-    static spi_transaction_t trans[16];
+static bool life_pipelined_setup(void) {
+    if (life_pipeline.task) return true;
+    if (!pipeline_init(&life_pipeline, life_produce, NULL, 1000/LIFE_GENS_PER_S)) {
+        printf("life: no memory for the pipeline\n");
+        return false;
+    }
+    return true;
+}
 
-    memset(&trans, 0, sizeof(spi_transaction_t));
-    for (int i=0;i<16;i+=2) {
-        trans[i].length=8*3;
-        trans[i].user=(void*)0;
-        trans[i].flags=SPI_TRANS_USE_TXDATA;
-        trans[i].tx_data[0]=0xB0+(i/2);
-        trans[i].tx_data[1]=0x02;
-        trans[i].tx_data[2]=0x10;
-        trans[i+1].length=1024;
-        trans[i+1].user=(void*)1;  
-        trans[i+1].tx_buffer=linedata+128*(i/2);
-        trans[i+1].flags=0; //undo SPI_TRANS_USE_TXDATA flag
+static bool life_pipelined_init(void *state, frame_sched_t *sched) {
+    life_pipelined_effect_t *s = state;
+    s->pipeline = &life_pipeline;
+    s->sched = sched;
+    uint8_t *seed = pipeline_first_frame(s->pipeline);
+    for (int i=0;i<SCRN_BUF_SIZE;i++) {
+        seed[i] = esp_random();
     }
+    pipeline_start(s->pipeline);
+    s->report_at = esp_timer_get_time();
+    return true;
+}
+
+static void life_pipelined_release(void *state) {
+    life_pipelined_effect_t *s = state;
+    pipeline_stop(s->pipeline);
+    life_pipelined_report(s);
+}
 
-    spi_transaction_t *rtrans;
-    for (int i=0;i<16;i+=1) {
-        ret=spi_device_queue_trans(spi, &trans[i], portMAX_DELAY);
-        assert(ret==ESP_OK);
+static void life_pipelined_handle_input(void *state, const input_event_t *event) {
+}
+
+//The generations come at the pipeline's own pace, the frame shows the newest
+static uint32_t life_pipelined_step(void *state, uint32_t steps) {
+    life_pipelined_effect_t *s = state;
+    uint32_t taken;
+    const uint8_t *frame = pipeline_take(s->pipeline, &taken);
+    if (frame) {
+        s->frame = frame;
     }
-    for (int i=0;i<16;i++) {
-        ret=spi_device_get_trans_result(spi, &rtrans, portMAX_DELAY);
-        assert(ret==ESP_OK);
+    s->fresh = taken>0;
+    if (esp_timer_get_time()-s->report_at>=LIFE_PIPELINED_REPORT_MS*1000ll) {
+        s->report_at = esp_timer_get_time();
+        life_pipelined_report(s);
     }
+    return taken;
 }
 
-void set_pixel(uint8_t x, uint8_t y, uint8_t value, uint8_t *lines) {
-    if (value) {
-        lines[x+128*(y/8)] |= 1<<y%8;
+static const uint8_t *life_pipelined_render(void *state, scrn_tiles_t *tiles) {
+    life_pipelined_effect_t *s = state;
+    if (s->fresh) {
+        scrn_tiles_fill(tiles);
     } else {
-        lines[x+128*(y/8)] &= ~(1<<y%8);
+        scrn_tiles_clear(tiles);
     }
+    return s->frame;
 }
 
-bool get_pixel(uint8_t x, uint8_t y, uint8_t *lines) {
-    return lines[x+128*(y/8)]&(1<<(y%8));
+//Frames that waited while another effect ran do not count in the latency
+static void life_pipelined_shown(void *state) {
+    life_pipelined_effect_t *s = state;
+    if (s->fresh) pipeline_shown(s->pipeline, s->sched->resumed_at);
 }
 
-void set_rect(uint8_t x, uint8_t y, uint8_t width, uint8_t height, uint8_t *lines) {
-    if (height>8-(y%8)) {
-        for (int i=0;i<width;i++) {
-            lines[x+i+128*(y/8)] |= ((uint8_t) ~0)<<(y%8);
-        }
-        set_rect(x, y+8-(y%8), width, height-8+(y%8), lines);
-    } else {
-        for (int i=0;i<width;i++) {
-            lines[x+i+128*(y/8)] |= ((uint8_t) (((uint8_t) ~0)<<height))>>(8-height-(y%8));
-        }
+const effect_t effect_life_pipelined = {
+    .name = "life-pipelined",
+    .fps = LIFE_FPS,
+    .steps_per_s = LIFE_GENS_PER_S,
+    .state_size = sizeof(life_pipelined_effect_t),
+    .setup = life_pipelined_setup,
+    .init = life_pipelined_init,
+    .release = life_pipelined_release,
+    .handle_input = life_pipelined_handle_input,
+    .step = life_pipelined_step,
+    .render = life_pipelined_render,
+    .shown = life_pipelined_shown,
+};
+
+//Node pool on the heap from setup on
+static hashlife_t hashlife_universe;
+
+//Life on an unbounded plane, drawn through a 128x64 window. In edit mode
+//U/L/D/R pan the window, C changes how many generations a frame skips and
+//the window position and generation are shown.
+typedef struct {
+    hashlife_t *universe;                    //hashlife_universe
+    uint8_t lines[SCRN_BUF_SIZE];
+    int64_t view[2];                         //Top left cell of the window
+    uint8_t step_log2;
+    bool mode;                               //Starts in Play mode, Edit mode pans
+    uint32_t frames;
+} hashlife_effect_t;
+
+static bool hashlife_effect_setup(void) {
+    if (hashlife_universe.stats.capacity) return true;
+    if (!hashlife_init(&hashlife_universe, HASHLIFE_MAX_NODES)) {
+        printf("hashlife: no memory for %d nodes\n", HASHLIFE_MIN_NODES);
+        return false;
     }
+    return true;
 }
 
-uint8_t count_neighbourghs(uint8_t x, uint8_t y, uint8_t *lines){
-    uint8_t sets[8][2] = {{x-1, y-1}, {x, y-1}, {x+1, y-1}, {x-1, y}, {x+1, y}, {x-1, y+1}, {x, y+1}, {x+1, y+1}};
-    uint8_t a=0;
-    for (int i=0;i<8;i++) {
-        sets[i][0]%=128;
-        sets[i][1]%=64;
-        a += get_pixel(sets[i][0], sets[i][1], lines);
-    }
-    return a;
-}
-
-void display_game_of_life(spi_device_handle_t spi, uint8_t *lines[2]) {
-    bool adress = 0;                         //Records which memory buffer is being used for what
-    uint8_t cursor[] = {49, 49};             //Records position of cursor in edit mode
-    bool mode = 0;                           //Play mode or Edit mode
-    //These three variables let the cursor flash
-    bool cursor_on = 0;                      //Records state
-    uint8_t cursor_switch_counter = 0;       //Switches state every 7 loops
-    bool cursor_state = 0;                   //Remebers the state of the pixel before the cursor got there
-    bool mode_reverted = true;               //Remembers whether cursor_state needs to be reset (after running, it may have changed)
-    //These five allow commands to be recieved with little repitition
-    bool prev_state[] = {0, 0, 0, 0, 0};
-    bool new_state[5];
-    uint8_t changed;
-    uint8_t counters[] = {0, 0, 0, 0, 0};
-    uint8_t pins[] = {U_PIN, L_PIN, D_PIN, R_PIN, C_PIN};
-    uint8_t glider[] = {50, 50, 51, 51, 52, 49, 52, 50, 52, 51};
-    uint8_t glider_gun[] = {50, 50, 50, 51, 51, 50, 51, 51, 60, 50, 60, 51, 60, 52, 
-            61, 49, 61, 53, 62, 48, 62, 54, 63, 48, 63, 54, 64, 51, 65, 49, 65, 53, 
-            66, 50, 66, 51, 66, 52, 67, 51, 70, 48, 70, 49, 70, 50, 71, 48, 71, 49,
-            71, 50, 72, 47, 72, 51, 74, 46, 74, 47, 74, 51, 74, 52, 84, 48, 84, 49,
-            85, 48, 85, 49};
-    for (int i=0;i<72;i+=2) {
-        set_pixel(glider_gun[0], glider_gun[1], 1, lines[adress]);
-    }
-    while (1) {
-        if (mode) {
-            set_pixel(cursor[0], cursor[1], cursor_state, lines[adress]);
-            for (int i=0;i<128;i++) {
-                for (int j=0;j<64;j++) {
-                    set_pixel(i, j, 0, lines[1-adress]);
-                    uint8_t b = count_neighbourghs(i, j, lines[adress]);
-                    if (get_pixel(i, j, lines[adress])) {
-                        if (b<2||b>3) {
-                            set_pixel(i, j, 0, lines[1-adress]);
-                        } else {
-                            set_pixel(i, j, 1, lines[1-adress]);
-                        }
-                    } else {
-                        if (b==3) {
-                            set_pixel(i, j, 1, lines[1-adress]);
-                        }
-                    }
-                }
-            }
-            adress = 1-adress;
-            mode_reverted = true;
-        } else {
-            if (mode_reverted) {
-                mode_reverted = false;
-                cursor_state = get_pixel(cursor[0], cursor[1], lines[adress]);
-            }
-            cursor_switch_counter+=1;
-            cursor_switch_counter%=16;
-            if (!cursor_switch_counter) {
-                cursor_on = !cursor_on;
-            }
-            changed=13;
-            for (int i=0;i<4;i++) {
-                new_state[i] = gpio_get_level(pins[i]);
-                if (new_state[i]) {
-                    if (prev_state[i]) {
-                        counters[i] += 1;
-                        if (counters[i] > 15) {
-                            counters[i] = 12;
-                            changed = i;
-                        }
-                    } else {
-                        counters[i] = 0;
-                        changed = i;
-                    }
-                }
-                prev_state[i]=new_state[i];
-            }
-            new_state[4] = gpio_get_level(pins[4]);
-            if (new_state[4]&&!prev_state[4]) {
-                changed = 4;
-                counters[4] = 0;
-            }
-            prev_state[4]=new_state[4];
-            if (changed != 13) {
-                if (changed != 4) {
-                    set_pixel(cursor[0], cursor[1], cursor_state, lines[adress]);
-                }
-                if (changed == 0) {
-                    cursor[1]--;
-                } else if (changed == 1) {
-                    cursor[0]--;
-                } else if (changed == 2) {
-                    cursor[1]++;
-                } else if (changed == 3) {
-                    cursor[0]++;
-                } else if (changed == 4) {
-                    set_pixel(cursor[0], cursor[1], !cursor_state, lines[adress]);
-                }
-                cursor[0] %= 128;
-                cursor[1] %= 64;
-                cursor_state = get_pixel(cursor[0], cursor[1], lines[adress]);
-            }
-            set_pixel(cursor[0], cursor[1], cursor_on, lines[adress]);
-        }
-        vTaskDelay(30/portTICK_RATE_MS);
-        send_lines(spi, lines[adress]);
-        bool current_mode = mode;
-        if (gpio_get_level(MODE_PIN)==0) {
-            for (int i=0;i<3;i++) {
-                vTaskDelay(30/portTICK_RATE_MS);
-                if (gpio_get_level(MODE_PIN)==0) {
-                    mode = !current_mode;
-                }
-            }
-        }
+static bool hashlife_effect_init(void *state, frame_sched_t *sched) {
+    hashlife_effect_t *s = state;
+    s->universe = &hashlife_universe;
+    hashlife_set_step_log2(s->universe, 0);
+    s->view[0] = -64;
+    s->view[1] = -32;
+    s->mode = 1;
+    for (int i=0;i<sizeof(glider_gun);i+=2) {
+        hashlife_set_cell(s->universe, glider_gun[i]+s->view[0], glider_gun[i+1]+s->view[1], 1);
     }
+    return true;
 }
 
-void display_langtons_ant(spi_device_handle_t spi, uint8_t *lines) {
-    uint8_t positions[2][2] = {{64, 32}, {62, 32}};
-    uint8_t directions[] = {1, 1};
-    bool a;
-    while (1) {
-        while (gpio_get_level(MODE_PIN)==1) {
-            for (int i=0;i<2;i++) {
-                if (i!=1||positions[0][0]!=positions[1][0]||positions[0][1]!=positions[1][1]) {
-                    a = get_pixel(positions[i][0], positions[i][1], lines);
-                }
-                if (a) {
-                    directions[i]++;
-                } else {
-                    directions[i]--;
-                }
-                set_pixel(positions[i][0], positions[i][1], !a, lines);
-                directions[i]%=4;
-                if (directions[i] == 0) {
-                    positions[i][0]+=1;
-                } else if (directions[i] == 1) {
-                    positions[i][1]+=1;
-                } else if (directions[i] == 2) {
-                    positions[i][0]-=1;
-                } else {
-                    positions[i][1]-=1;
-                }
-                positions[i][0]%=128;
-                positions[i][1]%=64;
-                send_lines(spi, lines);
-                vTaskDelay(8/portTICK_RATE_MS);
-            }
-        }
-        while (gpio_get_level(MODE_PIN)==1) {
-            vTaskDelay(100/portTICK_RATE_MS);
+//Left empty for the next start
+static void hashlife_effect_release(void *state) {
+    hashlife_effect_t *s = state;
+    hashlife_clear(s->universe);
+}
+
+static void hashlife_effect_handle_input(void *state, const input_event_t *event) {
+    hashlife_effect_t *s = state;
+    if (event->type == INPUT_RELEASE) return;
+    if (event->button == INPUT_MODE) {
+        if (event->type == INPUT_PRESS) {
+            s->mode = !s->mode;
         }
+    } else if (s->mode) {
+        return;
+    } else if (event->button == INPUT_U) {
+        s->view[1] -= 8;
+    } else if (event->button == INPUT_L) {
+        s->view[0] -= 8;
+    } else if (event->button == INPUT_D) {
+        s->view[1] += 8;
+    } else if (event->button == INPUT_R) {
+        s->view[0] += 8;
+    } else if (event->type == INPUT_PRESS) {
+        s->step_log2 = (s->step_log2+1)%16;
+        hashlife_set_step_log2(s->universe, s->step_log2);
+        printf("hashlife: %llu generations a frame\n", 1ull<<s->step_log2);
     }
 }
 
-static void display_such_a_complicated_pattern(spi_device_handle_t spi, uint8_t *lines)
-{
-    while (1) {
-        for (int i = 0;i<128;i++) {
-            for (int j=0;j<64;j++) {
-                set_pixel(i, j, 0, lines);
+static uint32_t hashlife_effect_step(void *state, uint32_t steps) {
+    hashlife_effect_t *s = state;
+    if (!s->mode) {
+        return 0;
+    }
+    for (uint32_t i=0;i<steps;i++) {
+        if (!hashlife_step(s->universe)) {
+            if (s->step_log2>0) {
+                //Too far ahead for the pool, try shorter steps
+                hashlife_set_step_log2(s->universe, --s->step_log2);
             }
+            return i;
         }
-        set_rect(10, 10, 100, 50, lines);
-        send_lines(spi, lines);
-        vTaskDelay(3000/portTICK_RATE_MS);
-    }
-}
-
-char font8x8_basic[128][8] = {
-    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // U+0000 (nul)
-    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // U+0001
-    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // U+0002
-    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // U+0003
-    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // U+0004
-    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // U+0005
-    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // U+0006
-    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // U+0007
-    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // U+0008
-    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // U+0009
-    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // U+000A
-    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // U+000B
-    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // U+000C
-    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // U+000D
-    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // U+000E
-    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // U+000F
-    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // U+0010
-    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // U+0011
-    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // U+0012
-    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // U+0013
-    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // U+0014
-    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // U+0015
-    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // U+0016
-    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // U+0017
-    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // U+0018
-    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // U+0019
-    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // U+001A
-    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // U+001B
-    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // U+001C
-    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // U+001D
-    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // U+001E
-    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // U+001F
-    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // U+0020 (space)
-    { 0x18, 0x3C, 0x3C, 0x18, 0x18, 0x00, 0x18, 0x00},   // U+0021 (!)
-    { 0x36, 0x36, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // U+0022 (")
-    { 0x36, 0x36, 0x7F, 0x36, 0x7F, 0x36, 0x36, 0x00},   // U+0023 (#)
-    { 0x0C, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x0C, 0x00},   // U+0024 ($)
-    { 0x00, 0x63, 0x33, 0x18, 0x0C, 0x66, 0x63, 0x00},   // U+0025 (%)
-    { 0x1C, 0x36, 0x1C, 0x6E, 0x3B, 0x33, 0x6E, 0x00},   // U+0026 (&)
-    { 0x06, 0x06, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00},   // U+0027 (')
-    { 0x18, 0x0C, 0x06, 0x06, 0x06, 0x0C, 0x18, 0x00},   // U+0028 (()
-    { 0x06, 0x0C, 0x18, 0x18, 0x18, 0x0C, 0x06, 0x00},   // U+0029 ())
-    { 0x00, 0x66, 0x3C, 0xFF, 0x3C, 0x66, 0x00, 0x00},   // U+002A (*)
-    { 0x00, 0x0C, 0x0C, 0x3F, 0x0C, 0x0C, 0x00, 0x00},   // U+002B (+)
-    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x06},   // U+002C (,)
-    { 0x00, 0x00, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00},   // U+002D (-)
-    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x00},   // U+002E (.)
-    { 0x60, 0x30, 0x18, 0x0C, 0x06, 0x03, 0x01, 0x00},   // U+002F (/)
-    { 0x3E, 0x63, 0x73, 0x7B, 0x6F, 0x67, 0x3E, 0x00},   // U+0030 (0)
-    { 0x0C, 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x3F, 0x00},   // U+0031 (1)
-    { 0x1E, 0x33, 0x30, 0x1C, 0x06, 0x33, 0x3F, 0x00},   // U+0032 (2)
-    { 0x1E, 0x33, 0x30, 0x1C, 0x30, 0x33, 0x1E, 0x00},   // U+0033 (3)
-    { 0x38, 0x3C, 0x36, 0x33, 0x7F, 0x30, 0x78, 0x00},   // U+0034 (4)
-    { 0x3F, 0x03, 0x1F, 0x30, 0x30, 0x33, 0x1E, 0x00},   // U+0035 (5)
-    { 0x1C, 0x06, 0x03, 0x1F, 0x33, 0x33, 0x1E, 0x00},   // U+0036 (6)
-    { 0x3F, 0x33, 0x30, 0x18, 0x0C, 0x0C, 0x0C, 0x00},   // U+0037 (7)
-    { 0x1E, 0x33, 0x33, 0x1E, 0x33, 0x33, 0x1E, 0x00},   // U+0038 (8)
-    { 0x1E, 0x33, 0x33, 0x3E, 0x30, 0x18, 0x0E, 0x00},   // U+0039 (9)
-    { 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x00},   // U+003A (:)
-    { 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x06},   // U+003B (//)
-    { 0x18, 0x0C, 0x06, 0x03, 0x06, 0x0C, 0x18, 0x00},   // U+003C (<)
-    { 0x00, 0x00, 0x3F, 0x00, 0x00, 0x3F, 0x00, 0x00},   // U+003D (=)
-    { 0x06, 0x0C, 0x18, 0x30, 0x18, 0x0C, 0x06, 0x00},   // U+003E (>)
-    { 0x1E, 0x33, 0x30, 0x18, 0x0C, 0x00, 0x0C, 0x00},   // U+003F (?)
-    { 0x3E, 0x63, 0x7B, 0x7B, 0x7B, 0x03, 0x1E, 0x00},   // U+0040 (@)
-    { 0x0C, 0x1E, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x00},   // U+0041 (A)
-    { 0x3F, 0x66, 0x66, 0x3E, 0x66, 0x66, 0x3F, 0x00},   // U+0042 (B)
-    { 0x3C, 0x66, 0x03, 0x03, 0x03, 0x66, 0x3C, 0x00},   // U+0043 (C)
-    { 0x1F, 0x36, 0x66, 0x66, 0x66, 0x36, 0x1F, 0x00},   // U+0044 (D)
-    { 0x7F, 0x46, 0x16, 0x1E, 0x16, 0x46, 0x7F, 0x00},   // U+0045 (E)
-    { 0x7F, 0x46, 0x16, 0x1E, 0x16, 0x06, 0x0F, 0x00},   // U+0046 (F)
-    { 0x3C, 0x66, 0x03, 0x03, 0x73, 0x66, 0x7C, 0x00},   // U+0047 (G)
-    { 0x33, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x33, 0x00},   // U+0048 (H)
-    { 0x1E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00},   // U+0049 (I)
-    { 0x78, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E, 0x00},   // U+004A (J)
-    { 0x67, 0x66, 0x36, 0x1E, 0x36, 0x66, 0x67, 0x00},   // U+004B (K)
-    { 0x0F, 0x06, 0x06, 0x06, 0x46, 0x66, 0x7F, 0x00},   // U+004C (L)
-    { 0x63, 0x77, 0x7F, 0x7F, 0x6B, 0x63, 0x63, 0x00},   // U+004D (M)
-    { 0x63, 0x67, 0x6F, 0x7B, 0x73, 0x63, 0x63, 0x00},   // U+004E (N)
-    { 0x1C, 0x36, 0x63, 0x63, 0x63, 0x36, 0x1C, 0x00},   // U+004F (O)
-    { 0x3F, 0x66, 0x66, 0x3E, 0x06, 0x06, 0x0F, 0x00},   // U+0050 (P)
-    { 0x1E, 0x33, 0x33, 0x33, 0x3B, 0x1E, 0x38, 0x00},   // U+0051 (Q)
-    { 0x3F, 0x66, 0x66, 0x3E, 0x36, 0x66, 0x67, 0x00},   // U+0052 (R)
-    { 0x1E, 0x33, 0x07, 0x0E, 0x38, 0x33, 0x1E, 0x00},   // U+0053 (S)
-    { 0x3F, 0x2D, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00},   // U+0054 (T)
-    { 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x3F, 0x00},   // U+0055 (U)
-    { 0x33, 0x33, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00},   // U+0056 (V)
-    { 0x63, 0x63, 0x63, 0x6B, 0x7F, 0x77, 0x63, 0x00},   // U+0057 (W)
-    { 0x63, 0x63, 0x36, 0x1C, 0x1C, 0x36, 0x63, 0x00},   // U+0058 (X)
-    { 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x0C, 0x1E, 0x00},   // U+0059 (Y)
-    { 0x7F, 0x63, 0x31, 0x18, 0x4C, 0x66, 0x7F, 0x00},   // U+005A (Z)
-    { 0x1E, 0x06, 0x06, 0x06, 0x06, 0x06, 0x1E, 0x00},   // U+005B ([)
-    { 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x40, 0x00},   // U+005C (\)
-    { 0x1E, 0x18, 0x18, 0x18, 0x18, 0x18, 0x1E, 0x00},   // U+005D (])
-    { 0x08, 0x1C, 0x36, 0x63, 0x00, 0x00, 0x00, 0x00},   // U+005E (^)
-    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF},   // U+005F (_)
-    { 0x0C, 0x0C, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00},   // U+0060 (`)
-    { 0x00, 0x00, 0x1E, 0x30, 0x3E, 0x33, 0x6E, 0x00},   // U+0061 (a)
-    { 0x07, 0x06, 0x06, 0x3E, 0x66, 0x66, 0x3B, 0x00},   // U+0062 (b)
-    { 0x00, 0x00, 0x1E, 0x33, 0x03, 0x33, 0x1E, 0x00},   // U+0063 (c)
-    { 0x38, 0x30, 0x30, 0x3e, 0x33, 0x33, 0x6E, 0x00},   // U+0064 (d)
-    { 0x00, 0x00, 0x1E, 0x33, 0x3f, 0x03, 0x1E, 0x00},   // U+0065 (e)
-    { 0x1C, 0x36, 0x06, 0x0f, 0x06, 0x06, 0x0F, 0x00},   // U+0066 (f)
-    { 0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x1F},   // U+0067 (g)
-    { 0x07, 0x06, 0x36, 0x6E, 0x66, 0x66, 0x67, 0x00},   // U+0068 (h)
-    { 0x0C, 0x00, 0x0E, 0x0C, 0x0C, 0x0C, 0x1E, 0x00},   // U+0069 (i)
-    { 0x30, 0x00, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E},   // U+006A (j)
-    { 0x07, 0x06, 0x66, 0x36, 0x1E, 0x36, 0x67, 0x00},   // U+006B (k)
-    { 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00},   // U+006C (l)
-    { 0x00, 0x00, 0x33, 0x7F, 0x7F, 0x6B, 0x63, 0x00},   // U+006D (m)
-    { 0x00, 0x00, 0x1F, 0x33, 0x33, 0x33, 0x33, 0x00},   // U+006E (n)
-    { 0x00, 0x00, 0x1E, 0x33, 0x33, 0x33, 0x1E, 0x00},   // U+006F (o)
-    { 0x00, 0x00, 0x3B, 0x66, 0x66, 0x3E, 0x06, 0x0F},   // U+0070 (p)
-    { 0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x78},   // U+0071 (q)
-    { 0x00, 0x00, 0x3B, 0x6E, 0x66, 0x06, 0x0F, 0x00},   // U+0072 (r)
-    { 0x00, 0x00, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x00},   // U+0073 (s)
-    { 0x08, 0x0C, 0x3E, 0x0C, 0x0C, 0x2C, 0x18, 0x00},   // U+0074 (t)
-    { 0x00, 0x00, 0x33, 0x33, 0x33, 0x33, 0x6E, 0x00},   // U+0075 (u)
-    { 0x00, 0x00, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00},   // U+0076 (v)
-    { 0x00, 0x00, 0x63, 0x6B, 0x7F, 0x7F, 0x36, 0x00},   // U+0077 (w)
-    { 0x00, 0x00, 0x63, 0x36, 0x1C, 0x36, 0x63, 0x00},   // U+0078 (x)
-    { 0x00, 0x00, 0x33, 0x33, 0x33, 0x3E, 0x30, 0x1F},   // U+0079 (y)
-    { 0x00, 0x00, 0x3F, 0x19, 0x0C, 0x26, 0x3F, 0x00},   // U+007A (z)
-    { 0x38, 0x0C, 0x0C, 0x07, 0x0C, 0x0C, 0x38, 0x00},   // U+007B ({)
-    { 0x18, 0x18, 0x18, 0x00, 0x18, 0x18, 0x18, 0x00},   // U+007C (|)
-    { 0x07, 0x0C, 0x0C, 0x38, 0x0C, 0x0C, 0x07, 0x00},   // U+007D (})
-    { 0x6E, 0x3B, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // U+007E (~)
-    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}    // U+007F
+    }
+    return steps;
+}
+
+static const uint8_t *hashlife_effect_render(void *state, scrn_tiles_t *tiles) {
+    hashlife_effect_t *s = state;
+    hashlife_stats_t *stats = &s->universe->stats;
+    hashlife_render(s->universe, s->lines, s->view[0], s->view[1]);
+    if (!s->mode) {
+        //Where the window is and how far the pattern has run
+        text_printf(s->lines, 0, 0, TEXT_OPAQUE, NULL, "%lld,%lld", (long long) s->view[0], (long long) s->view[1]);
+        text_printf(s->lines, 0, SCRN_HEIGHT-TEXT_GLYPH_H, TEXT_OPAQUE, NULL, "g%llu k%u",
+                (unsigned long long) stats->generation, (unsigned) s->step_log2);
+    }
+    if (++s->frames%200 == 0) {
+        printf("hashlife: gen %llu, %u/%u nodes (peak %u), %u gcs freed %u, memo %u/%u, %u failed steps\n",
+                (unsigned long long) stats->generation, (unsigned) stats->live, (unsigned) stats->capacity,
+                (unsigned) stats->peak, (unsigned) stats->gc_runs, (unsigned) stats->gc_freed,
+                (unsigned) stats->memo_hits, (unsigned) (stats->memo_hits+stats->memo_misses),
+                (unsigned) stats->alloc_failures);
+    }
+    //The window is drawn over whole, the flush finds what changed
+    scrn_tiles_fill(tiles);
+    return s->lines;
+}
+
+const effect_t effect_hashlife = {
+    .name = "hashlife",
+    .fps = HASHLIFE_FPS,
+    .steps_per_s = HASHLIFE_STEPS_PER_S,
+    .state_size = sizeof(hashlife_effect_t),
+    .setup = hashlife_effect_setup,
+    .init = hashlife_effect_init,
+    .release = hashlife_effect_release,
+    .handle_input = hashlife_effect_handle_input,
+    .step = hashlife_effect_step,
+    .render = hashlife_effect_render,
 };
 
-static void draw_string(uint8_t *a,uint8_t length, uint8_t x, uint8_t y, uint8_t *lines) {
-    for (int i=0;i<length;i++) {
-        for (int j=0;j<8;j++) {
-            lines[((y+j)/8)*128+x+8*i] = *a[i][j];
-        }
+//Turn the ant according to the colour a of its cell, flip the cell and step forward
+void langton_ant_move(uint8_t position[2], uint8_t *direction, bool a, uint8_t *lines) {
+    if (a) {
+        (*direction)++;
+    } else {
+        (*direction)--;
+    }
+    set_pixel(position[0], position[1], !a, lines);
+    *direction%=4;
+    if (*direction == 0) {
+        position[0]+=1;
+    } else if (*direction == 1) {
+        position[1]+=1;
+    } else if (*direction == 2) {
+        position[0]-=1;
+    } else {
+        position[1]-=1;
     }
+    position[0]%=128;
+    position[1]%=64;
 }
 
-void app_main()
-{   
-    esp_err_t ret;
-    spi_device_handle_t spi;
-    spi_bus_config_t buscfg={
-        .mosi_io_num=MOSI_PIN,
-        .sclk_io_num=CLK_PIN,
-        .quadwp_io_num=-1,
-        .quadhd_io_num=-1,
-        .max_transfer_sz=256
-    };
-    spi_device_interface_config_t devcfg={
-        .clock_speed_hz= 20000000,
-        .mode=0,                                //SPI mode 0
-        .spics_io_num=CS_PIN,                   //CS pin
-        .queue_size=17,                          //We want to be able to queue 17 transactions at a time
-        .pre_cb=scrn_spi_pre_transfer_callback //Specify pre-transfer callback to handle D/C line
-    };
-    uint8_t *lines[2];
-    lines[0]=heap_caps_malloc(1024*sizeof(uint8_t), MALLOC_CAP_DMA);
-    assert(lines[0]!=NULL);
-    lines[1]=heap_caps_malloc(1024*sizeof(uint8_t), MALLOC_CAP_DMA);
-    assert(lines[1]!=NULL);
-    //Initialize the SPI bus
-    ret=spi_bus_initialize(HSPI_HOST, &buscfg, 1);
-    ESP_ERROR_CHECK(ret);
-    //Attach the scrn to the SPI bus
-    ret=spi_bus_add_device(HSPI_HOST, &devcfg, &spi);
-    ESP_ERROR_CHECK(ret);
-    //Initialize the scrn
-    scrn_init(spi);
-    for (int i=0;i<2;i++) {
-        for (int j=0;j<1024;j++) {
-            lines[i][j] = 0x00;
-        }
+//Two ants on the torus. C fast-forwards, holding MODE pauses them.
+typedef struct {
+    turmite_t turmite;
+    turmite_ant_t ants[LANGTON_ANTS];
+    uint8_t lines[SCRN_BUF_SIZE];
+    bool fast;
+    frame_sched_t *sched;
+} ant_effect_t;
+
+static bool ant_init(void *state, frame_sched_t *sched) {
+    ant_effect_t *s = state;
+    s->sched = sched;
+    if (!turmite_init_ants(&s->turmite, "LR", s->ants, LANGTON_ANTS)) {
+        return false;
+    }
+    turmite_add_ant(&s->turmite, 64, 32, 1);
+    turmite_add_ant(&s->turmite, 62, 32, 1);
+    return true;
+}
+
+static void ant_release(void *state) {
+    ant_effect_t *s = state;
+    turmite_free(&s->turmite);
+}
+
+static void ant_handle_input(void *state, const input_event_t *event) {
+    ant_effect_t *s = state;
+    if (event->button == INPUT_C && event->type == INPUT_PRESS) {
+        //Fast-forward: as many moves as the frame has room for
+        s->fast = !s->fast;
+        frame_sched_set_rate(s->sched, s->fast ? FRAME_SCHED_FLAT_OUT : LANGTON_MOVES_PER_S);
+    }
+}
+
+static uint32_t ant_step(void *state, uint32_t steps) {
+    ant_effect_t *s = state;
+    //Holding MODE pauses the ants
+    if (input_is_down(INPUT_MODE)) {
+        steps = 0;
     }
-    //Initialize the effect displayed
-    //display_langtons_ant(spi, lines[0]);
-}
\ No newline at end of file
+    turmite_run(&s->turmite, steps);
+    return steps;
+}
+
+static const uint8_t *ant_render(void *state, scrn_tiles_t *tiles) {
+    ant_effect_t *s = state;
+    turmite_render(&s->turmite, s->lines, tiles);
+    return s->lines;
+}
+
+const effect_t effect_ant = {
+    .name = "ant",
+    .fps = LANGTON_FPS,
+    .steps_per_s = LANGTON_MOVES_PER_S,
+    .state_size = sizeof(ant_effect_t),
+    .init = ant_init,
+    .release = ant_release,
+    .handle_input = ant_handle_input,
+    .step = ant_step,
+    .render = ant_render,
+};
+
+typedef struct {
+    uint8_t lines[SCRN_BUF_SIZE];
+} complicated_effect_t;
+
+//Drawn once, frames after the first change nothing
+static bool complicated_init(void *state, frame_sched_t *sched) {
+    complicated_effect_t *s = state;
+    gfx_clear(s->lines);
+    gfx_rect_fill(s->lines, 10, 10, 100, 50, GFX_SET);
+    return true;
+}
+
+static void complicated_handle_input(void *state, const input_event_t *event) {
+}
+
+static uint32_t complicated_step(void *state, uint32_t steps) {
+    return steps;
+}
+
+static const uint8_t *complicated_render(void *state, scrn_tiles_t *tiles) {
+    complicated_effect_t *s = state;
+    scrn_tiles_clear(tiles);
+    return s->lines;
+}
+
+const effect_t effect_pattern = {
+    .name = "pattern",
+    .fps = PATTERN_FPS,
+    .steps_per_s = 0,
+    .state_size = sizeof(complicated_effect_t),
+    .init = complicated_init,
+    .handle_input = complicated_handle_input,
+    .step = complicated_step,
+    .render = complicated_render,
+};
+
+//Show frames sent over the console UART, see stream.h and host/stream_send.c
+typedef struct {
+    stream_rx_t rx;                          //Decodes, the runner flushes
+    uint8_t lines[2][SCRN_BUF_SIZE];
+    uint32_t frames;                         //Decoded by the last render
+} stream_effect_t;
+
+//The driver stays installed from setup on
+static bool stream_effect_setup(void) {
+    static bool installed;
+    if (installed) return true;
+    if (stream_open(STREAM_UART) != ESP_OK) {
+        printf("stream: no UART %d\n", STREAM_UART);
+        return false;
+    }
+    installed = true;
+    return true;
+}
+
+static bool stream_effect_init(void *state, frame_sched_t *sched) {
+    stream_effect_t *s = state;
+    uint8_t *lines[2] = {s->lines[0], s->lines[1]};
+    //Whatever came while it was not running is no use without what came before
+    uart_flush_input(STREAM_UART);
+    //Until the first key frame comes, which goes to lines[0]
+    text_printf(s->lines[1], 0, 0, TEXT_OR, NULL, "waiting for frames\n%d baud", STREAM_BAUD);
+    stream_rx_init(&s->rx, lines, NULL);
+    return true;
+}
+
+static void stream_effect_handle_input(void *state, const input_event_t *event) {
+}
+
+//What came in since the last frame, without waiting for more
+static uint32_t stream_effect_step(void *state, uint32_t steps) {
+    stream_effect_t *s = state;
+    stream_poll(&s->rx, STREAM_UART, 0);
+    return s->rx.frames-s->frames;
+}
+
+static const uint8_t *stream_effect_render(void *state, scrn_tiles_t *tiles) {
+    stream_effect_t *s = state;
+    if (s->rx.frames != s->frames) {
+        s->frames = s->rx.frames;
+        scrn_tiles_fill(tiles);
+    } else {
+        scrn_tiles_clear(tiles);
+    }
+    return s->lines[s->rx.shown < 0 ? 1 : s->rx.shown];
+}
+
+const effect_t effect_stream = {
+    .name = "stream",
+    .fps = STREAM_FPS,
+    .steps_per_s = 0,
+    .state_size = sizeof(stream_effect_t),
+    .setup = stream_effect_setup,
+    .init = stream_effect_init,
+    .handle_input = stream_effect_handle_input,
+    .step = stream_effect_step,
+    .render = stream_effect_render,
+};
+
+//What MODE with L/R goes through, in order
+const effect_t *const effect_list[] = {&effect_life, &effect_ant, &effect_pattern, &effect_hashlife,
+        &effect_life_pipelined, &effect_stream};
+const int effect_list_count = sizeof(effect_list)/sizeof(effect_list[0]);
+
+void display_effects(scrn_delta_t *scrn, const char *first) {
+    static effect_runner_t runner;
+    uint8_t *arena = heap_caps_malloc(EFFECT_ARENA_SIZE, MALLOC_CAP_8BIT);
+    if (arena == NULL || !effect_runner_init(&runner, scrn, effect_list, effect_list_count, arena,
+            EFFECT_ARENA_SIZE, EFFECTS_KEEP_STATE)) {
+        printf("effect: no room for the effects\n");
+        heap_caps_free(arena);
+        return;
+    }
+    int index = first ? effect_runner_find(&runner, first) : 0;
+    if (index < 0 || !effect_runner_switch(&runner, index, 1, 0)) {
+        heap_caps_free(arena);
+        return;
+    }
+    effect_runner_run(&runner);
+}
+
+void app_main()
+{
+    spi_device_handle_t spi=scrn_open();
+    input_init();
+    scrn_delta_t *scrn=heap_caps_malloc(sizeof(scrn_delta_t), MALLOC_CAP_DMA);
+    assert(scrn!=NULL);
+    scrn_delta_init(scrn, spi);
+    //The effects, MODE with L/R goes from one to the next
+    display_effects(scrn, NULL);
+}
@@ -0,0 +1,120 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "driver/gpio.h"
+#include "esp_timer.h"
+#include "pins.h"
+#include "input.h"
+
+//The timers run their callbacks one at a time in the esp_timer task, so
+//only the interrupt and them touch the state below, and the interrupt only
+//restarts the debounce timer.
+
+static const uint8_t input_pins[INPUT_BUTTONS] = {U_PIN, L_PIN, D_PIN, R_PIN, C_PIN, MODE_PIN};
+//Level of each pin while its button is held: MODE pulls to ground
+static const uint8_t input_active[INPUT_BUTTONS] = {1, 1, 1, 1, 1, 0};
+static const bool input_repeats[INPUT_BUTTONS] = {1, 1, 1, 1, 0, 0};
+
+static QueueHandle_t input_q;
+static esp_timer_handle_t debounce_timer;
+static esp_timer_handle_t repeat_timer;
+static volatile bool down[INPUT_BUTTONS];
+static int64_t repeat_at[INPUT_BUTTONS];
+static volatile uint32_t dropped;
+
+static void input_send(uint8_t button, uint8_t type, int64_t now) {
+    input_event_t event = {button, type, now};
+    if (xQueueSend(input_q, &event, 0)!=pdTRUE) {
+        dropped++;
+    }
+}
+
+//Arm the repeat timer for the held direction due first, if any
+static void input_schedule_repeat(int64_t now) {
+    int64_t next = 0;
+    for (int b=0;b<INPUT_BUTTONS;b++) {
+        if (input_repeats[b] && down[b] && (next==0 || repeat_at[b]<next)) {
+            next = repeat_at[b];
+        }
+    }
+    esp_timer_stop(repeat_timer);
+    if (next) {
+        esp_timer_start_once(repeat_timer, next>now ? next-now : 1);
+    }
+}
+
+static void input_debounced(void *arg) {
+    int64_t now = esp_timer_get_time();
+    for (int b=0;b<INPUT_BUTTONS;b++) {
+        bool level = gpio_get_level(input_pins[b])==input_active[b];
+        if (level==down[b]) continue;
+        down[b] = level;
+        input_send(b, level ? INPUT_PRESS : INPUT_RELEASE, now);
+        if (level) {
+            repeat_at[b] = now+INPUT_REPEAT_DELAY_US;
+        }
+    }
+    input_schedule_repeat(now);
+}
+
+static void input_repeat(void *arg) {
+    int64_t now = esp_timer_get_time();
+    for (int b=0;b<INPUT_BUTTONS;b++) {
+        if (input_repeats[b] && down[b] && repeat_at[b]<=now) {
+            input_send(b, INPUT_REPEAT, now);
+            repeat_at[b] += INPUT_REPEAT_US;
+        }
+    }
+    input_schedule_repeat(now);
+}
+
+static void IRAM_ATTR input_isr(void *arg) {
+    //Any edge pushes the read back until the pins have settled
+    esp_timer_stop(debounce_timer);
+    esp_timer_start_once(debounce_timer, INPUT_DEBOUNCE_US);
+}
+
+bool input_init(void) {
+    if (input_q!=NULL) return true;
+    esp_timer_create_args_t debounce_args = {.callback=input_debounced, .name="input debounce"};
+    esp_timer_create_args_t repeat_args = {.callback=input_repeat, .name="input repeat"};
+    input_q = xQueueCreate(INPUT_QUEUE_LEN, sizeof(input_event_t));
+    if (input_q==NULL) return false;
+    ESP_ERROR_CHECK(esp_timer_create(&debounce_args, &debounce_timer));
+    ESP_ERROR_CHECK(esp_timer_create(&repeat_args, &repeat_timer));
+    //Already installed is fine, someone else may use GPIO interrupts too
+    esp_err_t ret = gpio_install_isr_service(0);
+    if (ret!=ESP_OK && ret!=ESP_ERR_INVALID_STATE) {
+        ESP_ERROR_CHECK(ret);
+    }
+    for (int b=0;b<INPUT_BUTTONS;b++) {
+        gpio_set_direction(input_pins[b], GPIO_MODE_INPUT);
+        if (!input_active[b]) {
+            gpio_set_pull_mode(input_pins[b], GPIO_PULLUP_ONLY);
+        }
+        down[b] = gpio_get_level(input_pins[b])==input_active[b];
+        gpio_set_intr_type(input_pins[b], GPIO_INTR_ANYEDGE);
+        ESP_ERROR_CHECK(gpio_isr_handler_add(input_pins[b], input_isr, NULL));
+    }
+    return true;
+}
+
+bool input_poll(input_event_t *event) {
+    return input_wait(event, 0);
+}
+
+bool input_wait(input_event_t *event, TickType_t ticks) {
+    if (input_q==NULL) return false;
+    return xQueueReceive(input_q, event, ticks)==pdTRUE;
+}
+
+bool input_is_down(input_button_t button) {
+    return down[button];
+}
+
+void input_flush(void) {
+    if (input_q!=NULL) xQueueReset(input_q);
+}
+
+uint32_t input_dropped(void) {
+    return dropped;
+}
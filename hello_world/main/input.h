@@ -0,0 +1,53 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+
+//Buttons as events. Every edge on a button pin restarts a debounce timer;
+//once the pins have been quiet for INPUT_DEBOUNCE_US they are read and the
+//changes queued, so an event comes at most that long after the last bounce.
+//U/L/D/R held down also repeat.
+
+#define INPUT_DEBOUNCE_US 5000
+#define INPUT_REPEAT_DELAY_US 450000 //Held this long, a direction starts repeating
+#define INPUT_REPEAT_US 120000
+#define INPUT_QUEUE_LEN 16
+
+typedef enum {
+    INPUT_U,
+    INPUT_L,
+    INPUT_D,
+    INPUT_R,
+    INPUT_C,
+    INPUT_MODE,
+    INPUT_BUTTONS
+} input_button_t;
+
+typedef enum {
+    INPUT_PRESS,
+    INPUT_RELEASE,
+    INPUT_REPEAT
+} input_type_t;
+
+typedef struct {
+    uint8_t button;                  //input_button_t
+    uint8_t type;                    //input_type_t
+    int64_t time_us;                 //When the pins were read, esp_timer time
+} input_event_t;
+
+//Set up the pins, their interrupts and the timers. Safe to call again.
+bool input_init(void);
+//Take the next event without waiting, false if there is none
+bool input_poll(input_event_t *event);
+//Same, waiting up to ticks for one
+bool input_wait(input_event_t *event, TickType_t ticks);
+//Debounced state of a button
+bool input_is_down(input_button_t button);
+//Drop the events not taken yet
+void input_flush(void);
+//Events lost because the queue was full
+uint32_t input_dropped(void);
+
+#endif
@@ -0,0 +1,418 @@
+#include <stdio.h>
+#include <string.h>
+#include "life.h"
+#include "framebuffer.h"
+
+//Column groups with at most this many tiles to recompute go tile by tile
+#define LIFE_TILE_PATH_MAX 2
+//With at least this many of the 128 tiles to recompute the whole field is
+//stepped, which costs less than going through them column by column
+#define LIFE_SPARSE_FULL_TILES 48
+
+//The packed kernel works on whole screen columns: the 8 page bytes of a column
+//form one 64 bit word with bit n being row n, so vertical neighbours are a
+//rotate away and the horizontal ones are the adjacent column words.
+static inline uint64_t life_load_column(const uint8_t *lines, int x) {
+    uint64_t c = 0;
+    for (int p=SCRN_PAGES-1;p>=0;p--) {
+        c = (c<<8)|lines[x+SCRN_WIDTH*p];
+    }
+    return c;
+}
+
+static inline void life_store_column(uint8_t *lines, int x, uint64_t c) {
+    for (int p=0;p<SCRN_PAGES;p++) {
+        lines[x+SCRN_WIDTH*p] = (uint8_t) c;
+        c >>= 8;
+    }
+}
+
+//Sum the cell above, the cell itself and the cell below for all 64 rows at once.
+//The 2 bit result is returned as two bit planes.
+static inline void life_vertical_sum(uint64_t c, uint64_t *s0, uint64_t *s1) {
+    uint64_t up = (c<<1)|(c>>63);
+    uint64_t down = (c>>1)|(c<<63);
+    *s0 = up^c^down;
+    *s1 = (up&c)|(down&(up^c));
+}
+
+//The next state from the 3x3 count w3 w2 w1 w0 (the cell included) and the
+//cell: a dead cell with a count in birth is born, a live one with a count
+//in survive<<1 stays. With constant masks the counts the rule does not use
+//drop out, and B3/S23 comes down to the adder network's usual two terms.
+#define LIFE_COUNT(T, k) \
+    if (((birth|survive<<1)>>(k))&1) { \
+        T eq = ((k)&1 ? w0 : ~w0)&((k)&2 ? w1 : ~w1)&((k)&4 ? w2 : ~w2)&((k)&8 ? w3 : ~w3); \
+        if ((birth>>(k))&1 && (survive<<1>>(k))&1) { \
+            out |= eq; \
+        } else if ((birth>>(k))&1) { \
+            out |= eq&~centre; \
+        } else { \
+            out |= eq&centre; \
+        } \
+    }
+#define LIFE_COUNTS(T) \
+    LIFE_COUNT(T, 0) LIFE_COUNT(T, 1) LIFE_COUNT(T, 2) LIFE_COUNT(T, 3) LIFE_COUNT(T, 4) \
+    LIFE_COUNT(T, 5) LIFE_COUNT(T, 6) LIFE_COUNT(T, 7) LIFE_COUNT(T, 8) LIFE_COUNT(T, 9)
+
+static inline __attribute__((always_inline)) uint64_t life_rule64(uint64_t centre, uint64_t w0, uint64_t w1,
+        uint64_t w2, uint64_t w3, uint16_t birth, uint16_t survive) {
+    uint64_t out = 0;
+    LIFE_COUNTS(uint64_t)
+    return out;
+}
+
+static inline __attribute__((always_inline)) uint32_t life_rule32(uint32_t centre, uint32_t w0, uint32_t w1,
+        uint32_t w2, uint32_t w3, uint16_t birth, uint16_t survive) {
+    uint32_t out = 0;
+    LIFE_COUNTS(uint32_t)
+    return out;
+}
+
+//Compute the next generation of the n columns starting at x0 into out
+static inline __attribute__((always_inline)) void life_compute_columns(const uint8_t *src, int x0, int n,
+        uint64_t *out, uint16_t birth, uint16_t survive) {
+    uint64_t l0, l1, c0, c1, r0, r1;
+    uint64_t centre = life_load_column(src, x0);
+    life_vertical_sum(life_load_column(src, (x0+SCRN_WIDTH-1)%SCRN_WIDTH), &l0, &l1);
+    life_vertical_sum(centre, &c0, &c1);
+    for (int i=0;i<n;i++) {
+        uint64_t right = life_load_column(src, (x0+i+1)%SCRN_WIDTH);
+        life_vertical_sum(right, &r0, &r1);
+        //Add the three column sums into the 3x3 block count w3 w2 w1 w0 (0-9)
+        uint64_t w0 = l0^c0^r0;
+        uint64_t k = (l0&c0)|(r0&(l0^c0));
+        uint64_t a = l1^c1, ac = l1&c1;
+        uint64_t b = r1^k, bc = r1&k;
+        uint64_t w1 = a^b;
+        uint64_t w2 = (ac^bc)|(a&b);
+        uint64_t w3 = ac&bc;
+        out[i] = life_rule64(centre, w0, w1, w2, w3, birth, survive);
+        l0 = c0; l1 = c1;
+        c0 = r0; c1 = r1;
+        centre = right;
+    }
+}
+
+//Compute the next generation of one tile (8 columns at x0 in page p) into out.
+//Each column is read as a 24 bit window of the pages above, at and below, so
+//the rows bordering the tile are there and no wrap is needed within a word.
+static inline __attribute__((always_inline)) void life_compute_tile(const uint8_t *src, int x0, int p,
+        uint8_t *out, uint16_t birth, uint16_t survive) {
+    const uint8_t *above = src+SCRN_WIDTH*((p+SCRN_PAGES-1)%SCRN_PAGES);
+    const uint8_t *at = src+SCRN_WIDTH*p;
+    const uint8_t *below = src+SCRN_WIDTH*((p+1)%SCRN_PAGES);
+    uint32_t l0, l1, c0, c1, r0, r1, centre, right;
+    int x = (x0+SCRN_WIDTH-1)%SCRN_WIDTH;
+    uint32_t left = above[x]|(at[x]<<8)|(below[x]<<16);
+    centre = above[x0]|(at[x0]<<8)|(below[x0]<<16);
+    l0 = (left<<1)^left^(left>>1);
+    l1 = ((left<<1)&left)|((left>>1)&((left<<1)^left));
+    c0 = (centre<<1)^centre^(centre>>1);
+    c1 = ((centre<<1)&centre)|((centre>>1)&((centre<<1)^centre));
+    for (int i=0;i<SCRN_TILE_COLS;i++) {
+        x = (x0+i+1)%SCRN_WIDTH;
+        right = above[x]|(at[x]<<8)|(below[x]<<16);
+        r0 = (right<<1)^right^(right>>1);
+        r1 = ((right<<1)&right)|((right>>1)&((right<<1)^right));
+        //Same adder network as life_compute_columns, on 32 bits
+        uint32_t w0 = l0^c0^r0;
+        uint32_t k = (l0&c0)|(r0&(l0^c0));
+        uint32_t a = l1^c1, ac = l1&c1;
+        uint32_t b = r1^k, bc = r1&k;
+        uint32_t w1 = a^b;
+        uint32_t w2 = (ac^bc)|(a&b);
+        uint32_t w3 = ac&bc;
+        out[i] = life_rule32(centre, w0, w1, w2, w3, birth, survive)>>8;
+        l0 = c0; l1 = c1;
+        c0 = r0; c1 = r1;
+        centre = right;
+    }
+}
+
+//A kernel for every rule below that is worth one, plus the generic one.
+//name(birth, survive) are the neighbour counts as bit masks.
+#define LIFE_KERNEL(name, birth, survive) \
+    static void life_columns_##name(const life_rule_t *rule, const uint8_t *src, int x0, int n, uint64_t *out) { \
+        life_compute_columns(src, x0, n, out, birth, survive); \
+    } \
+    static void life_tile_##name(const life_rule_t *rule, const uint8_t *src, int x0, int p, uint8_t *out) { \
+        life_compute_tile(src, x0, p, out, birth, survive); \
+    }
+
+LIFE_KERNEL(generic, rule->birth, rule->survive)
+LIFE_KERNEL(conway, 0x008, 0x00C)            //B3/S23
+LIFE_KERNEL(highlife, 0x048, 0x00C)          //B36/S23
+LIFE_KERNEL(seeds, 0x004, 0x000)             //B2/S, also Brian's Brain
+LIFE_KERNEL(day_night, 0x1C8, 0x1D8)         //B3678/S34678
+
+const life_kernel_t life_kernel_generic = {"generic", 0, 0, life_columns_generic, life_tile_generic};
+
+static const life_kernel_t life_kernels[] = {
+    {"B3/S23", 0x008, 0x00C, life_columns_conway, life_tile_conway},
+    {"B36/S23", 0x048, 0x00C, life_columns_highlife, life_tile_highlife},
+    {"B2/S", 0x004, 0x000, life_columns_seeds, life_tile_seeds},
+    {"B3678/S34678", 0x1C8, 0x1D8, life_columns_day_night, life_tile_day_night},
+};
+
+const life_rule_t life_conway = {0x008, 0x00C, 2, &life_kernels[0]};
+
+const life_preset_t life_presets[] = {
+    {"Conway", "B3/S23"},
+    {"HighLife", "B36/S23"},
+    {"Seeds", "B2/S"},
+    {"Day & Night", "B3678/S34678"},
+    {"Life without death", "B3/S012345678"},
+    {"Maze", "B3/S12345"},
+    {"Brian's Brain", "B2/S/C3"},
+    {"Star Wars", "B2/S345/C4"},
+};
+const int life_preset_count = sizeof(life_presets)/sizeof(life_presets[0]);
+
+//Digits 0-8 into a mask, false on anything else
+static bool life_parse_counts(const char *s, const char *end, uint16_t *mask) {
+    *mask = 0;
+    for (;s<end;s++) {
+        if (*s<'0' || *s>'8') return false;
+        *mask |= 1<<(*s-'0');
+    }
+    return true;
+}
+
+bool life_rule_parse(life_rule_t *rule, const char *text) {
+    const char *fields[3];
+    const char *ends[3];
+    int n = 0;
+    bool labelled = false, have_b = false, have_s = false;
+    uint16_t birth = 0, survive = 0;
+    int states = 2;
+    for (const char *s=text;;s++) {
+        const char *end = strchr(s, '/');
+        if (end==NULL) end = s+strlen(s);
+        if (n==3) return false;
+        fields[n] = s;
+        ends[n++] = end;
+        if (*end=='\0') break;
+        s = end;
+    }
+    for (int i=0;i<n;i++) {
+        char c = fields[i]<ends[i] ? fields[i][0]|0x20 : 0;
+        if (c=='b' || c=='s' || c=='c' || c=='g') labelled = true;
+    }
+    for (int i=0;i<n;i++) {
+        const char *s = fields[i], *end = ends[i];
+        char kind;
+        if (labelled) {
+            if (s==end) return false;
+            kind = *s++|0x20;
+        } else {
+            //Survival/birth/states
+            kind = "sbc"[i];
+        }
+        if (kind=='b' && !have_b) {
+            if (!life_parse_counts(s, end, &birth)) return false;
+            have_b = true;
+        } else if (kind=='s' && !have_s) {
+            if (!life_parse_counts(s, end, &survive)) return false;
+            have_s = true;
+        } else if ((kind=='c' || kind=='g') && s<end) {
+            states = 0;
+            for (;s<end;s++) {
+                if (*s<'0' || *s>'9' || states>LIFE_MAX_STATES) return false;
+                states = states*10+*s-'0';
+            }
+            if (states<2 || states>LIFE_MAX_STATES) return false;
+        } else {
+            return false;
+        }
+    }
+    if (!have_b || (labelled && !have_s && n>1)) return false;
+    rule->birth = birth;
+    rule->survive = survive;
+    rule->states = states;
+    rule->kernel = &life_kernel_generic;
+    for (int i=0;i<sizeof(life_kernels)/sizeof(life_kernels[0]);i++) {
+        if (life_kernels[i].birth==birth && life_kernels[i].survive==survive) {
+            rule->kernel = &life_kernels[i];
+        }
+    }
+    return true;
+}
+
+void life_rule_format(const life_rule_t *rule, char *buf, int len) {
+    char b[10], s[10];
+    int nb = 0, ns = 0;
+    for (int i=0;i<=8;i++) {
+        if (rule->birth&(1<<i)) b[nb++] = '0'+i;
+        if (rule->survive&(1<<i)) s[ns++] = '0'+i;
+    }
+    b[nb] = s[ns] = '\0';
+    if (rule->states>2) {
+        snprintf(buf, len, "B%s/S%s/C%d", b, s, rule->states);
+    } else {
+        snprintf(buf, len, "B%s/S%s", b, s);
+    }
+}
+
+void life_ages_clear(life_ages_t *ages) {
+    memset(ages, 0, sizeof(*ages));
+}
+
+//Generations: given the column as it was and what the Life-like rule makes
+//of it, hold back births where a cell is still dying, start the cells that
+//did not survive dying and move the dying ones on a state
+static inline uint64_t life_age_column(const life_rule_t *rule, life_ages_t *ages, int x, uint64_t alive, uint64_t next) {
+    uint64_t age[LIFE_AGE_BITS];
+    uint64_t dying = 0, carry, expired = ~(uint64_t) 0;
+    for (int b=0;b<LIFE_AGE_BITS;b++) {
+        //A cell set live over a dying one is live
+        age[b] = ages->planes[b][x]&~alive;
+        dying |= age[b];
+    }
+    next &= ~dying;
+    //Add one to the age of the dying cells, bit sliced
+    carry = dying;
+    for (int b=0;b<LIFE_AGE_BITS;b++) {
+        uint64_t a = age[b];
+        age[b] = a^carry;
+        carry = a&carry;
+    }
+    //Age states-1 is past the last dying state, back to dead
+    for (int b=0;b<LIFE_AGE_BITS;b++) {
+        expired &= ((rule->states-1)>>b)&1 ? age[b] : ~age[b];
+    }
+    for (int b=0;b<LIFE_AGE_BITS;b++) {
+        ages->planes[b][x] = age[b]&~expired;
+    }
+    //Cells that were alive have age 0, so the first dying state is just bit 0
+    ages->planes[0][x] |= alive&~next;
+    return next;
+}
+
+void life_step_rule(const life_rule_t *rule, life_ages_t *ages, const uint8_t *src, uint8_t *dst) {
+    uint64_t out[SCRN_TILE_COLS];
+    for (int x=0;x<SCRN_WIDTH;x+=SCRN_TILE_COLS) {
+        rule->kernel->columns(rule, src, x, SCRN_TILE_COLS, out);
+        for (int i=0;i<SCRN_TILE_COLS;i++) {
+            if (rule->states>2) {
+                out[i] = life_age_column(rule, ages, x+i, life_load_column(src, x+i), out[i]);
+            }
+            life_store_column(dst, x+i, out[i]);
+        }
+    }
+}
+
+void life_step(const uint8_t *src, uint8_t *dst) {
+    life_step_rule(&life_conway, NULL, src, dst);
+}
+
+void life_sparse_init(life_sparse_t *s) {
+    scrn_tiles_fill(&s->changed);
+    s->tiles_computed = 0;
+}
+
+void life_step_sparse(life_sparse_t *s, const uint8_t *src, uint8_t *dst) {
+    life_step_sparse_rule(s, &life_conway, NULL, src, dst);
+}
+
+void life_step_sparse_rule(life_sparse_t *s, const life_rule_t *rule, life_ages_t *ages, const uint8_t *src, uint8_t *dst) {
+    scrn_tiles_t around, changed;
+    uint64_t out[SCRN_TILE_COLS];
+    if (rule->states>2 || (rule->birth&1)) {
+        life_step_rule(rule, ages, src, dst);
+        scrn_tiles_fill(&s->changed);
+        s->tiles_computed = SCRN_TILES_X*SCRN_PAGES;
+        return;
+    }
+    //A tile can only change if something changed in it or next to it
+    for (int p=0;p<SCRN_PAGES;p++) {
+        uint16_t r = s->changed.rows[p];
+        around.rows[p] = r|(uint16_t) ((r<<1)|(r>>15))|(uint16_t) ((r>>1)|(r<<15));
+    }
+    for (int p=0;p<SCRN_PAGES;p++) {
+        changed.rows[p] = around.rows[(p+SCRN_PAGES-1)%SCRN_PAGES]|around.rows[p]|around.rows[(p+1)%SCRN_PAGES];
+    }
+    s->changed = changed;
+    s->tiles_computed = 0;
+    if (scrn_tiles_count(&changed)>=LIFE_SPARSE_FULL_TILES) {
+        //Busy field: step all of it, then see which tiles changed
+        life_step_rule(rule, ages, src, dst);
+        s->tiles_computed = SCRN_TILES_X*SCRN_PAGES;
+        for (int p=0;p<SCRN_PAGES;p++) {
+            uint16_t rows = 0;
+            for (int t=0;t<SCRN_TILES_X;t++) {
+                uint64_t before, after;
+                memcpy(&before, src+t*SCRN_TILE_COLS+SCRN_WIDTH*p, sizeof(before));
+                memcpy(&after, dst+t*SCRN_TILE_COLS+SCRN_WIDTH*p, sizeof(after));
+                rows |= (uint16_t) (before!=after)<<t;
+            }
+            s->changed.rows[p] = rows;
+        }
+        return;
+    }
+    //Everything else in dst already equals src
+    for (int t=0;t<SCRN_TILES_X;t++) {
+        uint8_t pages = 0;
+        for (int p=0;p<SCRN_PAGES;p++) {
+            pages |= ((changed.rows[p]>>t)&1)<<p;
+        }
+        if (!pages) continue;
+        //A few tiles are cheaper on their own than the whole column. The
+        //columns are stored whole: the tiles not needed come out as they
+        //were, which is what dst already holds there.
+        bool by_tile = __builtin_popcount(pages)<=LIFE_TILE_PATH_MAX;
+        if (!by_tile) {
+            rule->kernel->columns(rule, src, t*SCRN_TILE_COLS, SCRN_TILE_COLS, out);
+            for (int i=0;i<SCRN_TILE_COLS;i++) {
+                life_store_column(dst, t*SCRN_TILE_COLS+i, out[i]);
+            }
+        }
+        for (int p=0;p<SCRN_PAGES;p++) {
+            if (!(pages&(1<<p))) continue;
+            s->tiles_computed++;
+            const uint8_t *from = src+t*SCRN_TILE_COLS+SCRN_WIDTH*p;
+            uint8_t *to = dst+t*SCRN_TILE_COLS+SCRN_WIDTH*p;
+            if (by_tile) {
+                rule->kernel->tile(rule, src, t*SCRN_TILE_COLS, p, to);
+            }
+            uint64_t before, after;
+            memcpy(&before, from, sizeof(before));
+            memcpy(&after, to, sizeof(after));
+            bool diff = before!=after;
+            if (!diff) {
+                s->changed.rows[p] &= ~(1<<t);
+            }
+        }
+    }
+}
+
+static uint8_t count_neighbourghs(uint8_t x, uint8_t y, uint8_t *lines){
+    uint8_t sets[8][2] = {{x-1, y-1}, {x, y-1}, {x+1, y-1}, {x-1, y}, {x+1, y}, {x-1, y+1}, {x, y+1}, {x+1, y+1}};
+    uint8_t a=0;
+    for (int i=0;i<8;i++) {
+        sets[i][0]%=128;
+        sets[i][1]%=64;
+        a += get_pixel(sets[i][0], sets[i][1], lines);
+    }
+    return a;
+}
+
+void life_step_scalar(uint8_t *src, uint8_t *dst) {
+    for (int i=0;i<128;i++) {
+        for (int j=0;j<64;j++) {
+            set_pixel(i, j, 0, dst);
+            uint8_t b = count_neighbourghs(i, j, src);
+            if (get_pixel(i, j, src)) {
+                if (b<2||b>3) {
+                    set_pixel(i, j, 0, dst);
+                } else {
+                    set_pixel(i, j, 1, dst);
+                }
+            } else {
+                if (b==3) {
+                    set_pixel(i, j, 1, dst);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,91 @@
+#ifndef LIFE_H
+#define LIFE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "framebuffer.h"
+
+//Compute the next generation of Conway's Life on the 128x64 torus.
+//src and dst are page format framebuffers and must not overlap.
+void life_step(const uint8_t *src, uint8_t *dst);
+
+//Incremental stepping: only the tiles around those that changed in the last
+//generation are recomputed. As it ping-pongs between two buffers, dst must
+//hold the generation before src, except in the tiles marked in changed.
+//Mark there any edits made to src between steps, or fill changed when
+//starting on a new pair of buffers.
+typedef struct {
+    scrn_tiles_t changed;            //Tiles where dst differs from src after the last step
+    uint32_t tiles_computed;         //Tiles the last step recomputed
+} life_sparse_t;
+
+void life_sparse_init(life_sparse_t *s);
+void life_step_sparse(life_sparse_t *s, const uint8_t *src, uint8_t *dst);
+
+//Other outer-totalistic rules. A rule is which neighbour counts give birth
+//and which let a cell survive, parsed from the usual notations: "B36/S23",
+//"23/36" (survival first), and for Generations rules, where a cell that
+//dies fades through states-2 dying states before it can be born again,
+//"B2/S/C3" or "/2/3". Only live cells count as neighbours.
+#define LIFE_MAX_STATES 64
+#define LIFE_AGE_BITS 6                  //Enough for the dying states of LIFE_MAX_STATES
+
+typedef struct life_kernel life_kernel_t;
+
+typedef struct {
+    uint16_t birth;                  //Bit n: a dead cell with n live neighbours is born
+    uint16_t survive;                //Bit n: a live cell with n live neighbours stays alive
+    uint8_t states;                  //2 for Life-like rules
+    const life_kernel_t *kernel;     //Compiled for the masks, set by life_rule_parse
+} life_rule_t;
+
+//The kernel for a rule. Rules with a kernel of their own have the masks
+//compiled in; the generic one reads them from the rule and is slower.
+struct life_kernel {
+    const char *name;
+    uint16_t birth;
+    uint16_t survive;
+    //Next generation of n whole columns from x0, as 64 bit column words
+    void (*columns)(const life_rule_t *rule, const uint8_t *src, int x0, int n, uint64_t *out);
+    //Next generation of the tile of 8 columns at x0 in page p
+    void (*tile)(const life_rule_t *rule, const uint8_t *src, int x0, int p, uint8_t *out);
+};
+
+extern const life_kernel_t life_kernel_generic;
+extern const life_rule_t life_conway;
+
+//Rules with a name, for menus
+typedef struct {
+    const char *name;
+    const char *rule;
+} life_preset_t;
+
+extern const life_preset_t life_presets[];
+extern const int life_preset_count;
+
+//false if text is not a rule, or has more than LIFE_MAX_STATES states
+bool life_rule_parse(life_rule_t *rule, const char *text);
+//As B.../S... with /C... for Generations rules
+void life_rule_format(const life_rule_t *rule, char *buf, int len);
+
+//How far each dying cell is through its dying states, as bit planes of
+//column words. Only Generations rules use it; clear it when starting one.
+typedef struct {
+    uint64_t planes[LIFE_AGE_BITS][SCRN_WIDTH];
+} life_ages_t;
+
+void life_ages_clear(life_ages_t *ages);
+//ages may be NULL for a rule with 2 states. Cells set in src where a dying
+//cell is are alive again.
+void life_step_rule(const life_rule_t *rule, life_ages_t *ages, const uint8_t *src, uint8_t *dst);
+//life_step_sparse for any rule. Fill changed after switching rules, as what
+//was still under the old one need not be under the new. Rules where empty
+//space or dying cells can change on their own (B0, Generations) are
+//stepped whole, with every tile marked changed.
+void life_step_sparse_rule(life_sparse_t *s, const life_rule_t *rule, life_ages_t *ages, const uint8_t *src, uint8_t *dst);
+
+//Same rule, one cell at a time through get_pixel/set_pixel.
+//Slow, kept as the reference the packed kernel is checked against.
+void life_step_scalar(uint8_t *src, uint8_t *dst);
+
+#endif
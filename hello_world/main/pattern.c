@@ -0,0 +1,169 @@
+#include <string.h>
+#include "pattern.h"
+
+bool pattern_pack_init(pattern_pack_t *pack, const void *base, uint32_t size) {
+    const pattern_pack_header_t *header = base;
+    memset(pack, 0, sizeof(*pack));
+    if (size<sizeof(*header) || header->magic!=PATTERN_PACK_MAGIC || header->size<sizeof(*header) || header->size>size) {
+        return false;
+    }
+    if (header->count>(header->size-sizeof(*header))/sizeof(pattern_pack_entry_t)) return false;
+    pack->base = base;
+    pack->size = header->size;
+    pack->count = header->count;
+    pack->entries = (const pattern_pack_entry_t*) (header+1);
+    return true;
+}
+
+bool pattern_pack_open(pattern_pack_t *pack) {
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+            (esp_partition_subtype_t) PATTERN_PARTITION_SUBTYPE, PATTERN_PARTITION);
+    pattern_pack_header_t header;
+    const void *base;
+    spi_flash_mmap_handle_t handle;
+    memset(pack, 0, sizeof(*pack));
+    if (part==NULL || esp_partition_read(part, 0, &header, sizeof(header))!=ESP_OK) return false;
+    //Only as much of the partition as the pack takes is mapped
+    if (header.magic!=PATTERN_PACK_MAGIC || header.size>part->size) return false;
+    if (esp_partition_mmap(part, 0, header.size, SPI_FLASH_MMAP_DATA, &base, &handle)!=ESP_OK) return false;
+    if (!pattern_pack_init(pack, base, header.size)) {
+        spi_flash_munmap(handle);
+        return false;
+    }
+    pack->handle = handle;
+    pack->mapped = true;
+    return true;
+}
+
+void pattern_pack_close(pattern_pack_t *pack) {
+    if (pack->mapped) spi_flash_munmap(pack->handle);
+    memset(pack, 0, sizeof(*pack));
+}
+
+bool pattern_get(const pattern_pack_t *pack, uint32_t i, pattern_t *p) {
+    if (i>=pack->count) return false;
+    const pattern_pack_entry_t *e = &pack->entries[i];
+    if (memchr(e->name, '\0', sizeof(e->name))==NULL) return false;
+    if (e->offset>pack->size || e->length>pack->size-e->offset) return false;
+    return pattern_parse(p, e->name, (const char*) pack->base+e->offset, e->length);
+}
+
+int pattern_find(const pattern_pack_t *pack, const char *name) {
+    for (uint32_t i=0;i<pack->count;i++) {
+        if (strncmp(pack->entries[i].name, name, PATTERN_NAME_LEN)==0) return i;
+    }
+    return -1;
+}
+
+//The number after "key =" in a header line
+static bool pattern_field(const char *s, const char *end, char key, uint32_t *value) {
+    for (const char *f=s;f<end;f++) {
+        //Keys start the line or follow a comma or a space
+        if (*f!=key || (f>s && f[-1]!=',' && f[-1]!=' ')) continue;
+        const char *v = f+1;
+        while (v<end && *v==' ') v++;
+        if (v==end || *v!='=') continue;
+        for (v++;v<end && *v==' ';v++);
+        if (v==end || *v<'0' || *v>'9') return false;
+        for (*value=0;v<end && *v>='0' && *v<='9';v++) {
+            if (*value>=100000000) return false;
+            *value = *value*10+*v-'0';
+        }
+        return true;
+    }
+    return false;
+}
+
+bool pattern_parse(pattern_t *p, const char *name, const char *rle, uint32_t length) {
+    const char *end = rle+length;
+    memset(p, 0, sizeof(*p));
+    p->name = name;
+    p->rle = rle;
+    p->length = length;
+    for (const char *s=rle;s<end;) {
+        const char *eol = memchr(s, '\n', end-s);
+        if (eol==NULL) eol = end;
+        if (*s!='#' && *s!='\n' && *s!='\r') {
+            //The first line that is not a comment is the header
+            if (!pattern_field(s, eol, 'x', &p->width) || !pattern_field(s, eol, 'y', &p->height)) return false;
+            p->runs = eol;
+            return true;
+        }
+        s = eol+1;
+    }
+    return false;
+}
+
+//n live cells from column x, row y on, going right (dx 1), left (dx -1),
+//down (dy 1) or up (dy -1). Coordinates wrap.
+static void pattern_run(uint8_t *lines, int x, int y, int dx, int dy, uint32_t n, scrn_tiles_t *tiles) {
+    if (dy==0) {
+        //Beyond a screen's width the run only wraps onto cells it already set
+        if (n>SCRN_WIDTH) n = SCRN_WIDTH;
+        int page = (y&(SCRN_HEIGHT-1))>>3;
+        uint8_t bit = 1<<(y&7);
+        uint8_t *row = lines+SCRN_WIDTH*page;
+        for (;n;n--, x+=dx) {
+            int c = x&(SCRN_WIDTH-1);
+            row[c] |= bit;
+            if (tiles) tiles->rows[page] |= 1<<(c/SCRN_TILE_COLS);
+        }
+        return;
+    }
+    //Down the column a page at a time, so up is down from the other end
+    if (n>SCRN_HEIGHT) n = SCRN_HEIGHT;
+    if (dy<0) y -= n-1;
+    x &= SCRN_WIDTH-1;
+    while (n) {
+        int r = y&(SCRN_HEIGHT-1);
+        uint32_t k = 8-(r&7);
+        if (k>n) k = n;
+        lines[x+SCRN_WIDTH*(r>>3)] |= ((1<<k)-1)<<(r&7);
+        if (tiles) tiles->rows[r>>3] |= 1<<(x/SCRN_TILE_COLS);
+        y += k;
+        n -= k;
+    }
+}
+
+uint32_t pattern_draw(const pattern_t *p, uint8_t *lines, int x, int y, pattern_rotation_t rotation,
+        scrn_tiles_t *tiles) {
+    const char *end = p->rle+p->length;
+    int w = p->width, h = p->height;
+    uint32_t run = 0, col = 0, row = 0, cells = 0;
+    for (const char *s=p->runs;s<end;s++) {
+        char c = *s;
+        if (c>='0' && c<='9') {
+            if (run<100000000) run = run*10+c-'0';
+            continue;
+        }
+        //States past X take two letters, p to y then A to X
+        if (c>='p' && c<='y') continue;
+        uint32_t n = run ? run : 1;
+        if (c=='b' || c=='.') {
+            col += n;
+        } else if (c=='o' || (c>='A' && c<='X')) {
+            //Where the run starts once rotated, and which way it goes
+            if (rotation==PATTERN_ROT_0) {
+                pattern_run(lines, x+col, y+row, 1, 0, n, tiles);
+            } else if (rotation==PATTERN_ROT_90) {
+                pattern_run(lines, x+h-1-row, y+col, 0, 1, n, tiles);
+            } else if (rotation==PATTERN_ROT_180) {
+                pattern_run(lines, x+w-1-col, y+h-1-row, -1, 0, n, tiles);
+            } else {
+                pattern_run(lines, x+row, y+w-1-col, 0, -1, n, tiles);
+            }
+            col += n;
+            cells += n;
+        } else if (c=='$') {
+            row += n;
+            col = 0;
+        } else if (c=='!') {
+            break;
+        } else {
+            //Line breaks and spaces
+            continue;
+        }
+        run = 0;
+    }
+    return cells;
+}
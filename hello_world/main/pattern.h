@@ -0,0 +1,90 @@
+#ifndef PATTERN_H
+#define PATTERN_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_partition.h"
+#include "framebuffer.h"
+
+//Life patterns as Golly writes them, in RLE: comment lines starting with
+//#, a header "x = 36, y = 9, rule = B3/S23", then runs such as "24bo$22bobo$"
+//up to a '!'. A pack of them sits in its own flash partition, which is
+//mapped into the address space and read where it lies; drawing a pattern
+//decodes its runs straight into a page format framebuffer.
+//
+//A pack is a pattern_pack_header_t, count pattern_pack_entry_t and the RLE
+//files as they are, all little endian. host/pattern_pack.c writes them.
+
+#define PATTERN_PARTITION "patterns"
+#define PATTERN_PARTITION_SUBTYPE 0x40
+#define PATTERN_PACK_MAGIC 0x31544150      //"PAT1"
+#define PATTERN_NAME_LEN 28
+
+typedef struct {
+    uint32_t magic;
+    uint32_t size;                           //Of the whole pack
+    uint32_t count;
+    uint32_t reserved;
+} pattern_pack_header_t;
+
+typedef struct {
+    char name[PATTERN_NAME_LEN];             //NUL terminated
+    uint32_t offset;                         //Of the RLE file, from the start of the pack
+    uint32_t length;
+} pattern_pack_entry_t;
+
+typedef struct {
+    const uint8_t *base;
+    uint32_t size;
+    uint32_t count;
+    const pattern_pack_entry_t *entries;
+    spi_flash_mmap_handle_t handle;
+    bool mapped;                             //By pattern_pack_open, to be unmapped
+} pattern_pack_t;
+
+typedef struct {
+    const char *name;
+    const char *rle;                         //The whole file, not NUL terminated
+    uint32_t length;
+    const char *runs;                        //Just after the header line
+    uint32_t width;
+    uint32_t height;
+} pattern_t;
+
+//Clockwise
+typedef enum {
+    PATTERN_ROT_0,
+    PATTERN_ROT_90,
+    PATTERN_ROT_180,
+    PATTERN_ROT_270
+} pattern_rotation_t;
+
+//Map the pack in the patterns partition. False if there is none or it is
+//not a pack.
+bool pattern_pack_open(pattern_pack_t *pack);
+//Use a pack already in memory, size bytes from base
+bool pattern_pack_init(pattern_pack_t *pack, const void *base, uint32_t size);
+void pattern_pack_close(pattern_pack_t *pack);
+bool pattern_get(const pattern_pack_t *pack, uint32_t i, pattern_t *p);
+//Index of the pattern called name, -1 if there is none
+int pattern_find(const pattern_pack_t *pack, const char *name);
+
+//Read the header of an RLE file of length bytes, name being kept as it is.
+//False without an "x = ..., y = ..." line.
+bool pattern_parse(pattern_t *p, const char *name, const char *rle, uint32_t length);
+//Set the pattern's live cells with the top left of its rotated bounding box
+//at x, y. It wraps around the edges, like the Life field. Cells already on
+//stay on. If tiles is not NULL the tiles drawn in are marked there.
+//Returns the number of live cells in the pattern.
+uint32_t pattern_draw(const pattern_t *p, uint8_t *lines, int x, int y, pattern_rotation_t rotation,
+        scrn_tiles_t *tiles);
+
+//Size of the bounding box once rotated
+static inline uint32_t pattern_width(const pattern_t *p, pattern_rotation_t rotation) {
+    return rotation&1 ? p->height : p->width;
+}
+static inline uint32_t pattern_height(const pattern_t *p, pattern_rotation_t rotation) {
+    return rotation&1 ? p->width : p->height;
+}
+
+#endif
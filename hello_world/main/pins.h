@@ -0,0 +1,19 @@
+#ifndef PINS_H
+#define PINS_H
+
+#define MOSI_PIN 13
+#define CLK_PIN 14
+#define RST_PIN 23
+#define CS_PIN 15
+//The other panels of a wall
+#define CS1_PIN 21
+#define CS2_PIN 25
+#define DC_PIN 22
+#define U_PIN 16
+#define L_PIN 17
+#define D_PIN 18
+#define R_PIN 19
+#define C_PIN 5
+#define MODE_PIN 2
+
+#endif
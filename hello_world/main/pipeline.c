@@ -0,0 +1,158 @@
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "pipeline.h"
+
+//Ownership of the buffers moves around through the two queues only.
+//pipeline_take keeps the frame it took last and gives it back when a newer
+//one arrives, so the simulation's newest frame (which it reads to compute
+//the next one) is never handed back for overwriting.
+
+//Parked until wake is given, then frames until pipeline_stop gives it again,
+//which ends the wait between frames at once; the buffer index stop puts in
+//free_q ends a wait for a free buffer.
+static void pipeline_sim_task(void *arg)
+{
+    pipeline_t *p=arg;
+    while (xSemaphoreTake(p->wake, portMAX_DELAY)==pdTRUE && !p->quit) {
+        uint8_t prev=0, next;
+        TickType_t due=xTaskGetTickCount();
+        while (xQueueReceive(p->free_q, &next, portMAX_DELAY)==pdTRUE && next!=PIPELINE_BUFFERS) {
+            p->produce(p->ctx, p->frames[prev], p->frames[next]);
+            p->done_at[next]=esp_timer_get_time();
+            xQueueSend(p->ready_q, &next, portMAX_DELAY);
+            prev=next;
+            TickType_t wait=0;
+            if (p->period_ms) {
+                due+=p->period_ms/portTICK_RATE_MS;
+                int32_t left=due-xTaskGetTickCount();
+                if (left>0) wait=left;
+            }
+            if (xSemaphoreTake(p->wake, wait)==pdTRUE) break;
+        }
+        //Stopped through free_q, the wake given with it is still there
+        xSemaphoreTake(p->wake, 0);
+        xSemaphoreGive(p->parked);
+    }
+    xSemaphoreGive(p->parked);
+    vTaskDelete(NULL);
+}
+
+bool pipeline_init(pipeline_t *p, pipeline_produce_fn produce, void *ctx, uint32_t period_ms)
+{
+    memset(p, 0, sizeof(*p));
+    p->produce=produce;
+    p->ctx=ctx;
+    p->period_ms=period_ms;
+    p->held=PIPELINE_BUFFERS;
+    for (int i=0;i<PIPELINE_BUFFERS;i++) {
+        p->frames[i]=heap_caps_malloc(SCRN_BUF_SIZE, MALLOC_CAP_DMA);
+        if (p->frames[i]==NULL) {
+            pipeline_free(p);
+            return false;
+        }
+        memset(p->frames[i], 0, SCRN_BUF_SIZE);
+    }
+    p->free_q=xQueueCreate(PIPELINE_BUFFERS+1, sizeof(uint8_t));
+    p->ready_q=xQueueCreate(PIPELINE_BUFFERS, sizeof(uint8_t));
+    p->wake=xSemaphoreCreateBinary();
+    p->parked=xSemaphoreCreateBinary();
+    if (p->free_q==NULL || p->ready_q==NULL || p->wake==NULL || p->parked==NULL
+            || xTaskCreatePinnedToCore(pipeline_sim_task, "sim", PIPELINE_STACK_SIZE, p, 5, &p->task,
+            PIPELINE_SIM_CORE)!=pdPASS) {
+        p->task=NULL;
+        pipeline_free(p);
+        return false;
+    }
+    return true;
+}
+
+uint8_t *pipeline_first_frame(pipeline_t *p)
+{
+    return p->frames[0];
+}
+
+void pipeline_start(pipeline_t *p)
+{
+    uint8_t first=0;
+    xQueueReset(p->free_q);
+    xQueueReset(p->ready_q);
+    for (uint8_t i=1;i<PIPELINE_BUFFERS;i++) {
+        xQueueSend(p->free_q, &i, 0);
+    }
+    //The seed frame is taken as it is
+    p->done_at[first]=esp_timer_get_time();
+    xQueueSend(p->ready_q, &first, 0);
+    p->held=PIPELINE_BUFFERS;
+    p->frames_shown=0;
+    p->latency_frames=0;
+    p->latency_sum=0;
+    p->latency_max=0;
+    p->running=true;
+    xSemaphoreGive(p->wake);
+}
+
+const uint8_t *pipeline_take(pipeline_t *p, uint32_t *taken)
+{
+    uint8_t ready;
+    *taken=0;
+    while (xQueueReceive(p->ready_q, &ready, 0)==pdTRUE) {
+        //The one held before, or one overtaken before it was shown
+        if (p->held!=PIPELINE_BUFFERS) {
+            xQueueSend(p->free_q, &p->held, portMAX_DELAY);
+        }
+        p->held=ready;
+        p->held_shown=false;
+        (*taken)++;
+    }
+    return p->held==PIPELINE_BUFFERS ? NULL : p->frames[p->held];
+}
+
+void pipeline_shown(pipeline_t *p, int64_t since)
+{
+    if (p->held==PIPELINE_BUFFERS || p->held_shown) return;
+    p->held_shown=true;
+    p->frames_shown++;
+    if (p->done_at[p->held]<since) return;
+    int64_t latency=esp_timer_get_time()-p->done_at[p->held];
+    p->latency_sum+=latency;
+    p->latency_frames++;
+    if (latency>p->latency_max) p->latency_max=latency;
+}
+
+void pipeline_stop(pipeline_t *p)
+{
+    uint8_t stop=PIPELINE_BUFFERS;
+    if (!p->running) return;
+    p->running=false;
+    xSemaphoreGive(p->wake);
+    xQueueSend(p->free_q, &stop, 0);
+    xSemaphoreTake(p->parked, portMAX_DELAY);
+}
+
+void pipeline_get_stats(pipeline_t *p, pipeline_stats_t *stats)
+{
+    stats->frames=p->frames_shown;
+    stats->latency_avg_us=p->latency_frames ? p->latency_sum/p->latency_frames : 0;
+    stats->latency_max_us=p->latency_max;
+}
+
+void pipeline_free(pipeline_t *p)
+{
+    if (p->task) {
+        p->quit=true;
+        xSemaphoreGive(p->wake);
+        xSemaphoreTake(p->parked, portMAX_DELAY);
+    }
+    if (p->wake) vSemaphoreDelete(p->wake);
+    if (p->parked) vSemaphoreDelete(p->parked);
+    if (p->free_q) vQueueDelete(p->free_q);
+    if (p->ready_q) vQueueDelete(p->ready_q);
+    for (int i=0;i<PIPELINE_BUFFERS;i++) {
+        heap_caps_free(p->frames[i]);
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "framebuffer.h"
+
+//Frames computed by a task on the other core, for whoever shows them to take.
+//Everything is allocated and the task created by pipeline_init; the task
+//then parks between pipeline_stop and the next pipeline_start, so a
+//pipeline can be run over and over without touching the heap.
+
+//One buffer on the glass, one holding the newest frame, one being computed
+#define PIPELINE_BUFFERS 3
+#define PIPELINE_SIM_CORE 1          //APP_CPU, the runner flushes from PRO_CPU
+#define PIPELINE_STACK_SIZE 4096
+
+//Compute the frame following prev into next
+typedef void (*pipeline_produce_fn)(void *ctx, const uint8_t *prev, uint8_t *next);
+
+typedef struct {
+    uint32_t frames;                 //Frames shown
+    int64_t latency_avg_us;          //From end of compute to end of the flush showing it
+    int64_t latency_max_us;
+} pipeline_stats_t;
+
+typedef struct {
+    uint8_t *frames[PIPELINE_BUFFERS];
+    int64_t done_at[PIPELINE_BUFFERS];   //When each frame finished computing
+    QueueHandle_t free_q;                //Buffers the simulation may overwrite, and room for stop's
+    QueueHandle_t ready_q;               //Finished frames waiting to be taken
+    pipeline_produce_fn produce;
+    void *ctx;
+    uint32_t period_ms;                  //Minimum time between frames, 0 to run flat out
+    SemaphoreHandle_t wake;              //Starts the parked task, or cuts its wait short to park it
+    SemaphoreHandle_t parked;            //The task has parked, or ended
+    TaskHandle_t task;
+    volatile bool quit;                  //Ends the task instead of starting it
+    bool running;                        //Between start and stop
+    uint8_t held;                        //Frame taken last, PIPELINE_BUFFERS for none
+    bool held_shown;                     //pipeline_shown has counted it
+    uint32_t frames_shown;
+    uint32_t latency_frames;
+    int64_t latency_sum;
+    int64_t latency_max;
+} pipeline_t;
+
+//Allocates the frame ring in DMA capable memory. Frame 0 is taken first and
+//seeds the simulation, fill it in before pipeline_start. False if there is
+//not enough memory, with nothing left allocated.
+bool pipeline_init(pipeline_t *p, pipeline_produce_fn produce, void *ctx, uint32_t period_ms);
+uint8_t *pipeline_first_frame(pipeline_t *p);
+//Run from frame 0, with the stats from zero
+void pipeline_start(pipeline_t *p);
+//The newest finished frame, which stays as it is until the next take. The
+//ones before it go back to the simulation; *taken says how many came in
+//since the last take. NULL before the first.
+const uint8_t *pipeline_take(pipeline_t *p, uint32_t *taken);
+//The frame taken last is on the glass now, for the stats. One finished
+//before since waited for whoever shows it to come back, it counts as shown
+//but not in the latency.
+void pipeline_shown(pipeline_t *p, int64_t since);
+//Park the simulation task and wait until it has, which is as soon as it is
+//done with the frame it is computing, if any
+void pipeline_stop(pipeline_t *p);
+void pipeline_get_stats(pipeline_t *p, pipeline_stats_t *stats);
+//End the task and free it all, after pipeline_stop
+void pipeline_free(pipeline_t *p);
+
+#endif
@@ -0,0 +1,232 @@
+#include <stdio.h>
+#include <string.h>
+#include "esp_timer.h"
+#include "stream.h"
+
+//Bytes the UART driver holds while a packet is being decoded and flushed
+#define STREAM_UART_RX_BUF 4096
+#define STREAM_REPORT_US 10000000
+
+//CRC-16/CCITT a nibble at a time
+static const uint16_t stream_crc_table[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+uint16_t stream_crc16(uint16_t crc, const uint8_t *data, int len) {
+    for (int i=0;i<len;i++) {
+        crc = (crc<<4)^stream_crc_table[(crc>>12)^(data[i]>>4)];
+        crc = (crc<<4)^stream_crc_table[(crc>>12)^(data[i]&0x0F)];
+    }
+    return crc;
+}
+
+static inline uint8_t stream_delta(const uint8_t *base, const uint8_t *frame, int i) {
+    return base ? base[i]^frame[i] : frame[i];
+}
+
+//Bytes from i on whose delta is d, up to max
+static int stream_run(const uint8_t *base, const uint8_t *frame, int i, uint8_t d, int max) {
+    int j = i;
+    while (j<SCRN_BUF_SIZE && j-i<max && stream_delta(base, frame, j)==d) j++;
+    return j-i;
+}
+
+int stream_encode(const uint8_t *base, const uint8_t *frame, uint8_t *out) {
+    int n = 0, i = 0;
+    while (i<SCRN_BUF_SIZE) {
+        uint8_t d = stream_delta(base, frame, i);
+        int run = stream_run(base, frame, i, d, d ? 66 : 128);
+        if (d==0) {
+            out[n++] = run-1;
+            i += run;
+        } else if (run>=3) {
+            out[n++] = 0xBD+run;
+            out[n++] = d;
+            i += run;
+        } else {
+            //Literals until two unchanged bytes or three the same, which code shorter
+            int start = i, control = n++;
+            while (i<SCRN_BUF_SIZE && i-start<64) {
+                uint8_t e = stream_delta(base, frame, i);
+                if (stream_run(base, frame, i, e, 3)>=(e ? 3 : 2)) break;
+                out[n++] = e;
+                i++;
+            }
+            out[control] = 0x7F+(i-start);
+        }
+    }
+    return n;
+}
+
+bool stream_decode(const uint8_t *base, const uint8_t *payload, int len, uint8_t *frame) {
+    const uint8_t *end = payload+len;
+    int i = 0;
+    while (payload<end) {
+        uint8_t c = *payload++;
+        int n;
+        if (c<0x80) {
+            n = c+1;
+            if (n>SCRN_BUF_SIZE-i) return false;
+            if (base==NULL) {
+                memset(frame+i, 0, n);
+            } else if (frame!=base) {
+                memcpy(frame+i, base+i, n);
+            }
+        } else if (c<0xC0) {
+            n = c-0x7F;
+            if (n>SCRN_BUF_SIZE-i || n>end-payload) return false;
+            for (int j=0;j<n;j++) frame[i+j] = (base ? base[i+j] : 0)^payload[j];
+            payload += n;
+        } else {
+            n = c-0xBD;
+            if (n>SCRN_BUF_SIZE-i || payload==end) return false;
+            uint8_t d = *payload++;
+            for (int j=0;j<n;j++) frame[i+j] = (base ? base[i+j] : 0)^d;
+        }
+        i += n;
+    }
+    return i==SCRN_BUF_SIZE;
+}
+
+int stream_packet(uint8_t *out, uint8_t flags, uint8_t seq, const uint8_t *payload, int len) {
+    out[0] = STREAM_SYNC0;
+    out[1] = STREAM_SYNC1;
+    out[2] = flags;
+    out[3] = seq;
+    out[4] = len&0xFF;
+    out[5] = len>>8;
+    out[6] = stream_crc16(0xFFFF, out+2, 4)&0xFF;
+    memcpy(out+STREAM_HEADER_LEN, payload, len);
+    uint16_t crc = stream_crc16(0xFFFF, out+2, STREAM_HEADER_LEN-2+len);
+    out[STREAM_HEADER_LEN+len] = crc&0xFF;
+    out[STREAM_HEADER_LEN+len+1] = crc>>8;
+    return STREAM_HEADER_LEN+len+2;
+}
+
+void stream_rx_init(stream_rx_t *rx, uint8_t *lines[2], scrn_flush_t *flush) {
+    memset(rx, 0, sizeof(*rx));
+    rx->lines[0] = lines[0];
+    rx->lines[1] = lines[1];
+    rx->shown = -1;
+    rx->flush = flush;
+    rx->report_at = esp_timer_get_time();
+}
+
+//Throw away the packet's bytes up to the next possible sync at or after from
+static void stream_rx_resync(stream_rx_t *rx, int from) {
+    int i = from;
+    while (i<rx->len && rx->packet[i]!=STREAM_SYNC0) i++;
+    memmove(rx->packet, rx->packet+i, rx->len-i);
+    rx->len -= i;
+    rx->skipped += i;
+}
+
+static void stream_rx_frame(stream_rx_t *rx, uint8_t flags, uint8_t seq, const uint8_t *payload, int len) {
+    bool key = flags&STREAM_KEY;
+    if (!key && (rx->shown<0 || seq!=(uint8_t) (rx->seq+1))) {
+        rx->stale++;
+        return;
+    }
+    //The other buffer is free: flushing the one shown waited for it
+    int next = rx->shown<0 ? 0 : !rx->shown;
+    uint8_t *frame = rx->lines[next];
+    if (!stream_decode(key ? NULL : rx->lines[rx->shown], payload, len, frame)) {
+        rx->bad++;
+        return;
+    }
+    rx->shown = next;
+    rx->seq = seq;
+    rx->frames++;
+    if (key) rx->keys++;
+    if (rx->on_frame) rx->on_frame(rx->on_frame_arg, frame, seq);
+    if (rx->flush) scrn_flush_async(rx->flush, frame);
+}
+
+//Deal with every whole packet at the start of the buffer. What is left is a
+//packet still coming in, whose header checks out if it is all there.
+static void stream_rx_parse(stream_rx_t *rx) {
+    uint8_t *p = rx->packet;
+    while (rx->len>0) {
+        if (p[0]!=STREAM_SYNC0 || (rx->len>1 && p[1]!=STREAM_SYNC1)) {
+            stream_rx_resync(rx, 1);
+            continue;
+        }
+        if (rx->len<STREAM_HEADER_LEN) return;
+        int len = p[4]|p[5]<<8;
+        if ((stream_crc16(0xFFFF, p+2, 4)&0xFF)!=p[6] || len>STREAM_MAX_PAYLOAD) {
+            rx->bad++;
+            stream_rx_resync(rx, 1);
+            continue;
+        }
+        int size = STREAM_HEADER_LEN+len+2;
+        if (rx->len<size) return;
+        if (stream_crc16(0xFFFF, p+2, size-4)!=(p[size-2]|p[size-1]<<8)) {
+            rx->bad++;
+            stream_rx_resync(rx, 1);
+            continue;
+        }
+        stream_rx_frame(rx, p[2], p[3], p+STREAM_HEADER_LEN, len);
+        memmove(p, p+size, rx->len-size);
+        rx->len -= size;
+    }
+}
+
+void stream_rx_feed(stream_rx_t *rx, const uint8_t *data, int len) {
+    rx->bytes += len;
+    while (len>0) {
+        //Up to the end of the header, or of the packet once the header is in
+        int size = rx->len<STREAM_HEADER_LEN ? STREAM_HEADER_LEN
+                : STREAM_HEADER_LEN+(rx->packet[4]|rx->packet[5]<<8)+2;
+        int n = size-rx->len<len ? size-rx->len : len;
+        memcpy(rx->packet+rx->len, data, n);
+        rx->len += n;
+        data += n;
+        len -= n;
+        stream_rx_parse(rx);
+    }
+}
+
+esp_err_t stream_open(uart_port_t uart) {
+    esp_err_t ret = uart_driver_install(uart, STREAM_UART_RX_BUF, 0, 0, NULL, 0);
+    if (ret != ESP_OK) return ret;
+    ret = uart_set_baudrate(uart, STREAM_BAUD);
+    if (ret != ESP_OK) uart_driver_delete(uart);
+    return ret;
+}
+
+int stream_poll(stream_rx_t *rx, uart_port_t uart, TickType_t wait) {
+    static uint8_t buf[256];
+    int taken = 0, n;
+    do {
+        //Whatever is there, or wait for the next byte
+        size_t ready = 0;
+        uart_get_buffered_data_len(uart, &ready);
+        if (ready>sizeof(buf)) ready = sizeof(buf);
+        n = uart_read_bytes(uart, buf, ready ? ready : 1, ready ? 0 : wait);
+        if (n>0) {
+            stream_rx_feed(rx, buf, n);
+            taken += n;
+        }
+        wait = 0;
+    } while (n>0 && taken<STREAM_UART_RX_BUF);
+
+    int64_t now = esp_timer_get_time();
+    if (now-rx->report_at>=STREAM_REPORT_US) {
+        float s = (now-rx->report_at)/1e6f;
+        printf("stream: %.1f frames/s, %.0f bytes/s, %u key frames, %u bad, %u stale, %u bytes skipped\n",
+                (rx->frames-rx->report_frames)/s, (rx->bytes-rx->report_bytes)/s, (unsigned) rx->keys,
+                (unsigned) rx->bad, (unsigned) rx->stale, (unsigned) rx->skipped);
+        rx->report_at = now;
+        rx->report_frames = rx->frames;
+        rx->report_bytes = rx->bytes;
+    }
+    return taken;
+}
+
+void stream_receive(stream_rx_t *rx, uart_port_t uart) {
+    ESP_ERROR_CHECK(stream_open(uart));
+    while (1) {
+        stream_poll(rx, uart, 20/portTICK_RATE_MS);
+    }
+}
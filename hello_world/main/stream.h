@@ -0,0 +1,87 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "driver/uart.h"
+#include "display.h"
+#include "framebuffer.h"
+
+//Frames made elsewhere, sent over the console UART and shown as they come.
+//
+//A frame goes as a packet:
+//  0xA5 0x5A                 sync
+//  flags, seq, length (16 bit little endian)
+//  check                     low byte of the CRC of the four bytes above
+//  payload                   length bytes
+//  crc                       CRC-16/CCITT of flags to the end of the payload,
+//                            little endian
+//The payload is the XOR of the frame with the one before it (seq-1), or with
+//a blank frame for a key frame, run length coded as control bytes:
+//  0x00-0x7F                 the next c+1 bytes are unchanged
+//  0x80-0xBF                 c-0x7F literal bytes follow, to XOR in
+//  0xC0-0xFF                 one byte follows, to XOR into the next c-0xBD bytes
+//
+//A packet that does not check out is dropped, and the receiver looks for the
+//next sync in the bytes after the one it started at, so a lost byte costs at
+//most the packet it was in and the next one. Once a frame is lost the deltas
+//that follow have nothing to apply to; they are dropped until a key frame,
+//which the sender puts in every so often.
+
+#define STREAM_SYNC0 0xA5
+#define STREAM_SYNC1 0x5A
+#define STREAM_KEY 0x01                      //flags: against a blank frame
+#define STREAM_HEADER_LEN 7
+//All literals, the longest a frame can code to
+#define STREAM_MAX_PAYLOAD (SCRN_BUF_SIZE+SCRN_BUF_SIZE/64)
+#define STREAM_MAX_PACKET (STREAM_HEADER_LEN+STREAM_MAX_PAYLOAD+2)
+//Same as idf_monitor, so the console keeps working
+#define STREAM_BAUD CONFIG_MONITOR_BAUD
+#define STREAM_UART CONFIG_CONSOLE_UART_NUM
+
+uint16_t stream_crc16(uint16_t crc, const uint8_t *data, int len);
+//Code frame against base (NULL for a blank frame) into out, which has room
+//for STREAM_MAX_PAYLOAD bytes. Returns the length.
+int stream_encode(const uint8_t *base, const uint8_t *frame, uint8_t *out);
+//Undo stream_encode into frame, from base (NULL for a blank frame). frame
+//may be base. False, with frame partly written, unless the payload codes
+//exactly one frame.
+bool stream_decode(const uint8_t *base, const uint8_t *payload, int len, uint8_t *frame);
+//Put a packet around a payload, into out with room for STREAM_MAX_PACKET.
+//Returns the length.
+int stream_packet(uint8_t *out, uint8_t flags, uint8_t seq, const uint8_t *payload, int len);
+
+typedef struct {
+    uint8_t *lines[2];                       //DMA capable: the one shown and the next
+    int shown;                               //Into lines, -1 before the first key frame
+    uint8_t seq;                             //Of the one shown
+    uint8_t packet[STREAM_MAX_PACKET];       //Bytes of the packet coming in
+    int len;
+    scrn_flush_t *flush;                     //NULL to only decode
+    //Called with each frame decoded, before it is flushed, may be NULL
+    void (*on_frame)(void *arg, const uint8_t *frame, uint8_t seq);
+    void *on_frame_arg;
+    uint32_t frames;                         //Shown
+    uint32_t keys;                           //Of which key frames
+    uint32_t bad;                            //Packets that did not check out
+    uint32_t stale;                          //Deltas dropped for want of the frame before
+    uint32_t skipped;                        //Bytes thrown away looking for a sync
+    uint64_t bytes;                          //Taken in
+    int64_t report_at;                       //Of the last progress line stream_poll printed
+    uint32_t report_frames;
+    uint64_t report_bytes;
+} stream_rx_t;
+
+//lines are two DMA capable buffers of SCRN_BUF_SIZE
+void stream_rx_init(stream_rx_t *rx, uint8_t *lines[2], scrn_flush_t *flush);
+//Take in bytes as they come, showing any frame they complete
+void stream_rx_feed(stream_rx_t *rx, const uint8_t *data, int len);
+//Install the UART driver at STREAM_BAUD, uart_driver_delete undoes it
+esp_err_t stream_open(uart_port_t uart);
+//Feed what the UART has, waiting up to wait for the first byte if it has
+//none, and print how it is going every so often. Returns the bytes taken.
+int stream_poll(stream_rx_t *rx, uart_port_t uart, TickType_t wait);
+//stream_open, then feed whatever arrives, for ever
+void stream_receive(stream_rx_t *rx, uart_port_t uart);
+
+#endif
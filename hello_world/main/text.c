@@ -0,0 +1,226 @@
+#include <stdio.h>
+#include <stdarg.h>
+#include "text.h"
+
+//The font is written the way font8x8_basic has it, one byte per row with
+//bit 0 the leftmost pixel, and GLYPH turns the rows into column bytes while
+//compiling.
+#define GLYPH_COL(r0, r1, r2, r3, r4, r5, r6, r7, c) \
+    ((((r0)>>(c))&1) | ((((r1)>>(c))&1)<<1) | ((((r2)>>(c))&1)<<2) | ((((r3)>>(c))&1)<<3) | \
+    ((((r4)>>(c))&1)<<4) | ((((r5)>>(c))&1)<<5) | ((((r6)>>(c))&1)<<6) | ((((r7)>>(c))&1)<<7))
+#define GLYPH(...) { \
+    GLYPH_COL(__VA_ARGS__, 0), GLYPH_COL(__VA_ARGS__, 1), GLYPH_COL(__VA_ARGS__, 2), GLYPH_COL(__VA_ARGS__, 3), \
+    GLYPH_COL(__VA_ARGS__, 4), GLYPH_COL(__VA_ARGS__, 5), GLYPH_COL(__VA_ARGS__, 6), GLYPH_COL(__VA_ARGS__, 7)}
+
+const uint8_t text_font[128][TEXT_GLYPH_W] = {
+    GLYPH(0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00),   // U+0000 (nul)
+    GLYPH(0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00),   // U+0001
+    GLYPH(0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00),   // U+0002
+    GLYPH(0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00),   // U+0003
+    GLYPH(0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00),   // U+0004
+    GLYPH(0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00),   // U+0005
+    GLYPH(0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00),   // U+0006
+    GLYPH(0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00),   // U+0007
+    GLYPH(0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00),   // U+0008
+    GLYPH(0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00),   // U+0009
+    GLYPH(0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00),   // U+000A
+    GLYPH(0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00),   // U+000B
+    GLYPH(0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00),   // U+000C
+    GLYPH(0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00),   // U+000D
+    GLYPH(0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00),   // U+000E
+    GLYPH(0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00),   // U+000F
+    GLYPH(0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00),   // U+0010
+    GLYPH(0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00),   // U+0011
+    GLYPH(0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00),   // U+0012
+    GLYPH(0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00),   // U+0013
+    GLYPH(0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00),   // U+0014
+    GLYPH(0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00),   // U+0015
+    GLYPH(0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00),   // U+0016
+    GLYPH(0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00),   // U+0017
+    GLYPH(0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00),   // U+0018
+    GLYPH(0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00),   // U+0019
+    GLYPH(0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00),   // U+001A
+    GLYPH(0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00),   // U+001B
+    GLYPH(0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00),   // U+001C
+    GLYPH(0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00),   // U+001D
+    GLYPH(0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00),   // U+001E
+    GLYPH(0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00),   // U+001F
+    GLYPH(0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00),   // U+0020 (space)
+    GLYPH(0x18, 0x3C, 0x3C, 0x18, 0x18, 0x00, 0x18, 0x00),   // U+0021 (!)
+    GLYPH(0x36, 0x36, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00),   // U+0022 (")
+    GLYPH(0x36, 0x36, 0x7F, 0x36, 0x7F, 0x36, 0x36, 0x00),   // U+0023 (#)
+    GLYPH(0x0C, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x0C, 0x00),   // U+0024 ($)
+    GLYPH(0x00, 0x63, 0x33, 0x18, 0x0C, 0x66, 0x63, 0x00),   // U+0025 (%)
+    GLYPH(0x1C, 0x36, 0x1C, 0x6E, 0x3B, 0x33, 0x6E, 0x00),   // U+0026 (&)
+    GLYPH(0x06, 0x06, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00),   // U+0027 (')
+    GLYPH(0x18, 0x0C, 0x06, 0x06, 0x06, 0x0C, 0x18, 0x00),   // U+0028 (()
+    GLYPH(0x06, 0x0C, 0x18, 0x18, 0x18, 0x0C, 0x06, 0x00),   // U+0029 ())
+    GLYPH(0x00, 0x66, 0x3C, 0xFF, 0x3C, 0x66, 0x00, 0x00),   // U+002A (*)
+    GLYPH(0x00, 0x0C, 0x0C, 0x3F, 0x0C, 0x0C, 0x00, 0x00),   // U+002B (+)
+    GLYPH(0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x06),   // U+002C (,)
+    GLYPH(0x00, 0x00, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00),   // U+002D (-)
+    GLYPH(0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x00),   // U+002E (.)
+    GLYPH(0x60, 0x30, 0x18, 0x0C, 0x06, 0x03, 0x01, 0x00),   // U+002F (/)
+    GLYPH(0x3E, 0x63, 0x73, 0x7B, 0x6F, 0x67, 0x3E, 0x00),   // U+0030 (0)
+    GLYPH(0x0C, 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x3F, 0x00),   // U+0031 (1)
+    GLYPH(0x1E, 0x33, 0x30, 0x1C, 0x06, 0x33, 0x3F, 0x00),   // U+0032 (2)
+    GLYPH(0x1E, 0x33, 0x30, 0x1C, 0x30, 0x33, 0x1E, 0x00),   // U+0033 (3)
+    GLYPH(0x38, 0x3C, 0x36, 0x33, 0x7F, 0x30, 0x78, 0x00),   // U+0034 (4)
+    GLYPH(0x3F, 0x03, 0x1F, 0x30, 0x30, 0x33, 0x1E, 0x00),   // U+0035 (5)
+    GLYPH(0x1C, 0x06, 0x03, 0x1F, 0x33, 0x33, 0x1E, 0x00),   // U+0036 (6)
+    GLYPH(0x3F, 0x33, 0x30, 0x18, 0x0C, 0x0C, 0x0C, 0x00),   // U+0037 (7)
+    GLYPH(0x1E, 0x33, 0x33, 0x1E, 0x33, 0x33, 0x1E, 0x00),   // U+0038 (8)
+    GLYPH(0x1E, 0x33, 0x33, 0x3E, 0x30, 0x18, 0x0E, 0x00),   // U+0039 (9)
+    GLYPH(0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x00),   // U+003A (:)
+    GLYPH(0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x06),   // U+003B (//)
+    GLYPH(0x18, 0x0C, 0x06, 0x03, 0x06, 0x0C, 0x18, 0x00),   // U+003C (<)
+    GLYPH(0x00, 0x00, 0x3F, 0x00, 0x00, 0x3F, 0x00, 0x00),   // U+003D (=)
+    GLYPH(0x06, 0x0C, 0x18, 0x30, 0x18, 0x0C, 0x06, 0x00),   // U+003E (>)
+    GLYPH(0x1E, 0x33, 0x30, 0x18, 0x0C, 0x00, 0x0C, 0x00),   // U+003F (?)
+    GLYPH(0x3E, 0x63, 0x7B, 0x7B, 0x7B, 0x03, 0x1E, 0x00),   // U+0040 (@)
+    GLYPH(0x0C, 0x1E, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x00),   // U+0041 (A)
+    GLYPH(0x3F, 0x66, 0x66, 0x3E, 0x66, 0x66, 0x3F, 0x00),   // U+0042 (B)
+    GLYPH(0x3C, 0x66, 0x03, 0x03, 0x03, 0x66, 0x3C, 0x00),   // U+0043 (C)
+    GLYPH(0x1F, 0x36, 0x66, 0x66, 0x66, 0x36, 0x1F, 0x00),   // U+0044 (D)
+    GLYPH(0x7F, 0x46, 0x16, 0x1E, 0x16, 0x46, 0x7F, 0x00),   // U+0045 (E)
+    GLYPH(0x7F, 0x46, 0x16, 0x1E, 0x16, 0x06, 0x0F, 0x00),   // U+0046 (F)
+    GLYPH(0x3C, 0x66, 0x03, 0x03, 0x73, 0x66, 0x7C, 0x00),   // U+0047 (G)
+    GLYPH(0x33, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x33, 0x00),   // U+0048 (H)
+    GLYPH(0x1E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00),   // U+0049 (I)
+    GLYPH(0x78, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E, 0x00),   // U+004A (J)
+    GLYPH(0x67, 0x66, 0x36, 0x1E, 0x36, 0x66, 0x67, 0x00),   // U+004B (K)
+    GLYPH(0x0F, 0x06, 0x06, 0x06, 0x46, 0x66, 0x7F, 0x00),   // U+004C (L)
+    GLYPH(0x63, 0x77, 0x7F, 0x7F, 0x6B, 0x63, 0x63, 0x00),   // U+004D (M)
+    GLYPH(0x63, 0x67, 0x6F, 0x7B, 0x73, 0x63, 0x63, 0x00),   // U+004E (N)
+    GLYPH(0x1C, 0x36, 0x63, 0x63, 0x63, 0x36, 0x1C, 0x00),   // U+004F (O)
+    GLYPH(0x3F, 0x66, 0x66, 0x3E, 0x06, 0x06, 0x0F, 0x00),   // U+0050 (P)
+    GLYPH(0x1E, 0x33, 0x33, 0x33, 0x3B, 0x1E, 0x38, 0x00),   // U+0051 (Q)
+    GLYPH(0x3F, 0x66, 0x66, 0x3E, 0x36, 0x66, 0x67, 0x00),   // U+0052 (R)
+    GLYPH(0x1E, 0x33, 0x07, 0x0E, 0x38, 0x33, 0x1E, 0x00),   // U+0053 (S)
+    GLYPH(0x3F, 0x2D, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00),   // U+0054 (T)
+    GLYPH(0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x3F, 0x00),   // U+0055 (U)
+    GLYPH(0x33, 0x33, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00),   // U+0056 (V)
+    GLYPH(0x63, 0x63, 0x63, 0x6B, 0x7F, 0x77, 0x63, 0x00),   // U+0057 (W)
+    GLYPH(0x63, 0x63, 0x36, 0x1C, 0x1C, 0x36, 0x63, 0x00),   // U+0058 (X)
+    GLYPH(0x33, 0x33, 0x33, 0x1E, 0x0C, 0x0C, 0x1E, 0x00),   // U+0059 (Y)
+    GLYPH(0x7F, 0x63, 0x31, 0x18, 0x4C, 0x66, 0x7F, 0x00),   // U+005A (Z)
+    GLYPH(0x1E, 0x06, 0x06, 0x06, 0x06, 0x06, 0x1E, 0x00),   // U+005B ([)
+    GLYPH(0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x40, 0x00),   // U+005C (\)
+    GLYPH(0x1E, 0x18, 0x18, 0x18, 0x18, 0x18, 0x1E, 0x00),   // U+005D (])
+    GLYPH(0x08, 0x1C, 0x36, 0x63, 0x00, 0x00, 0x00, 0x00),   // U+005E (^)
+    GLYPH(0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF),   // U+005F (_)
+    GLYPH(0x0C, 0x0C, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00),   // U+0060 (`)
+    GLYPH(0x00, 0x00, 0x1E, 0x30, 0x3E, 0x33, 0x6E, 0x00),   // U+0061 (a)
+    GLYPH(0x07, 0x06, 0x06, 0x3E, 0x66, 0x66, 0x3B, 0x00),   // U+0062 (b)
+    GLYPH(0x00, 0x00, 0x1E, 0x33, 0x03, 0x33, 0x1E, 0x00),   // U+0063 (c)
+    GLYPH(0x38, 0x30, 0x30, 0x3e, 0x33, 0x33, 0x6E, 0x00),   // U+0064 (d)
+    GLYPH(0x00, 0x00, 0x1E, 0x33, 0x3f, 0x03, 0x1E, 0x00),   // U+0065 (e)
+    GLYPH(0x1C, 0x36, 0x06, 0x0f, 0x06, 0x06, 0x0F, 0x00),   // U+0066 (f)
+    GLYPH(0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x1F),   // U+0067 (g)
+    GLYPH(0x07, 0x06, 0x36, 0x6E, 0x66, 0x66, 0x67, 0x00),   // U+0068 (h)
+    GLYPH(0x0C, 0x00, 0x0E, 0x0C, 0x0C, 0x0C, 0x1E, 0x00),   // U+0069 (i)
+    GLYPH(0x30, 0x00, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E),   // U+006A (j)
+    GLYPH(0x07, 0x06, 0x66, 0x36, 0x1E, 0x36, 0x67, 0x00),   // U+006B (k)
+    GLYPH(0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00),   // U+006C (l)
+    GLYPH(0x00, 0x00, 0x33, 0x7F, 0x7F, 0x6B, 0x63, 0x00),   // U+006D (m)
+    GLYPH(0x00, 0x00, 0x1F, 0x33, 0x33, 0x33, 0x33, 0x00),   // U+006E (n)
+    GLYPH(0x00, 0x00, 0x1E, 0x33, 0x33, 0x33, 0x1E, 0x00),   // U+006F (o)
+    GLYPH(0x00, 0x00, 0x3B, 0x66, 0x66, 0x3E, 0x06, 0x0F),   // U+0070 (p)
+    GLYPH(0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x78),   // U+0071 (q)
+    GLYPH(0x00, 0x00, 0x3B, 0x6E, 0x66, 0x06, 0x0F, 0x00),   // U+0072 (r)
+    GLYPH(0x00, 0x00, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x00),   // U+0073 (s)
+    GLYPH(0x08, 0x0C, 0x3E, 0x0C, 0x0C, 0x2C, 0x18, 0x00),   // U+0074 (t)
+    GLYPH(0x00, 0x00, 0x33, 0x33, 0x33, 0x33, 0x6E, 0x00),   // U+0075 (u)
+    GLYPH(0x00, 0x00, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00),   // U+0076 (v)
+    GLYPH(0x00, 0x00, 0x63, 0x6B, 0x7F, 0x7F, 0x36, 0x00),   // U+0077 (w)
+    GLYPH(0x00, 0x00, 0x63, 0x36, 0x1C, 0x36, 0x63, 0x00),   // U+0078 (x)
+    GLYPH(0x00, 0x00, 0x33, 0x33, 0x33, 0x3E, 0x30, 0x1F),   // U+0079 (y)
+    GLYPH(0x00, 0x00, 0x3F, 0x19, 0x0C, 0x26, 0x3F, 0x00),   // U+007A (z)
+    GLYPH(0x38, 0x0C, 0x0C, 0x07, 0x0C, 0x0C, 0x38, 0x00),   // U+007B ({)
+    GLYPH(0x18, 0x18, 0x18, 0x00, 0x18, 0x18, 0x18, 0x00),   // U+007C (|)
+    GLYPH(0x07, 0x0C, 0x0C, 0x38, 0x0C, 0x0C, 0x07, 0x00),   // U+007D (})
+    GLYPH(0x6E, 0x3B, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00),   // U+007E (~)
+    GLYPH(0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00)    // U+007F
+};
+
+int text_draw_char(uint8_t *lines, int x, int y, char c, text_mode_t mode, scrn_tiles_t *tiles) {
+    const uint8_t *glyph = text_font[c&0x7F];
+    int x0 = x<0 ? 0 : x;
+    int x1 = x+TEXT_GLYPH_W>SCRN_WIDTH ? SCRN_WIDTH : x+TEXT_GLYPH_W;
+    //y>>3 rounds down for negative y too, y&7 is then the shift into the page
+    int page = y>>3;
+    int shift = y&7;
+    if (x0>=x1 || y<=-TEXT_GLYPH_H || y>=SCRN_HEIGHT) return x+TEXT_GLYPH_W;
+    //A glyph covers the bottom of page and, unless aligned, the top of page+1
+    for (int half=0;half<2;half++, page++) {
+        if (half && !shift) break;
+        if (page<0 || page>=SCRN_PAGES) continue;
+        uint8_t *col = lines+SCRN_WIDTH*page;
+        uint8_t keep = half ? 0xFF<<shift : 0xFF>>(8-shift);
+        for (int i=x0;i<x1;i++) {
+            uint8_t bits = half ? glyph[i-x]>>(8-shift) : glyph[i-x]<<shift;
+            if (mode==TEXT_OR) {
+                col[i] |= bits;
+            } else if (mode==TEXT_XOR) {
+                col[i] ^= bits;
+            } else {
+                col[i] = (col[i]&keep) | bits;
+            }
+        }
+        if (tiles) {
+            //Bits first/SCRN_TILE_COLS to (x1-1)/SCRN_TILE_COLS
+            int first = x0/SCRN_TILE_COLS, last = (x1-1)/SCRN_TILE_COLS;
+            tiles->rows[page] |= ((2<<last)-1) & ~((1<<first)-1);
+        }
+    }
+    return x+TEXT_GLYPH_W;
+}
+
+int text_draw(uint8_t *lines, int x, int y, const char *s, text_mode_t mode, scrn_tiles_t *tiles) {
+    int start = x;
+    for (;*s;s++) {
+        if (*s=='\n') {
+            x = start;
+            y += TEXT_GLYPH_H;
+        } else if (x<SCRN_WIDTH) {
+            x = text_draw_char(lines, x, y, *s, mode, tiles);
+        } else {
+            //Clipped off the right, only the width still counts
+            x += TEXT_GLYPH_W;
+        }
+    }
+    return x;
+}
+
+int text_printf(uint8_t *lines, int x, int y, text_mode_t mode, scrn_tiles_t *tiles, const char *format, ...) {
+    char buf[TEXT_MAX_LEN+1];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    return text_draw(lines, x, y, buf, mode, tiles);
+}
+
+int text_draw_uint(uint8_t *lines, int x, int y, uint64_t value, text_mode_t mode, scrn_tiles_t *tiles) {
+    char buf[21];
+    int i = sizeof(buf)-1;
+    buf[i] = '\0';
+    do {
+        buf[--i] = '0'+value%10;
+        value /= 10;
+    } while (value);
+    return text_draw(lines, x, y, buf+i, mode, tiles);
+}
+
+int text_width(const char *s) {
+    int width = 0, line = 0;
+    for (;*s;s++) {
+        if (*s=='\n') {
+            line = 0;
+        } else {
+            line += TEXT_GLYPH_W;
+        }
+        if (line>width) width = line;
+    }
+    return width;
+}
@@ -0,0 +1,38 @@
+#ifndef TEXT_H
+#define TEXT_H
+
+#include <stdint.h>
+#include "framebuffer.h"
+
+//8x8 text drawn straight into a page format framebuffer. The font is kept
+//column by column like the screen, so a glyph column lands on the screen
+//as one byte, or as two shifted bytes when y is not a multiple of 8.
+//Anything outside the screen is clipped; x and y may be negative.
+
+#define TEXT_GLYPH_W 8
+#define TEXT_GLYPH_H 8
+//Longest string text_printf formats
+#define TEXT_MAX_LEN 64
+
+typedef enum {
+    TEXT_OR,                         //Set the glyph pixels, leave the rest
+    TEXT_OPAQUE,                     //Glyph pixels on, the rest of its cell off
+    TEXT_XOR                         //Flip the glyph pixels
+} text_mode_t;
+
+//Glyph c&0x7F, 8 column bytes with bit 0 the top row. In flash on the ESP32.
+extern const uint8_t text_font[128][TEXT_GLYPH_W];
+
+//Each draw returns the x after what it drew. If tiles is not NULL the tiles
+//it drew in are marked there, for scrn_delta_flush_tiles.
+int text_draw_char(uint8_t *lines, int x, int y, char c, text_mode_t mode, scrn_tiles_t *tiles);
+//'\n' starts a new line at the first x, TEXT_GLYPH_H lower
+int text_draw(uint8_t *lines, int x, int y, const char *s, text_mode_t mode, scrn_tiles_t *tiles);
+int text_printf(uint8_t *lines, int x, int y, text_mode_t mode, scrn_tiles_t *tiles, const char *format, ...)
+        __attribute__((format(printf, 6, 7)));
+//Without printf, for counters redrawn every frame
+int text_draw_uint(uint8_t *lines, int x, int y, uint64_t value, text_mode_t mode, scrn_tiles_t *tiles);
+//Width in pixels of the longest line of s
+int text_width(const char *s);
+
+#endif
@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <string.h>
+#include "esp_timer.h"
+#include "trace.h"
+
+//Events on a line of the dump
+#define TRACE_DUMP_LINE 8
+
+const char *const trace_names[TRACE_POINTS] = {
+    "input", "step", "render", "flush", "spi_wait", "idle", "delay", "life_gen"
+};
+
+#if TRACE_ENABLED
+
+trace_ring_t trace_rings[portNUM_PROCESSORS];
+
+void trace_sync(trace_ring_t *ring, uint32_t cycles) {
+    ring->sync_cycles = cycles;
+    __atomic_store_n(&ring->sync_us, esp_timer_get_time(), __ATOMIC_RELEASE);
+}
+
+int trace_snapshot(int core, trace_event_t *out, int max, uint32_t *sync_cycles, int64_t *sync_us) {
+    trace_ring_t *ring = &trace_rings[core];
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    uint32_t n = head<TRACE_RING_EVENTS ? head : TRACE_RING_EVENTS;
+    if (n>(uint32_t) max) n = max;
+    int count = 0;
+    for (uint32_t i=head-n;i!=head;i++) {
+        trace_event_t *e = &ring->events[i&(TRACE_RING_EVENTS-1)];
+        if (__atomic_load_n(&e->seq, __ATOMIC_ACQUIRE)!=(uint16_t) i) continue;
+        out[count] = *e;
+        //Written over while it was copied
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&e->seq, __ATOMIC_RELAXED)!=(uint16_t) i) continue;
+        count++;
+    }
+    *sync_us = __atomic_load_n(&ring->sync_us, __ATOMIC_ACQUIRE);
+    *sync_cycles = ring->sync_cycles;
+    return count;
+}
+
+void trace_dump(void) {
+    static trace_event_t events[TRACE_RING_EVENTS];
+    printf("trace: begin %d %d %d\n", portNUM_PROCESSORS, TRACE_CYCLES_PER_US, TRACE_POINTS);
+    for (int i=0;i<TRACE_POINTS;i++) printf("trace: point %d %s\n", i, trace_names[i]);
+    for (int core=0;core<portNUM_PROCESSORS;core++) {
+        uint32_t sync_cycles;
+        int64_t sync_us;
+        int n = trace_snapshot(core, events, TRACE_RING_EVENTS, &sync_cycles, &sync_us);
+        printf("trace: core %d %u %lld %d %u\n", core, (unsigned) sync_cycles, (long long) sync_us, n,
+                (unsigned) __atomic_load_n(&trace_rings[core].head, __ATOMIC_RELAXED));
+        for (int i=0;i<n;i+=TRACE_DUMP_LINE) {
+            printf("trace: %d", core);
+            for (int j=i;j<n && j<i+TRACE_DUMP_LINE;j++) {
+                printf(" %08x%02x%02x", (unsigned) events[j].cycles, events[j].point, events[j].type);
+            }
+            printf("\n");
+        }
+    }
+    printf("trace: end\n");
+}
+
+void trace_clear(void) {
+    //A seq of all ones is ~0, an event being written, for every slot
+    for (int core=0;core<portNUM_PROCESSORS;core++) {
+        trace_ring_t *ring = &trace_rings[core];
+        memset(ring->events, 0xFF, sizeof(ring->events));
+        ring->sync_us = 0;
+        __atomic_store_n(&ring->head, 0, __ATOMIC_RELEASE);
+    }
+}
+
+#else
+
+int trace_snapshot(int core, trace_event_t *out, int max, uint32_t *sync_cycles, int64_t *sync_us) {
+    *sync_cycles = 0;
+    *sync_us = 0;
+    return 0;
+}
+
+void trace_dump(void) {
+    printf("trace: compiled out, build with TRACE_ENABLED 1\n");
+}
+
+void trace_clear(void) {
+}
+
+#endif
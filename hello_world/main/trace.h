@@ -0,0 +1,113 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+
+//Begin and end events of the hot paths, stamped with the CPU cycle counter,
+//in a ring per core. Built with TRACE_ENABLED 1 (CFLAGS += -DTRACE_ENABLED=1
+//in main/component.mk, or CFLAGS on the host) the TRACE_ macros record;
+//otherwise they are empty and there is no ring.
+//
+//A record takes its slot with an atomic add on the ring's head, so tasks and
+//interrupts on the same core never write the same slot, and the slot's seq
+//is written last: a reader skips slots whose seq is not the index it read
+//them at. trace_dump prints the rings on the console for host/trace_view.c,
+//which turns them into Chrome trace JSON and histograms.
+//
+//The cycle counters of the two cores do not agree, and wrap every 18 s at
+//240 MHz. Each ring keeps a pair of cycle count and esp_timer time read
+//together, taken again whenever the count has gone half way round, which
+//the viewer lines the cores up with.
+
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 0
+#endif
+
+//Per core, a power of two
+#define TRACE_RING_EVENTS 2048
+#define TRACE_CYCLES_PER_US CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ
+
+typedef enum {
+    TRACE_INPUT,                             //Taking the button events
+    TRACE_STEP,                              //An effect's steps of a frame
+    TRACE_RENDER,
+    TRACE_FLUSH,
+    TRACE_SPI_WAIT,                          //Waiting for SPI transactions to come back
+    TRACE_IDLE,                              //Between frames, the runner waiting on input
+    TRACE_DELAY,                             //frame_sched_wait sleeping
+    TRACE_LIFE_GEN,                          //One generation of Life
+    TRACE_POINTS
+} trace_point_t;
+
+typedef enum {
+    TRACE_BEGIN,
+    TRACE_END,
+    TRACE_INSTANT
+} trace_type_t;
+
+typedef struct {
+    uint32_t cycles;
+    uint8_t point;                           //trace_point_t
+    uint8_t type;                            //trace_type_t
+    uint16_t seq;                            //Low bits of the index, written last
+} trace_event_t;
+
+extern const char *const trace_names[TRACE_POINTS];
+
+#if TRACE_ENABLED
+#include "freertos/task.h"
+#include "xtensa/core-macros.h"
+
+typedef struct {
+    trace_event_t events[TRACE_RING_EVENTS];
+    uint32_t head;                           //Events ever recorded
+    uint32_t sync_cycles;
+    int64_t sync_us;                         //0 until the first event
+} trace_ring_t;
+
+extern trace_ring_t trace_rings[portNUM_PROCESSORS];
+
+void trace_sync(trace_ring_t *ring, uint32_t cycles);
+
+static inline void trace_record(uint8_t point, uint8_t type) {
+    trace_ring_t *ring = &trace_rings[xPortGetCoreID()];
+    uint32_t i = __atomic_fetch_add(&ring->head, 1, __ATOMIC_RELAXED);
+    trace_event_t *e = &ring->events[i&(TRACE_RING_EVENTS-1)];
+    uint32_t cycles = XTHAL_GET_CCOUNT();
+    //Being written: ~i is neither i nor the index TRACE_RING_EVENTS before it
+    __atomic_store_n(&e->seq, (uint16_t) ~i, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    e->cycles = cycles;
+    e->point = point;
+    e->type = type;
+    __atomic_store_n(&e->seq, (uint16_t) i, __ATOMIC_RELEASE);
+    if (__builtin_expect(ring->sync_us==0 || cycles-ring->sync_cycles>=0x80000000u, 0)) {
+        trace_sync(ring, cycles);
+    }
+}
+
+#define TRACE_BEGIN(point) trace_record(point, TRACE_BEGIN)
+#define TRACE_END(point) trace_record(point, TRACE_END)
+#define TRACE_INSTANT(point) trace_record(point, TRACE_INSTANT)
+#else
+#define TRACE_BEGIN(point) do {} while (0)
+#define TRACE_END(point) do {} while (0)
+#define TRACE_INSTANT(point) do {} while (0)
+#endif
+
+//Copy out what core's ring holds, oldest first, up to max events. Slots
+//being written are left out. Returns how many, 0 when compiled out.
+int trace_snapshot(int core, trace_event_t *out, int max, uint32_t *sync_cycles, int64_t *sync_us);
+//Print every ring on the console:
+//  trace: begin <cores> <cycles per us> <points>
+//  trace: point <index> <name>
+//  trace: core <core> <sync cycles> <sync us> <events> <recorded>
+//  trace: <core> <event>...       cycles, point and type in hex, ccccccccpptt
+//  trace: end
+void trace_dump(void);
+//Forget everything recorded
+void trace_clear(void);
+
+#endif
@@ -0,0 +1,113 @@
+#include <string.h>
+#include "esp_heap_caps.h"
+#include "turmite.h"
+
+//Steps of one cell in each direction, wrapping through the masks below
+static const uint8_t turmite_dx[4] = {1, 0, SCRN_WIDTH-1, 0};
+static const uint8_t turmite_dy[4] = {0, 1, 0, SCRN_HEIGHT-1};
+
+bool turmite_init_ants(turmite_t *t, const char *rule, turmite_ant_t *ants, uint16_t max_ants) {
+    int colours = strlen(rule);
+    memset(t, 0, sizeof(*t));
+    if (colours==0 || colours>TURMITE_MAX_COLOURS) return false;
+    for (int c=0;c<colours;c++) {
+        if (rule[c]=='L') {
+            t->turn[c] = 3;
+        } else if (rule[c]=='R') {
+            t->turn[c] = 1;
+        } else if (rule[c]=='N') {
+            t->turn[c] = 0;
+        } else if (rule[c]=='U') {
+            t->turn[c] = 2;
+        } else {
+            return false;
+        }
+        t->next[c] = (c+1)%colours;
+    }
+    if (ants==NULL) return false;
+    t->ants = ants;
+    t->max_ants = max_ants;
+    scrn_tiles_fill(&t->touched);
+    return true;
+}
+
+bool turmite_init(turmite_t *t, const char *rule, uint16_t max_ants) {
+    turmite_ant_t *ants = heap_caps_malloc(max_ants*sizeof(turmite_ant_t), MALLOC_CAP_8BIT);
+    if (!turmite_init_ants(t, rule, ants, max_ants)) {
+        heap_caps_free(ants);
+        return false;
+    }
+    t->owns_ants = true;
+    return true;
+}
+
+void turmite_free(turmite_t *t) {
+    if (t->owns_ants) heap_caps_free(t->ants);
+    t->owns_ants = false;
+    t->ants = NULL;
+    t->ant_count = 0;
+    t->max_ants = 0;
+}
+
+bool turmite_add_ant(turmite_t *t, uint8_t x, uint8_t y, uint8_t direction) {
+    if (t->ant_count>=t->max_ants) return false;
+    turmite_ant_t *a = &t->ants[t->ant_count++];
+    a->x = x%SCRN_WIDTH;
+    a->y = y%SCRN_HEIGHT;
+    a->direction = direction%4;
+    return true;
+}
+
+//Turn as the colour of the cell says, move it on to its next colour, step forward
+static inline void turmite_move(turmite_t *t, uint8_t *x, uint8_t *y, uint8_t *d) {
+    uint32_t i = *x+SCRN_WIDTH*(uint32_t) *y;
+    uint8_t *cell = &t->cells[i/2];
+    uint8_t shift = (i&1)*4;
+    uint8_t c = (*cell>>shift)&0x0F;
+    *d = (*d+t->turn[c])&3;
+    *cell = (*cell&~(0x0F<<shift))|(t->next[c]<<shift);
+    t->touched.rows[*y/8] |= 1<<(*x/SCRN_TILE_COLS);
+    *x = (*x+turmite_dx[*d])&(SCRN_WIDTH-1);
+    *y = (*y+turmite_dy[*d])&(SCRN_HEIGHT-1);
+}
+
+void turmite_run(turmite_t *t, uint32_t steps) {
+    if (t->ant_count==1) {
+        //Keep the lone ant in registers
+        uint8_t x = t->ants[0].x, y = t->ants[0].y, d = t->ants[0].direction;
+        for (uint32_t s=0;s<steps;s++) {
+            turmite_move(t, &x, &y, &d);
+        }
+        t->ants[0].x = x;
+        t->ants[0].y = y;
+        t->ants[0].direction = d;
+    } else {
+        for (uint32_t s=0;s<steps;s++) {
+            for (int a=0;a<t->ant_count;a++) {
+                turmite_ant_t *ant = &t->ants[a];
+                turmite_move(t, &ant->x, &ant->y, &ant->direction);
+            }
+        }
+    }
+    t->steps += steps;
+}
+
+void turmite_render(turmite_t *t, uint8_t *lines, scrn_tiles_t *tiles) {
+    for (int p=0;p<SCRN_PAGES;p++) {
+        uint16_t row = t->touched.rows[p];
+        while (row) {
+            int x0 = __builtin_ctz(row)*SCRN_TILE_COLS;
+            row &= row-1;
+            for (int x=x0;x<x0+SCRN_TILE_COLS;x++) {
+                uint8_t column = 0;
+                for (int b=0;b<8;b++) {
+                    uint32_t i = x+SCRN_WIDTH*(uint32_t) (8*p+b);
+                    if ((t->cells[i/2]>>((i&1)*4))&0x0F) column |= 1<<b;
+                }
+                lines[x+SCRN_WIDTH*p] = column;
+            }
+        }
+    }
+    *tiles = t->touched;
+    scrn_tiles_clear(&t->touched);
+}
@@ -0,0 +1,46 @@
+#ifndef TURMITE_H
+#define TURMITE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "framebuffer.h"
+
+//Langton's ant generalised: each cell has a colour, and an ant on a cell of
+//colour c turns as told by the c-th letter of the rule, moves the cell on to
+//the next colour and steps forward. Letters are L and R to turn, N to go
+//straight on and U to turn back. "LR" is the ant display_langtons_ant always had.
+//Ants wrap around the 128x64 screen. Cells of any colour but 0 are drawn lit.
+
+#define TURMITE_MAX_COLOURS 16       //Colours are stored as nibbles
+
+typedef struct {
+    uint8_t x, y;
+    uint8_t direction;               //0 right, 1 down, 2 left, 3 up
+} turmite_ant_t;
+
+typedef struct {
+    uint8_t cells[SCRN_WIDTH*SCRN_HEIGHT/2];   //Colour of (x, y) in the nibble at x+128*y
+    uint8_t turn[TURMITE_MAX_COLOURS];         //Direction change for each colour, mod 4
+    uint8_t next[TURMITE_MAX_COLOURS];         //Colour a cell takes after an ant left it
+    turmite_ant_t *ants;
+    uint16_t ant_count;
+    uint16_t max_ants;
+    bool owns_ants;                  //Allocated by turmite_init, to be freed
+    scrn_tiles_t touched;            //Tiles with cells changed since the last render
+    uint64_t steps;                  //Moves of every ant since init
+} turmite_t;
+
+//False if the rule has a letter other than LRNU, is empty or too long, or
+//there is no memory for the ants
+bool turmite_init(turmite_t *t, const char *rule, uint16_t max_ants);
+//Same, with room for the ants given instead of allocated
+bool turmite_init_ants(turmite_t *t, const char *rule, turmite_ant_t *ants, uint16_t max_ants);
+void turmite_free(turmite_t *t);
+//False once max_ants ants are on the screen
+bool turmite_add_ant(turmite_t *t, uint8_t x, uint8_t y, uint8_t direction);
+//Move every ant steps times, in turn
+void turmite_run(turmite_t *t, uint32_t steps);
+//Redraw the touched tiles of lines, return them in tiles and clear them
+void turmite_render(turmite_t *t, uint8_t *lines, scrn_tiles_t *tiles);
+
+#endif
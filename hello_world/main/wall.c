@@ -0,0 +1,232 @@
+#include <stdio.h>
+#include <string.h>
+#include "esp_timer.h"
+#include "wall.h"
+
+void wall_init_cmds(scrn_init_cmd_t *cmds, const wall_panel_config_t *config) {
+    int n = 0;
+    do {
+        cmds[n] = scrn_init_cmds[n];
+        if (config->flipped && cmds[n].cmd==0xA1) cmds[n].cmd = 0xA0;
+        if (config->flipped && cmds[n].cmd==0xC8) cmds[n].cmd = 0xC0;
+        if (config->contrast && cmds[n].cmd==0x81) cmds[n].data[0] = config->contrast;
+    } while (scrn_init_cmds[n++].databytes!=0xFF && n<WALL_INIT_CMDS);
+}
+
+esp_err_t wall_open(wall_t *w, int cols, int rows, const wall_panel_config_t *configs) {
+    memset(w, 0, sizeof(*w));
+    if (cols<1 || rows<1 || cols*rows>WALL_MAX_PANELS) return ESP_ERR_INVALID_ARG;
+    w->cols = cols;
+    w->rows = rows;
+    w->count = cols*rows;
+    w->width = SCRN_WIDTH*cols;
+    w->height = SCRN_HEIGHT*rows;
+    for (int i=0;i<w->count;i++) {
+        wall_panel_t *p = &w->panels[i];
+        esp_err_t ret = scrn_add_device(configs[i].cs_pin, &p->spi);
+        if (ret!=ESP_OK) {
+            while (i--) spi_bus_remove_device(w->panels[i].spi);
+            return ret;
+        }
+        wall_init_cmds(p->init_cmds, &configs[i]);
+    }
+    //One reset line for all of them
+    scrn_reset();
+    for (int i=0;i<w->count;i++) {
+        scrn_send_init(w->panels[i].spi, w->panels[i].init_cmds);
+    }
+    return ESP_OK;
+}
+
+void wall_close(wall_t *w) {
+    for (int i=0;i<w->count;i++) spi_bus_remove_device(w->panels[i].spi);
+    w->count = 0;
+}
+
+static int wall_panel_offset(const wall_t *w, int i) {
+    return w->width*SCRN_PAGES*(i/w->cols)+SCRN_WIDTH*(i%w->cols);
+}
+
+uint8_t *wall_panel_lines(wall_t *w, int i) {
+    return w->lines+wall_panel_offset(w, i);
+}
+
+void wall_put(wall_t *w, int i, const uint8_t *frame) {
+    uint8_t *lines = w->lines+wall_panel_offset(w, i);
+    for (int page=0;page<SCRN_PAGES;page++) {
+        memcpy(lines+w->width*page, frame+SCRN_WIDTH*page, SCRN_WIDTH);
+    }
+}
+
+void wall_get(const wall_t *w, int i, uint8_t *frame) {
+    const uint8_t *lines = w->lines+wall_panel_offset(w, i);
+    for (int page=0;page<SCRN_PAGES;page++) {
+        memcpy(frame+SCRN_WIDTH*page, lines+w->width*page, SCRN_WIDTH);
+    }
+}
+
+void wall_invalidate(wall_t *w) {
+    for (int i=0;i<w->count;i++) w->panels[i].shadow_valid = false;
+}
+
+//A panel is up to date once it has nothing left to queue and nothing in flight
+static void wall_check_done(wall_panel_t *p, int64_t start) {
+    if (p->in_flight==0 && p->page==SCRN_PAGES && p->age_us<0) p->age_us = esp_timer_get_time()-start;
+}
+
+//The panel whose oldest transaction in flight was queued first, which the
+//bus gets to first. NULL if nothing is in flight.
+static wall_panel_t *wall_oldest(wall_t *w) {
+    wall_panel_t *oldest = NULL;
+    uint32_t oldest_seq = 0;
+    for (int i=0;i<w->count;i++) {
+        wall_panel_t *p = &w->panels[i];
+        if (p->in_flight==0) continue;
+        uint32_t seq = p->seq[(p->head-p->in_flight+WALL_PANEL_TRANS)%WALL_PANEL_TRANS];
+        //The counter wraps, compare the difference
+        if (oldest==NULL || (int32_t) (seq-oldest_seq)<0) {
+            oldest = p;
+            oldest_seq = seq;
+        }
+    }
+    return oldest;
+}
+
+//Collect the result of the panel's oldest transaction, waiting for it if
+//ticks allows
+static bool wall_collect(wall_panel_t *p, TickType_t ticks, int64_t start) {
+    spi_transaction_t *rtrans;
+    if (spi_device_get_trans_result(p->spi, &rtrans, ticks)!=ESP_OK) return false;
+    p->in_flight--;
+    wall_check_done(p, start);
+    return true;
+}
+
+//Collect whatever is back already. If nothing is, wait for the oldest.
+static void wall_reap(wall_t *w, int64_t start) {
+    bool reaped = false;
+    for (int i=0;i<w->count;i++) {
+        wall_panel_t *p = &w->panels[i];
+        while (p->in_flight && wall_collect(p, 0, start)) reaped = true;
+    }
+    wall_panel_t *oldest = wall_oldest(w);
+    if (!reaped && oldest) wall_collect(oldest, portMAX_DELAY, start);
+}
+
+//Queue the panel's next range, false if it has none left
+static bool wall_queue_next(wall_t *w, wall_panel_t *p, const uint8_t *lines) {
+    esp_err_t ret;
+    while (p->page<SCRN_PAGES) {
+        const uint8_t *src = lines+w->width*p->page;
+        uint8_t *shadow = p->shadow+SCRN_WIDTH*p->page;
+        int start, end;
+        if (!p->shadow_valid) {
+            start = 0;
+            end = p->x = SCRN_WIDTH;
+        } else if (p->rows[p->page]==0 || !scrn_delta_next_range(p->rows[p->page], src, shadow, &p->x, &start, &end)) {
+            p->page++;
+            p->x = 0;
+            continue;
+        }
+        memcpy(shadow+start, src+start, end-start);
+
+        uint8_t col = start+SCRN_COL_OFFSET;
+        spi_transaction_t *t = &p->trans[p->head];
+        memset(t, 0, 2*sizeof(spi_transaction_t));
+        t[0].length = 8*3;
+        t[0].user = (void*) 0;
+        t[0].flags = SPI_TRANS_USE_TXDATA;
+        t[0].tx_data[0] = 0xB0+p->page;
+        t[0].tx_data[1] = col&0x0F;
+        t[0].tx_data[2] = 0x10|(col>>4);
+        t[1].length = 8*(end-start);
+        t[1].user = (void*) SCRN_TRANS_DC;
+        t[1].tx_buffer = shadow+start;
+        for (int i=0;i<2;i++) {
+            p->seq[p->head+i] = w->seq++;
+            ret = spi_device_queue_trans(p->spi, &t[i], portMAX_DELAY);
+            assert(ret==ESP_OK);
+        }
+        p->head = (p->head+2)%WALL_PANEL_TRANS;
+        p->in_flight += 2;
+        p->frame_bytes += 3+end-start;
+        if (p->x==SCRN_WIDTH) {
+            p->page++;
+            p->x = 0;
+        }
+        return true;
+    }
+    return false;
+}
+
+void wall_flush_tiles(wall_t *w, const scrn_tiles_t *tiles) {
+    int64_t start = esp_timer_get_time();
+    int busy = w->count;
+    for (int i=0;i<w->count;i++) {
+        wall_panel_t *p = &w->panels[i];
+        for (int page=0;page<SCRN_PAGES;page++) p->rows[page] = tiles ? tiles[i].rows[page] : 0xFFFF;
+        p->page = 0;
+        p->x = 0;
+        p->frame_bytes = 0;
+        p->age_us = -1;
+    }
+    while (busy) {
+        //A range from each panel with room in its ring, round the panels
+        bool queued = false;
+        busy = 0;
+        for (int i=0;i<w->count;i++) {
+            wall_panel_t *p = &w->panels[i];
+            if (p->page==SCRN_PAGES) continue;
+            busy++;
+            //Results come back one at a time, a range takes two
+            if (p->in_flight>WALL_PANEL_TRANS-2) continue;
+            if (wall_queue_next(w, p, wall_panel_lines(w, i))) {
+                queued = true;
+            } else {
+                wall_check_done(p, start);
+            }
+        }
+        //Every ring full: make room
+        if (!queued) wall_reap(w, start);
+    }
+    //Nothing left to queue, the rest comes back oldest first
+    for (wall_panel_t *p;(p = wall_oldest(w))!=NULL;) wall_collect(p, portMAX_DELAY, start);
+    for (int i=0;i<w->count;i++) {
+        wall_panel_t *p = &w->panels[i];
+        p->shadow_valid = true;
+        p->total_bytes += p->frame_bytes;
+        w->total_bytes += p->frame_bytes;
+        p->age_total_us += p->age_us;
+        if (p->age_us>p->age_max_us) p->age_max_us = p->age_us;
+    }
+    w->frames++;
+    w->busy_us += esp_timer_get_time()-start;
+}
+
+void wall_flush(wall_t *w) {
+    wall_flush_tiles(w, NULL);
+}
+
+void wall_reset_stats(wall_t *w) {
+    for (int i=0;i<w->count;i++) {
+        wall_panel_t *p = &w->panels[i];
+        p->total_bytes = 0;
+        p->age_max_us = 0;
+        p->age_total_us = 0;
+    }
+    w->frames = 0;
+    w->total_bytes = 0;
+    w->busy_us = 0;
+}
+
+void wall_print_stats(const wall_t *w) {
+    printf("wall %dx%d: %u frames, %.0f bytes/s while flushing, %.0f us/flush\n", w->cols, w->rows,
+            (unsigned) w->frames, w->busy_us ? w->total_bytes*1e6/w->busy_us : 0.0,
+            w->frames ? (double) w->busy_us/w->frames : 0.0);
+    for (int i=0;i<w->count;i++) {
+        const wall_panel_t *p = &w->panels[i];
+        printf("  panel %d: %.1f bytes/frame, frame age %.0f us average, %lld us max\n", i,
+                w->frames ? (double) p->total_bytes/w->frames : 0.0,
+                w->frames ? (double) p->age_total_us/w->frames : 0.0, (long long) p->age_max_us);
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef WALL_H
+#define WALL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "driver/spi_master.h"
+#include "display.h"
+
+//Several panels side by side and on top of each other on the screen's SPI
+//bus, each on its own CS pin and sharing MOSI, CLK, DC and RST, showing one
+//logical framebuffer. The buffer is in page format as wide as the whole wall,
+//lines[x+wall_width*(y/8)], so each page of a panel is 128 bytes in a row.
+//
+//A flush sends every panel what changed, the same ranges scrn_delta_flush
+//would, a range from each panel in turn so that every device queue has
+//something in it while the CPU looks for the next changes: the bus goes
+//from one panel's transactions to another's without waiting for the CPU.
+//It is only idle while the first range is found and after the last one.
+
+//The ESP32 SPI master takes three devices on a bus
+#define WALL_MAX_PANELS 3
+//Address and data for up to this many ranges are in flight per panel
+#define WALL_PANEL_TRANS (SCRN_QUEUE_SIZE&~1)
+#define WALL_INIT_CMDS 24
+
+typedef struct {
+    int cs_pin;
+    bool flipped;                            //Mounted upside down, pin header at the bottom
+    uint8_t contrast;                        //0 for what scrn_init_cmds sets
+} wall_panel_config_t;
+
+typedef struct {
+    spi_device_handle_t spi;
+    scrn_init_cmd_t init_cmds[WALL_INIT_CMDS];  //scrn_init_cmds changed to the panel's config
+    uint8_t shadow[SCRN_BUF_SIZE];           //Copy of the panel contents, sent from
+    bool shadow_valid;
+    spi_transaction_t trans[WALL_PANEL_TRANS];  //A ring, results come back in queue order
+    uint32_t seq[WALL_PANEL_TRANS];          //When each was queued, counted over the wall
+    int head;                                //Next in the ring to queue
+    int in_flight;                           //Queued, result not collected yet
+    int page, x;                             //Where the running flush looks next
+    uint16_t rows[SCRN_PAGES];               //Tiles the running flush looks at
+    uint32_t frame_bytes;                    //Sent by the last flush
+    uint64_t total_bytes;
+    int64_t age_us;                          //Last flush: from its start to this panel being up to date
+    int64_t age_max_us;
+    int64_t age_total_us;
+} wall_panel_t;
+
+typedef struct {
+    int cols, rows;                          //Of panels
+    int count;
+    int width, height;                       //Of the logical framebuffer, in pixels
+    uint8_t lines[WALL_MAX_PANELS*SCRN_BUF_SIZE];
+    wall_panel_t panels[WALL_MAX_PANELS];    //Left to right, then top to bottom
+    uint32_t seq;
+    uint32_t frames;
+    uint64_t total_bytes;
+    int64_t busy_us;                         //Spent in wall_flush
+} wall_t;
+
+//Attach cols*rows panels to HSPI_HOST, which scrn_bus_init has set up,
+//reset them and send each its init commands. Clears the buffer.
+esp_err_t wall_open(wall_t *w, int cols, int rows, const wall_panel_config_t *configs);
+//Take the panels off the bus
+void wall_close(wall_t *w);
+//Build the init commands of a panel from scrn_init_cmds
+void wall_init_cmds(scrn_init_cmd_t *cmds, const wall_panel_config_t *config);
+//Where panel i starts in the buffer
+uint8_t *wall_panel_lines(wall_t *w, int i);
+//Copy a 128x64 frame in page format to panel i of the buffer and back
+void wall_put(wall_t *w, int i, const uint8_t *frame);
+void wall_get(const wall_t *w, int i, uint8_t *frame);
+//Forget what the panels show, the next flush sends everything
+void wall_invalidate(wall_t *w);
+//Send the buffer, only looking for changes inside the given tiles of each
+//panel (NULL for all of them). Returns when every panel is up to date.
+void wall_flush_tiles(wall_t *w, const scrn_tiles_t *tiles);
+void wall_flush(wall_t *w);
+void wall_reset_stats(wall_t *w);
+//Bytes per second while flushing, and each panel's frame age, on stdout
+void wall_print_stats(const wall_t *w);
+
+#endif